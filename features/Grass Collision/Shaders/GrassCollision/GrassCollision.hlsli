@@ -5,9 +5,10 @@ namespace GrassCollision
 		float4 centre[2];
 	};
 
+	StructuredBuffer<CollisionData> collisionData : register(t40);
+
 	cbuffer GrassCollisionPerFrame : register(b5)
 	{
-		CollisionData collisionData[256];
 		uint numCollisions;
 	}
 
@@ -3,6 +3,9 @@
 cbuffer PerFrame : register(b0)
 {
 	uint LightCount;
+	uint MaxClusterLights;
+	uint LightIndexListSize;
+	uint3 ClusterSize;
 }
 
 //references
@@ -11,11 +14,20 @@ cbuffer PerFrame : register(b0)
 StructuredBuffer<ClusterAABB> clusters : register(t0);
 StructuredBuffer<Light> lights : register(t1);
 
+// [0] light indices written, [1] overflowing clusters, [2] most lights in a cluster
 RWStructuredBuffer<uint> lightIndexCounter : register(u0);
 RWStructuredBuffer<uint> lightIndexList : register(u1);
 RWStructuredBuffer<LightGrid> lightGrid : register(u2);
 
-groupshared Light sharedLights[GROUP_SIZE];
+// One group per cluster, each thread tests one light of a chunk
+#define CULLING_GROUP_SIZE 64
+// Largest MaxClusterLights set by the CPU
+#define MAX_CULLED_LIGHTS 512
+
+groupshared uint clusterLightIndices[MAX_CULLED_LIGHTS];
+groupshared uint chunkMasks[2][CULLING_GROUP_SIZE / 32];
+groupshared uint clusterOffset;
+groupshared uint clusterLightCount;
 
 bool LightIntersectsCluster(float3 position, float radius, ClusterAABB cluster)
 {
@@ -25,65 +37,86 @@ bool LightIntersectsCluster(float3 position, float radius, ClusterAABB cluster)
 	return dot(dist, dist) <= radius;
 }
 
-[numthreads(NUMTHREAD_X, NUMTHREAD_Y, NUMTHREAD_Z)] void main(
-	uint3 groupId
-	: SV_GroupID, uint3 dispatchThreadId
-	: SV_DispatchThreadID, uint3 groupThreadId
-	: SV_GroupThreadID, uint groupIndex
-	: SV_GroupIndex) {
-	if (any(dispatchThreadId >= uint3(CLUSTER_BUILDING_DISPATCH_SIZE_X, CLUSTER_BUILDING_DISPATCH_SIZE_Y, CLUSTER_BUILDING_DISPATCH_SIZE_Z)))
-		return;
-
-	uint visibleLightCount = 0;
-	uint visibleLightIndices[MAX_CLUSTER_LIGHTS];
+bool LightIntersectsCluster(Light light, ClusterAABB cluster)
+{
+	float radius = light.radius * light.radius;
+#if defined(VR)
+	return LightIntersectsCluster(light.positionVS[0].xyz, radius, cluster) || LightIntersectsCluster(light.positionVS[1].xyz, radius, cluster);
+#else
+	return LightIntersectsCluster(light.positionVS[0].xyz, radius, cluster);
+#endif
+}
 
-	uint clusterIndex = dispatchThreadId.x +
-	                    dispatchThreadId.y * CLUSTER_BUILDING_DISPATCH_SIZE_X +
-	                    dispatchThreadId.z * (CLUSTER_BUILDING_DISPATCH_SIZE_X * CLUSTER_BUILDING_DISPATCH_SIZE_Y);
+[numthreads(CULLING_GROUP_SIZE, 1, 1)] void main(uint3 groupId
+												  : SV_GroupID, uint groupIndex
+												  : SV_GroupIndex) {
+	uint clusterIndex = groupId.x +
+	                    groupId.y * ClusterSize.x +
+	                    groupId.z * (ClusterSize.x * ClusterSize.y);
 
 	ClusterAABB cluster = clusters[clusterIndex];
 
-	if (groupIndex < LightCount) {
-		uint lightIndex = groupIndex;
-		Light light = lights[lightIndex];
-		sharedLights[groupIndex] = light;
-	}
+	uint maxLights = min(MaxClusterLights, MAX_CULLED_LIGHTS);
+	uint word = groupIndex / 32;
+	uint bitMask = 1u << (groupIndex % 32);
+
+	if (groupIndex < 2 * (CULLING_GROUP_SIZE / 32))
+		chunkMasks[groupIndex / 2][groupIndex % 2] = 0;
 
 	GroupMemoryBarrierWithGroupSync();
 
-	for (uint i = 0; i < LightCount; i++) {
-		Light light = lights[i];
+	// Single pass over the lights, the hits of a chunk are ranked by light index so the list is in the same order as ClusterReference,
+	// the count keeps going past the capacity so the grid can be resized
+	uint visibleLightCount = 0;
+	for (uint chunk = 0, buffer = 0; chunk < LightCount; chunk += CULLING_GROUP_SIZE, buffer ^= 1) {
+		uint lightIndex = chunk + groupIndex;
+		bool visible = lightIndex < LightCount && LightIntersectsCluster(lights[lightIndex], cluster);
+		if (visible)
+			InterlockedOr(chunkMasks[buffer][word], bitMask);
 
-		float radius = light.radius * light.radius;
+		GroupMemoryBarrierWithGroupSync();
 
-#if defined(VR)
-		[branch] if (LightIntersectsCluster(light.positionVS[0], radius, cluster) || LightIntersectsCluster(light.positionVS[1], radius, cluster))
-		{
-#else
-		[branch] if (LightIntersectsCluster(light.positionVS[0], radius, cluster))
-		{
-#endif
-			visibleLightIndices[visibleLightCount] = i;
-			visibleLightCount++;
-			if (visibleLightCount >= MAX_CLUSTER_LIGHTS)
-				break;
-		}
+		uint lowerMask = word == 0 ? 0 : countbits(chunkMasks[buffer][0]);
+		uint rank = visibleLightCount + lowerMask + countbits(chunkMasks[buffer][word] & (bitMask - 1));
+		if (visible && rank < maxLights)
+			clusterLightIndices[rank] = lightIndex;
+
+		visibleLightCount += countbits(chunkMasks[buffer][0]) + countbits(chunkMasks[buffer][1]);
+
+		// The other buffer was last read before the barrier above
+		if (groupIndex < CULLING_GROUP_SIZE / 32)
+			chunkMasks[buffer ^ 1][groupIndex] = 0;
+
+		GroupMemoryBarrierWithGroupSync();
 	}
 
-	GroupMemoryBarrierWithGroupSync();
+	if (groupIndex == 0) {
+		InterlockedMax(lightIndexCounter[2], visibleLightCount);
+		uint count = visibleLightCount;
+		if (count > maxLights) {
+			InterlockedAdd(lightIndexCounter[1], 1);
+			count = maxLights;
+		}
+
+		uint offset = 0;
+		InterlockedAdd(lightIndexCounter[0], count, offset);
 
-	uint offset = 0;
-	InterlockedAdd(lightIndexCounter[0], visibleLightCount, offset);
+		// Drop what does not fit in the index list, the list grows on the next grid update
+		count = offset < LightIndexListSize ? min(count, LightIndexListSize - offset) : 0;
 
-	for (uint i = 0; i < visibleLightCount; i++) {
-		lightIndexList[offset + i] = visibleLightIndices[i];
+		LightGrid output = {
+			offset, count, 0, 0
+		};
+		lightGrid[clusterIndex] = output;
+
+		clusterOffset = offset;
+		clusterLightCount = count;
 	}
 
-	LightGrid output = {
-		offset, visibleLightCount, 0, 0
-	};
+	GroupMemoryBarrierWithGroupSync();
 
-	lightGrid[clusterIndex] = output;
+	for (uint i = groupIndex; i < clusterLightCount; i += CULLING_GROUP_SIZE)
+		lightIndexList[clusterOffset + i] = clusterLightIndices[i];
 }
 
 //https://www.3dgep.com/forward-plus/#Grid_Frustums_Compute_Shader
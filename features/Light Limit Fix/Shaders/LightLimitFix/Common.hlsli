@@ -1,11 +1,9 @@
 #ifndef __LLF_COMMON_DEPENDENCY_HLSL__
 #define __LLF_COMMON_DEPENDENCY_HLSL__
 
-#define NUMTHREAD_X 16
-#define NUMTHREAD_Y 16
-#define NUMTHREAD_Z 4
-#define GROUP_SIZE (NUMTHREAD_X * NUMTHREAD_Y * NUMTHREAD_Z)
-#define MAX_CLUSTER_LIGHTS 256
+#ifndef MAX_CLUSTER_LIGHTS
+#	define MAX_CLUSTER_LIGHTS 256
+#endif
 
 namespace LightFlags
 {
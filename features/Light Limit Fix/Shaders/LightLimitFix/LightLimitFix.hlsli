@@ -8,12 +8,13 @@ namespace LightLimitFix
 	{
 		uint NumStrictLights;
 		int RoomIndex;
-		Light StrictLights[15];
+		uint StrictLightsOffset;
 	};
 
 	StructuredBuffer<Light> lights : register(t35);
 	StructuredBuffer<uint> lightList : register(t36);       //MAX_CLUSTER_LIGHTS * 16^3
 	StructuredBuffer<LightGrid> lightGrid : register(t37);  //16^3
+	StructuredBuffer<Light> strictLights : register(t38);
 
 	bool GetClusterIndex(in float2 uv, in float z, inout uint clusterIndex)
 	{
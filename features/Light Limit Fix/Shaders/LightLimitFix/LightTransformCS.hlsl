@@ -0,0 +1,29 @@
+#include "LightLimitFix/Common.hlsli"
+
+cbuffer PerFrame : register(b0)
+{
+	row_major float4x4 ViewMatrix[2];
+	float4 EyePosition[2];
+	uint LightCount;
+}
+
+// Slots hold world positions in positionWS[0] so camera movement doesn't dirty them
+StructuredBuffer<Light> worldLights : register(t0);
+RWStructuredBuffer<Light> lights : register(u0);
+
+[numthreads(64, 1, 1)] void main(uint dispatchThreadId
+								 : SV_DispatchThreadID) {
+	if (dispatchThreadId >= LightCount)
+		return;
+
+	Light light = worldLights[dispatchThreadId];
+	float3 positionWorld = light.positionWS[0].xyz;
+
+	[unroll] for (uint eyeIndex = 0; eyeIndex < 2; eyeIndex++)
+	{
+		light.positionWS[eyeIndex] = float4(positionWorld - EyePosition[eyeIndex].xyz, 0);
+		light.positionVS[eyeIndex] = float4(mul(float4(light.positionWS[eyeIndex].xyz, 1), ViewMatrix[eyeIndex]).xyz, 0);
+	}
+
+	lights[dispatchThreadId] = light;
+}
@@ -9,9 +9,7 @@ namespace Skylighting
 	Texture3D<sh2> SkylightingProbeArray : register(t50);
 #endif
 
-	const static uint3 ARRAY_DIM = uint3(256, 256, 128);
 	const static float3 ARRAY_SIZE = 4096.f * 3.f * float3(1, 1, 0.5);
-	const static float3 CELL_SIZE = ARRAY_SIZE / ARRAY_DIM;
 
 	float getFadeOutFactor(float3 positionMS)
 	{
@@ -36,13 +34,16 @@ namespace Skylighting
 		const static sh2 unitSH = float4(sqrt(4 * Math::PI), 0, 0, 0);
 		sh2 scaledUnitSH = unitSH / 1e-10;
 
+		const uint3 arrayDim = params.ArrayDim.xyz;
+		const float3 cellSize = ARRAY_SIZE / arrayDim;
+
 		float3 positionMSAdjusted = positionMS - params.PosOffset.xyz;
 		float3 uvw = positionMSAdjusted / ARRAY_SIZE + .5;
 
 		if (any(uvw < 0) || any(uvw > 1))
 			return scaledUnitSH;
 
-		float3 cellVxCoord = uvw * ARRAY_DIM;
+		float3 cellVxCoord = uvw * arrayDim;
 		int3 cell000 = floor(cellVxCoord - 0.5);
 		float3 trilinearPos = cellVxCoord - 0.5 - cell000;
 
@@ -55,11 +56,11 @@ namespace Skylighting
 			int3 offset = int3(i, j, k);
 			int3 cellID = cell000 + offset;
 
-			if (any(cellID < 0) || any((uint3)cellID >= ARRAY_DIM))
+			if (any(cellID < 0) || any((uint3)cellID >= arrayDim))
 				continue;
 
-			float3 cellCentreMS = cellID + 0.5 - ARRAY_DIM / 2;
-			cellCentreMS = cellCentreMS * CELL_SIZE;
+			float3 cellCentreMS = cellID + 0.5 - arrayDim / 2;
+			cellCentreMS = cellCentreMS * cellSize;
 
 			// https://handmade.network/p/75/monter/blog/p/7288-engine_work__global_illumination_with_irradiance_probes
 			// basic tangent checks
@@ -71,7 +72,7 @@ namespace Skylighting
 			float3 trilinearWeights = 1 - abs(offset - trilinearPos);
 			float w = trilinearWeights.x * trilinearWeights.y * trilinearWeights.z * tangentWeight;
 
-			uint3 cellTexID = (cellID + params.ArrayOrigin.xyz) % ARRAY_DIM;
+			uint3 cellTexID = (cellID + params.ArrayOrigin.xyz) % arrayDim;
 			sh2 probe = SphericalHarmonics::Scale(probeArray[cellTexID], w);
 
 			sum = SphericalHarmonics::Add(sum, probe);
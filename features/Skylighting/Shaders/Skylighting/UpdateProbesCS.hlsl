@@ -14,28 +14,35 @@ SamplerState samplerPointClamp : register(s0);
 	const static sh2 unitSH = float4(sqrt(4.0 * Math::PI), 0, 0, 0);
 	const SharedData::SkylightingSettings settings = SharedData::skylightingSettings;
 
-	uint3 cellID = (int3(dtid) - settings.ArrayOrigin.xyz) % Skylighting::ARRAY_DIM;
-	bool isValid = all(cellID >= max(0, settings.ValidMargin.xyz)) && all(cellID <= Skylighting::ARRAY_DIM - 1 + min(0, settings.ValidMargin.xyz));  // check if the cell is newly added
+	const uint3 arrayDim = settings.ArrayDim.xyz;
+	if (any(dtid >= arrayDim))
+		return;
 
-	float3 cellCentreMS = cellID + 0.5 - Skylighting::ARRAY_DIM / 2;
-	cellCentreMS = cellCentreMS / Skylighting::ARRAY_DIM * Skylighting::ARRAY_SIZE + settings.PosOffset.xyz;
+	uint3 cellID = (int3(dtid) - settings.ArrayOrigin.xyz) % arrayDim;
+	bool isValid = all(cellID >= max(0, settings.ValidMargin.xyz)) && all(cellID <= arrayDim - 1 + min(0, settings.ValidMargin.xyz));  // check if the cell is newly added
+
+	float3 cellCentreMS = cellID + 0.5 - arrayDim / 2;
+	cellCentreMS = cellCentreMS / arrayDim * Skylighting::ARRAY_SIZE + settings.PosOffset.xyz;
 
 	float3 cellCentreOS = mul(settings.OcclusionViewProj, float4(cellCentreMS, 1)).xyz;
 	cellCentreOS.y = -cellCentreOS.y;
 	float2 occlusionUV = cellCentreOS.xy * 0.5 + 0.5;
 
 	if (all(occlusionUV > 0) && all(occlusionUV < 1)) {
-		uint accumFrames = isValid ? (outAccumFramesArray[dtid] + 1) : 1;
-		if (accumFrames < fadeInThreshold) {
+		uint prevAccumFrames = isValid ? outAccumFramesArray[dtid] : 0;
+		if (prevAccumFrames < fadeInThreshold) {
+			// the sample stands in for every frame since the previous update
+			uint accumFrames = min(prevAccumFrames + max(settings.AccumFrames, 1), (uint)fadeInThreshold);
+
 			float occlusionDepth = srcOcclusionDepth.SampleLevel(samplerPointClamp, occlusionUV, 0);
 			float visibility = saturate((occlusionDepth + 0.0005 - cellCentreOS.z) * 1024);
 
 			sh2 occlusionSH = SphericalHarmonics::Scale(SphericalHarmonics::Evaluate(settings.OcclusionDir.xyz), visibility * 4.0 * Math::PI);  // 4 pi from monte carlo
 			if (isValid) {
-				float lerpFactor = rcp(accumFrames);
+				float lerpFactor = float(accumFrames - prevAccumFrames) / accumFrames;
 				sh2 prevProbeSH = unitSH;
-				if (accumFrames > 1)
-					prevProbeSH += (outProbeArray[dtid] - unitSH) * fadeInThreshold / min(fadeInThreshold, accumFrames - 1);  // inverse confidence
+				if (prevAccumFrames > 0)
+					prevProbeSH += (outProbeArray[dtid] - unitSH) * fadeInThreshold / prevAccumFrames;  // inverse confidence
 				occlusionSH = SphericalHarmonics::Add(SphericalHarmonics::Scale(prevProbeSH, 1 - lerpFactor), SphericalHarmonics::Scale(occlusionSH, lerpFactor));
 			}
 			occlusionSH = lerp(unitSH, occlusionSH, min(fadeInThreshold, accumFrames) / fadeInThreshold);  // confidence fade in
@@ -1,6 +1,7 @@
 namespace TerrainShadows
 {
 	Texture2D<float2> ShadowHeightTexture : register(t60);
+	Texture2D<float2> OverviewShadowHeightTexture : register(t61);  // whole heightmap, downsampled, when only a window of it is resident
 
 	float2 GetTerrainShadowUV(float2 xy)
 	{
@@ -21,7 +22,15 @@ namespace TerrainShadows
 	{
 		if (SharedData::terraOccSettings.EnableTerrainShadow) {
 			float2 terraOccUV = GetTerrainShadowUV(worldPos.xy);
-			float2 shadowHeight = GetTerrainZ(ShadowHeightTexture.SampleLevel(samp, terraOccUV, 0));
+			float2 shadowHeight;
+			if (any(terraOccUV < 0) || any(terraOccUV > 1)) {  // outside the resident window
+				float2 overviewUV = worldPos.xy * SharedData::terraOccSettings.OverviewScale + SharedData::terraOccSettings.OverviewOffset;
+				if (any(overviewUV < 0) || any(overviewUV > 1))
+					return 1.0;
+				shadowHeight = GetTerrainZ(OverviewShadowHeightTexture.SampleLevel(samp, overviewUV, 0));
+			} else {
+				shadowHeight = GetTerrainZ(ShadowHeightTexture.SampleLevel(samp, terraOccUV, 0));
+			}
 			float shadowFraction = saturate((worldPos.z - shadowHeight.y) / (shadowHeight.x - shadowHeight.y));
 			return shadowFraction;
 		}
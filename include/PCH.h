@@ -91,6 +91,8 @@ namespace stl
 
 namespace logger = SKSE::log;
 
+#include "AsyncLog.h"
+
 namespace util
 {
 	using SKSE::stl::report_and_fail;
@@ -59,6 +59,8 @@ namespace SharedData
 		float3 Scale;
 		float2 ZRange;
 		float2 Offset;
+		float2 OverviewScale;
+		float2 OverviewOffset;
 	};
 
 	struct LightLimitFixSettings
@@ -122,10 +124,12 @@ namespace SharedData
 		float4 PosOffset;   // xyz: cell origin in camera model space
 		uint4 ArrayOrigin;  // xyz: array origin
 		int4 ValidMargin;
+		uint4 ArrayDim;  // xyz: probe count
 
 		float MinDiffuseVisibility;
 		float MinSpecularVisibility;
-		uint2 pad0;
+		uint AccumFrames;  // frames since the previous probe update
+		uint pad0;
 	};
 
 	cbuffer FeatureData : register(b6)
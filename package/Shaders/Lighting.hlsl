@@ -2123,7 +2123,7 @@ PS_OUTPUT main(PS_INPUT input, bool frontFace
 	{
 		LightLimitFix::Light light;
 		if (lightIndex < LightLimitFix::NumStrictLights) {
-			light = LightLimitFix::StrictLights[lightIndex];
+			light = LightLimitFix::strictLights[LightLimitFix::StrictLightsOffset + lightIndex];
 		} else {
 			uint clusteredLightIndex = LightLimitFix::lightList[lightOffset + (lightIndex - LightLimitFix::NumStrictLights)];
 			light = LightLimitFix::lights[clusteredLightIndex];
@@ -0,0 +1,182 @@
+#include "AsyncLog.h"
+
+static std::shared_ptr<AsyncRingSink> defaultSinkOwner;
+static std::atomic<AsyncRingSink*> defaultSink = nullptr;
+
+AsyncRingSink::AsyncRingSink(std::shared_ptr<spdlog::sinks::sink> a_target, size_t a_capacity, spdlog::level::level_enum a_keepLevel, spdlog::level::level_enum a_syncLevel) :
+	target(std::move(a_target)), keepLevel(a_keepLevel), syncLevel(a_syncLevel), ring(std::max<size_t>(a_capacity, 1))
+{
+	worker = std::thread([this] { WorkerLoop(); });
+}
+
+AsyncRingSink::~AsyncRingSink()
+{
+	{
+		std::lock_guard lock(queueMutex);
+		stopping = true;
+	}
+	queueChanged.notify_all();
+	if (worker.joinable())
+		worker.join();
+	FlushNow();
+}
+
+void AsyncRingSink::log(const spdlog::details::log_msg& a_msg)
+{
+	Entry entry{ spdlog::details::log_msg_buffer(a_msg), {} };
+	if (a_msg.level >= syncLevel || !Push(std::move(entry)))
+		WriteSynchronously(std::move(entry));
+}
+
+void AsyncRingSink::Post(spdlog::level::level_enum a_level, std::string_view a_loggerName, const std::source_location& a_location, std::function<std::string()> a_format)
+{
+	if (!should_log(a_level))
+		return;
+
+	spdlog::details::log_msg message(spdlog::source_loc{ a_location.file_name(), (int)a_location.line(), a_location.function_name() }, a_loggerName, a_level, {});
+	Entry entry{ spdlog::details::log_msg_buffer(message), std::move(a_format) };
+	if (a_level >= syncLevel || !Push(std::move(entry)))
+		WriteSynchronously(std::move(entry));
+}
+
+bool AsyncRingSink::Push(Entry&& a_entry)
+{
+	{
+		std::lock_guard lock(queueMutex);
+		if (count == ring.size()) {
+			if (a_entry.message.level >= keepLevel)
+				return false;
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		ring[(head + count) % ring.size()] = std::move(a_entry);
+		count++;
+	}
+	queueChanged.notify_one();
+	return true;
+}
+
+void AsyncRingSink::WriteSynchronously(Entry&& a_entry)
+{
+	std::lock_guard lock(writeMutex);
+	WriteQueued();
+	Write(a_entry);
+	target->flush();
+}
+
+void AsyncRingSink::Write(Entry& a_entry)
+{
+	if (!a_entry.format) {
+		target->log(a_entry.message);
+		return;
+	}
+
+	spdlog::details::log_msg message = a_entry.message;
+	std::string payload;
+	try {
+		payload = a_entry.format();
+	} catch (const std::exception& e) {
+		payload = fmt::format("<log format error: {}>", e.what());
+	}
+	message.payload = payload;
+	target->log(message);
+}
+
+// Caller holds writeMutex
+void AsyncRingSink::WriteQueued()
+{
+	while (true) {
+		Entry entry;
+		{
+			std::lock_guard lock(queueMutex);
+			if (!count)
+				break;
+			entry = std::move(ring[head]);
+			head = (head + 1) % ring.size();
+			count--;
+		}
+		Write(entry);
+	}
+	ReportDropped();
+}
+
+// Caller holds writeMutex
+void AsyncRingSink::ReportDropped()
+{
+	size_t current = dropped.load(std::memory_order_relaxed);
+	if (current == reportedDropped)
+		return;
+
+	std::string payload = fmt::format("{} log messages dropped while the log queue was full", current - reportedDropped);
+	spdlog::details::log_msg message(spdlog::source_loc{}, spdlog::string_view_t{}, spdlog::level::warn, payload);
+	target->log(message);
+	reportedDropped = current;
+}
+
+void AsyncRingSink::flush()
+{
+	{
+		std::lock_guard lock(queueMutex);
+		flushRequested = true;
+	}
+	queueChanged.notify_one();
+}
+
+void AsyncRingSink::FlushNow(std::chrono::milliseconds a_timeout)
+{
+	std::unique_lock lock(writeMutex, a_timeout);
+	if (lock.owns_lock())
+		WriteQueued();
+	target->flush();
+}
+
+void AsyncRingSink::set_pattern(const std::string& a_pattern)
+{
+	std::lock_guard lock(writeMutex);
+	target->set_pattern(a_pattern);
+}
+
+void AsyncRingSink::set_formatter(std::unique_ptr<spdlog::formatter> a_formatter)
+{
+	std::lock_guard lock(writeMutex);
+	target->set_formatter(std::move(a_formatter));
+}
+
+void AsyncRingSink::WorkerLoop()
+{
+	bool unflushed = false;
+	while (true) {
+		bool flush = false;
+		{
+			std::unique_lock lock(queueMutex);
+			// Messages below the logger's flush level are flushed at least once per interval
+			if (!queueChanged.wait_for(lock, FlushInterval, [&] { return count || flushRequested || stopping; })) {
+				if (!std::exchange(unflushed, false))
+					continue;
+				flushRequested = true;
+			}
+			if (stopping && !count)
+				return;
+			flush = std::exchange(flushRequested, false);
+		}
+
+		std::lock_guard lock(writeMutex);
+		WriteQueued();
+		if (flush)
+			target->flush();
+		unflushed = !flush;
+	}
+}
+
+// Not meant to race with logging, set once after the logger is created and cleared at shutdown
+void AsyncRingSink::SetDefault(std::shared_ptr<AsyncRingSink> a_sink)
+{
+	defaultSink.store(a_sink.get(), std::memory_order_release);
+	defaultSinkOwner = std::move(a_sink);
+}
+
+AsyncRingSink* AsyncRingSink::GetDefault()
+{
+	return defaultSink.load(std::memory_order_acquire);
+}
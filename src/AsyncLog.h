@@ -0,0 +1,154 @@
+#pragma once
+
+#include <condition_variable>
+#include <source_location>
+#include <tuple>
+
+#include <spdlog/sinks/sink.h>
+
+/**
+ * spdlog sink that hands messages to a worker thread through a bounded ring, so logging never waits on the disk.
+ *
+ * Overflow policy: while the ring is full, messages below the keep level are dropped and counted, the worker reports the
+ * count once it catches up. Messages at or above it are never dropped, the caller writes the queued messages and its own
+ * synchronously instead. Messages at or above the sync level are always written synchronously, since they usually come
+ * right before report_and_fail or a crash. FlushNow writes whatever is queued from the calling thread, for crash handlers.
+ *
+ * Deferred messages keep copies of their arguments and are formatted on the worker, see DeferredLog.
+ */
+class AsyncRingSink final : public spdlog::sinks::sink
+{
+public:
+	AsyncRingSink(std::shared_ptr<spdlog::sinks::sink> a_target, size_t a_capacity,
+		spdlog::level::level_enum a_keepLevel = spdlog::level::warn, spdlog::level::level_enum a_syncLevel = spdlog::level::critical);
+	~AsyncRingSink() override;
+
+	AsyncRingSink(const AsyncRingSink&) = delete;
+	AsyncRingSink& operator=(const AsyncRingSink&) = delete;
+
+	void log(const spdlog::details::log_msg& a_msg) override;
+
+	// Asks the worker to flush the target once it wrote what is queued, does not wait
+	void flush() override;
+
+	void set_pattern(const std::string& a_pattern) override;
+	void set_formatter(std::unique_ptr<spdlog::formatter> a_formatter) override;
+
+	// Queues a message whose payload is built by a_format on the worker
+	void Post(spdlog::level::level_enum a_level, std::string_view a_loggerName, const std::source_location& a_location, std::function<std::string()> a_format);
+
+	/**
+	 * Writes everything queued from the calling thread and flushes the target.
+	 * Gives up after a_timeout if the worker is stuck writing, e.g. when it is the thread that crashed.
+	 */
+	void FlushNow(std::chrono::milliseconds a_timeout = std::chrono::milliseconds(500));
+
+	size_t GetDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+	// Sink used by DeferredLog, messages are formatted in place and logged directly while none is set
+	static void SetDefault(std::shared_ptr<AsyncRingSink> a_sink);
+	static AsyncRingSink* GetDefault();
+
+private:
+	struct Entry
+	{
+		spdlog::details::log_msg_buffer message;
+		std::function<std::string()> format;  // set for deferred messages, their payload is empty until written
+	};
+
+	bool Push(Entry&& a_entry);
+	void WriteSynchronously(Entry&& a_entry);
+	void Write(Entry& a_entry);
+	void WriteQueued();
+	void ReportDropped();
+	void WorkerLoop();
+
+	static constexpr auto FlushInterval = std::chrono::seconds(1);
+
+	std::shared_ptr<spdlog::sinks::sink> target;
+	spdlog::level::level_enum keepLevel;
+	spdlog::level::level_enum syncLevel;
+
+	// Held while entries are taken from the ring and written, keeps the file in queue order
+	std::timed_mutex writeMutex;
+
+	std::mutex queueMutex;
+	std::condition_variable queueChanged;
+	std::vector<Entry> ring;
+	size_t head = 0;
+	size_t count = 0;
+	bool flushRequested = false;
+	bool stopping = false;
+
+	std::atomic<size_t> dropped = 0;
+	size_t reportedDropped = 0;
+
+	std::thread worker;
+};
+
+/**
+ * Logging with the level checked before the arguments are evaluated and the formatting done on the AsyncRingSink worker.
+ * Arguments are copied, strings and string views become std::string so nothing dangles until the worker formats them.
+ */
+namespace DeferredLog
+{
+	namespace detail
+	{
+		template <class T>
+		auto Capture(T&& a_value)
+		{
+			using Value = std::remove_cvref_t<T>;
+			if constexpr (std::is_convertible_v<const Value&, std::string_view> && !std::is_same_v<Value, std::string>)
+				return std::string(std::string_view(a_value));
+			else
+				return Value(std::forward<T>(a_value));
+		}
+
+		template <class... Args>
+		void Post(spdlog::level::level_enum a_level, const std::source_location& a_location, fmt::format_string<Args...> a_fmt, Args&&... a_args)
+		{
+			auto log = spdlog::default_logger_raw();
+			auto sink = AsyncRingSink::GetDefault();
+			if (!sink) {
+				log->log(spdlog::source_loc{ a_location.file_name(), (int)a_location.line(), a_location.function_name() }, a_level, a_fmt, std::forward<Args>(a_args)...);
+				return;
+			}
+
+			sink->Post(a_level, log->name(), a_location,
+				[format = fmt::string_view(a_fmt), arguments = std::make_tuple(Capture(std::forward<Args>(a_args))...)]() {
+					return std::apply([&](const auto&... a_arguments) { return fmt::vformat(format, fmt::make_format_args(a_arguments...)); }, arguments);
+				});
+		}
+	}
+
+#define DEFERRED_LOG_LEVEL(a_level)                                                                                                                               \
+	template <class... Args>                                                                                                                                      \
+	struct a_level                                                                                                                                                \
+	{                                                                                                                                                             \
+		a_level(fmt::format_string<Args...> a_fmt, Args&&... a_args, std::source_location a_location = std::source_location::current())                        \
+		{                                                                                                                                                         \
+			detail::Post(spdlog::level::a_level, a_location, a_fmt, std::forward<Args>(a_args)...);                                                               \
+		}                                                                                                                                                         \
+	};                                                                                                                                                            \
+	template <class... Args>                                                                                                                                      \
+	a_level(fmt::format_string<Args...>, Args&&...) -> a_level<Args...>;
+
+	DEFERRED_LOG_LEVEL(trace)
+	DEFERRED_LOG_LEVEL(debug)
+	DEFERRED_LOG_LEVEL(info)
+
+#undef DEFERRED_LOG_LEVEL
+}
+
+// Level-checked logging for hot paths, the arguments are only evaluated when the message will be written and formatted off the calling thread
+#define LOG_ENABLED(a_level) (spdlog::default_logger_raw()->should_log(spdlog::level::a_level))
+#define LOG_TRACE(...)                         \
+	do {                                       \
+		if (LOG_ENABLED(trace))                \
+			DeferredLog::trace(__VA_ARGS__);   \
+	} while (0)
+#define LOG_DEBUG(...)                         \
+	do {                                       \
+		if (LOG_ENABLED(debug))                \
+			DeferredLog::debug(__VA_ARGS__);   \
+	} while (0)
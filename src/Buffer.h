@@ -138,13 +138,14 @@ public:
 		uavs.push_back(uav);
 	}
 
-	void Update(void const* src_data, [[maybe_unused]] size_t data_size)
+	// Writes the first data_size bytes, the rest of the buffer is left undefined by the discard
+	void Update(void const* src_data, size_t data_size)
 	{
 		ID3D11DeviceContext* ctx = reinterpret_cast<ID3D11DeviceContext*>(RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().context);
 		D3D11_MAPPED_SUBRESOURCE mapped_buffer{};
 		ZeroMemory(&mapped_buffer, sizeof(D3D11_MAPPED_SUBRESOURCE));
 		DX::ThrowIfFailed(ctx->Map(resource.get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &mapped_buffer));
-		memcpy(mapped_buffer.pData, src_data, desc.ByteWidth);
+		memcpy(mapped_buffer.pData, src_data, std::min<size_t>(data_size, desc.ByteWidth));
 		ctx->Unmap(resource.get(), 0);
 	}
 	template <typename T>
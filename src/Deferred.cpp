@@ -1,5 +1,6 @@
 #include "Deferred.h"
 
+#include "Profiler.h"
 #include "ShaderCache.h"
 #include "State.h"
 #include "TruePBR.h"
@@ -230,9 +231,18 @@ void Deferred::PrepassPasses()
 	stateUpdateFlags.set(RE::BSGraphics::ShaderFlags::DIRTY_RENDERTARGET);  // Run OMSetRenderTargets again
 
 	TruePBR::GetSingleton()->PrePass();
-	for (auto* feature : Feature::GetFeatureList()) {
-		if (feature->loaded) {
-			feature->Prepass();
+
+	const auto& features = Feature::GetFeatureList();
+	static std::vector<Profiler::ScopeId> prepassScopes;
+	if (prepassScopes.empty()) {
+		for (auto* feature : features)
+			prepassScopes.push_back(Profiler::GetSingleton()->RegisterScope(std::format("{}::Prepass", feature->GetShortName())));
+	}
+
+	for (size_t i = 0; i < features.size(); i++) {
+		if (features[i]->loaded) {
+			Profiler::CPUScope scope(prepassScopes[i]);
+			features[i]->Prepass();
 		}
 	}
 }
@@ -307,6 +317,7 @@ void Deferred::StartDeferred()
 void Deferred::DeferredPasses()
 {
 	ZoneScoped;
+	PROFILE_CPU_SCOPE("Deferred::DeferredPasses");
 	TracyD3D11Zone(State::GetSingleton()->tracyCtx, "Deferred");
 
 	auto renderer = RE::BSGraphics::Renderer::GetSingleton();
@@ -0,0 +1,85 @@
+#pragma once
+
+/**
+ * Fixed size journal of small events, posted from any thread and drained by a single consumer.
+ *
+ * Each entry is a seqlock: the sequence is cleared while an event is written and set to its index + 1 after,
+ * the consumer reads the sequence, copies the event and reads the sequence again.
+ * A sequence that changed while copying means a producer lapped the consumer and overwrote the entry,
+ * the copy may be torn so it is counted as dropped rather than consumed.
+ * The event is stored as relaxed atomic words so the racing copy is well defined.
+ */
+template <class T, uint32_t Size>
+class EventJournal
+{
+public:
+	static_assert(std::is_trivially_copyable_v<T>);
+
+	// Any thread
+	void Post(const T& a_event)
+	{
+		uint32_t words[Words]{};
+		std::memcpy(words, &a_event, sizeof(T));
+
+		uint32_t index = head.fetch_add(1, std::memory_order_relaxed);
+		auto& entry = entries[index % Size];
+		entry.sequence.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (uint32_t i = 0; i < Words; i++)
+			entry.words[i].store(words[i], std::memory_order_relaxed);
+		entry.sequence.store(index + 1, std::memory_order_release);
+	}
+
+	/**
+	 * Calls a_consume(const T&) for every event posted since the last drain, in posting order.
+	 * Stops at an event that is still being written, it is picked up by the next drain.
+	 * Consumer thread only.
+	 * @return Events overwritten before they could be read.
+	 */
+	template <class F>
+	uint32_t Drain(F&& a_consume)
+	{
+		uint32_t dropped = 0;
+		uint32_t end = head.load(std::memory_order_acquire);
+		for (; tail != end; tail++) {
+			const auto& entry = entries[tail % Size];
+			uint32_t sequence = entry.sequence.load(std::memory_order_acquire);
+			if (sequence != tail + 1) {
+				// Still being written, or cleared by a newer event that is
+				if (sequence == 0 ? end - tail <= Size : (int32_t)(sequence - (tail + 1)) < 0)
+					break;
+				// Overwritten by a newer event
+				dropped++;
+				continue;
+			}
+
+			uint32_t words[Words];
+			for (uint32_t i = 0; i < Words; i++)
+				words[i] = entry.words[i].load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (entry.sequence.load(std::memory_order_relaxed) != sequence) {
+				// Overwritten while copying
+				dropped++;
+				continue;
+			}
+
+			T event;
+			std::memcpy(&event, words, sizeof(T));
+			a_consume(event);
+		}
+		return dropped;
+	}
+
+private:
+	static constexpr uint32_t Words = (uint32_t)((sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+
+	struct Entry
+	{
+		std::atomic<uint32_t> sequence = 0;
+		std::array<std::atomic<uint32_t>, Words> words{};
+	};
+
+	std::array<Entry, Size> entries;
+	std::atomic<uint32_t> head = 0;
+	uint32_t tail = 0;
+};
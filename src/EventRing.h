@@ -0,0 +1,46 @@
+#pragma once
+
+/**
+ * Single producer, single consumer ring of events.
+ * Push never blocks, events are dropped and counted while the ring is full.
+ */
+template <class T, uint32_t Size>
+class EventRing
+{
+public:
+	// Producer thread only, false when the event was dropped
+	bool Push(const T& a_event)
+	{
+		uint32_t current = head.load(std::memory_order_relaxed);
+		if (current - tail.load(std::memory_order_acquire) >= Size) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		events[current % Size] = a_event;
+		head.store(current + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Calls a_consume(const T&) for every pushed event, in order.
+	 * Consumer thread only.
+	 * @return Events dropped since the last drain.
+	 */
+	template <class F>
+	uint32_t Drain(F&& a_consume)
+	{
+		uint32_t current = tail.load(std::memory_order_relaxed);
+		uint32_t end = head.load(std::memory_order_acquire);
+		for (; current != end; current++)
+			a_consume(events[current % Size]);
+		tail.store(current, std::memory_order_release);
+		return dropped.exchange(0, std::memory_order_relaxed);
+	}
+
+private:
+	std::array<T, Size> events;
+	std::atomic<uint32_t> head = 0;
+	std::atomic<uint32_t> tail = 0;
+	std::atomic<uint32_t> dropped = 0;
+};
@@ -11,24 +11,46 @@
 #include "TruePBR.h"
 
 template <class... Ts>
-std::pair<unsigned char*, size_t> _GetFeatureBufferData(Ts... feat_datas)
+struct FeatureBufferBlock
 {
-	size_t totalSize = (... + sizeof(Ts));
-	auto data = new unsigned char[totalSize];
-	size_t offset = 0;
+	static constexpr size_t size = (... + sizeof(Ts));
 
-	([&] {
-		*((decltype(feat_datas)*)(data + offset)) = feat_datas;
-		offset += sizeof(decltype(feat_datas));
-	}(),
-		...);
+	alignas(16) unsigned char data[size]{};
+	bool initialized = false;
 
-	return std::make_pair(data, totalSize);
-}
+	// Only sections whose contents differ are copied, the block stays valid between frames
+	bool Update(const Ts&... a_featureDatas)
+	{
+		bool dirty = !initialized;
+		size_t offset = 0;
+
+		([&] {
+			if (dirty || memcmp(data + offset, &a_featureDatas, sizeof(Ts)) != 0) {
+				memcpy(data + offset, &a_featureDatas, sizeof(Ts));
+				dirty = true;
+			}
+			offset += sizeof(Ts);
+		}(),
+			...);
+
+		initialized = true;
+		return dirty;
+	}
+};
+
+static FeatureBufferBlock<
+	GrassLighting::Settings,
+	ExtendedMaterials::Settings,
+	DynamicCubemaps::Settings,
+	decltype(std::declval<TerrainShadows>().GetCommonBufferData()),
+	decltype(std::declval<LightLimitFix>().GetCommonBufferData()),
+	decltype(std::declval<WetnessEffects>().GetCommonBufferData()),
+	decltype(std::declval<Skylighting>().GetCommonBufferData())>
+	featureBufferBlock;
 
-std::pair<unsigned char*, size_t> GetFeatureBufferData()
+bool UpdateFeatureBufferData()
 {
-	return _GetFeatureBufferData(
+	return featureBufferBlock.Update(
 		GrassLighting::GetSingleton()->settings,
 		ExtendedMaterials::GetSingleton()->settings,
 		DynamicCubemaps::GetSingleton()->settings,
@@ -36,4 +58,9 @@ std::pair<unsigned char*, size_t> GetFeatureBufferData()
 		LightLimitFix::GetSingleton()->GetCommonBufferData(),
 		WetnessEffects::GetSingleton()->GetCommonBufferData(),
 		Skylighting::GetSingleton()->GetCommonBufferData());
-}
\ No newline at end of file
+}
+
+std::span<const unsigned char> GetFeatureBufferData()
+{
+	return { featureBufferBlock.data, featureBufferBlock.size };
+}
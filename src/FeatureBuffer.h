@@ -1,3 +1,6 @@
 #pragma once
 
-std::pair<unsigned char*, size_t> GetFeatureBufferData();
\ No newline at end of file
+// Repacks the feature data into a persistent block, returns true if any section changed since the last call
+bool UpdateFeatureBufferData();
+
+std::span<const unsigned char> GetFeatureBufferData();
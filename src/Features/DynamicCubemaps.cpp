@@ -1,4 +1,6 @@
 #include "DynamicCubemaps.h"
+#include "FrameBudget.h"
+#include "Profiler.h"
 #include "ShaderCache.h"
 
 #include "State.h"
@@ -124,6 +126,15 @@ void DynamicCubemaps::DrawSettings()
 			}
 			ImGui::TreePop();
 		}
+
+		ImGui::Checkbox("Persist Interior Captures", &persistCaptures);
+		if (auto _tt = Util::HoverTooltipWrapper()) {
+			ImGui::Text(
+				"Saves the captured environment of interiors when leaving them through a loading screen, and restores it when coming back. "
+				"The cache of a previous load order is deleted the next time an interior is saved, and the cache is limited to %llu MB.",
+				MaxCaptureCacheSize >> 20);
+		}
+
 		if (REL::Module::IsVR()) {
 			if (ImGui::TreeNodeEx("Advanced VR Settings", ImGuiTreeNodeFlags_DefaultOpen)) {
 				Util::RenderImGuiSettingsTree(iniVRCubeMapSettings, "VR");
@@ -142,6 +153,8 @@ void DynamicCubemaps::DrawSettings()
 void DynamicCubemaps::LoadSettings(json& o_json)
 {
 	settings = o_json;
+	if (o_json.contains("PersistCaptures") && o_json["PersistCaptures"].is_boolean())
+		persistCaptures = o_json["PersistCaptures"];
 	Util::LoadGameSettings(SSRSettings);
 	if (REL::Module::IsVR()) {
 		Util::LoadGameSettings(iniVRCubeMapSettings);
@@ -152,6 +165,7 @@ void DynamicCubemaps::LoadSettings(json& o_json)
 void DynamicCubemaps::SaveSettings(json& o_json)
 {
 	o_json = settings;
+	o_json["PersistCaptures"] = persistCaptures;
 	Util::SaveGameSettings(SSRSettings);
 	if (REL::Module::IsVR()) {
 		Util::SaveGameSettings(iniVRCubeMapSettings);
@@ -161,6 +175,7 @@ void DynamicCubemaps::SaveSettings(json& o_json)
 void DynamicCubemaps::RestoreDefaultSettings()
 {
 	settings = {};
+	persistCaptures = true;
 	Util::ResetGameSettingsToDefaults(SSRSettings);
 	if (REL::Module::IsVR()) {
 		Util::ResetGameSettingsToDefaults(iniVRCubeMapSettings);
@@ -202,10 +217,13 @@ RE::BSEventNotifyControl MenuOpenCloseEventHandler::ProcessEvent(const RE::MenuO
 {
 	// When entering a new cell, reset the capture
 	if (a_event->menuName == RE::LoadingMenu::MENU_NAME) {
-		if (!a_event->opening) {
-			auto dynamicCubemaps = DynamicCubemaps::GetSingleton();
+		auto dynamicCubemaps = DynamicCubemaps::GetSingleton();
+		if (a_event->opening) {
+			dynamicCubemaps->SaveCaptureCache();
+		} else {
 			dynamicCubemaps->resetCapture[0] = true;
 			dynamicCubemaps->resetCapture[1] = true;
+			dynamicCubemaps->pendingCacheRestore = true;
 		}
 	}
 	return RE::BSEventNotifyControl::kContinue;
@@ -324,13 +342,16 @@ void DynamicCubemaps::UpdateCubemapCapture(bool a_reflections)
 		context->ClearUnorderedAccessViewFloat(uavs[1], clearColor);
 		context->ClearUnorderedAccessViewFloat(uavs[2], clearColor);
 		resetCapture[index] = false;
+		if (!a_reflections)
+			captureSteps = 0;
 	}
+	if (!a_reflections)
+		captureSteps++;
 
 	context->CSSetUnorderedAccessViews(0, 3, uavs, nullptr);
 
 	UpdateCubemapCB updateData{};
 
-	static float3 cameraPreviousPosAdjust[2] = { { 0, 0, 0 }, { 0, 0, 0 } };
 	updateData.CameraPreviousPosAdjust = cameraPreviousPosAdjust[index];
 
 	auto eyePosition = Util::GetEyePosition(0);
@@ -455,6 +476,129 @@ void DynamicCubemaps::Irradiance(bool a_reflections)
 	context->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
 }
 
+std::filesystem::path DynamicCubemaps::GetCaptureCachePath() const
+{
+	auto player = RE::PlayerCharacter::GetSingleton();
+	auto cell = player ? player->GetParentCell() : nullptr;
+	if (!cell || !cell->IsInteriorCell())
+		return {};
+
+	auto lightingTemplate = cell->GetRuntimeData().lightingTemplate;
+	return std::filesystem::path(State::GetSingleton()->folderPath) / "CubemapCache" / std::format("{:016X}", Util::GetLoadOrderHash()) /
+	       std::format("{:08X}_{:08X}", cell->GetFormID(), lightingTemplate ? lightingTemplate->GetFormID() : 0);
+}
+
+static constexpr std::array<const wchar_t*, 3> CaptureCacheFiles = { L"Capture.dds", L"Raw.dds", L"Position.dds" };
+
+void DynamicCubemaps::SaveCaptureCache()
+{
+	// Only the interior capture is kept, and only once it had time to see most of the room
+	if (!persistCaptures || captureSteps < MinCaptureSteps || !envCaptureTexture)
+		return;
+
+	auto path = GetCaptureCachePath();
+	if (path.empty())
+		return;
+
+	Profiler::StutterScope stutter(Profiler::StutterCause::CubemapCache);
+
+	auto& device = State::GetSingleton()->device;
+	auto& context = State::GetSingleton()->context;
+	std::array<Texture2D*, 3> textures = { envCaptureTexture, envCaptureRawTexture, envCapturePositionTexture };
+
+	std::error_code ec;
+	try {
+		std::filesystem::create_directories(path);
+		for (size_t i = 0; i < textures.size(); i++) {
+			DirectX::ScratchImage image;
+			DX::ThrowIfFailed(CaptureTexture(device, context, textures[i]->resource.get(), image));
+			DX::ThrowIfFailed(SaveToDDSFile(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX::DDS_FLAGS::DDS_FLAGS_NONE, (path / CaptureCacheFiles[i]).c_str()));
+		}
+
+		// Positions are stored relative to the camera, written last so a complete capture always has it
+		const auto& cameraPosition = cameraPreviousPosAdjust[0];
+		json info = { { "CameraPosition", { cameraPosition.x, cameraPosition.y, cameraPosition.z } } };
+		std::ofstream file(path / "Capture.json");
+		file << info.dump();
+	} catch (const std::exception& e) {
+		logger::warn("Failed to write dynamic cubemap cache {}: {}", path.string(), e.what());
+		std::filesystem::remove_all(path, ec);
+		return;
+	}
+
+	logger::debug("Saved dynamic cubemap cache {}", path.string());
+
+	// Entries are the capture directories inside the directory of the current load order
+	auto cacheDir = path.parent_path();
+	Util::RemoveStaleCacheDirectories(cacheDir.parent_path(), cacheDir.filename());
+	Util::TrimCacheDirectory(cacheDir, MaxCaptureCacheSize);
+}
+
+bool DynamicCubemaps::RestoreCaptureCache()
+{
+	if (!persistCaptures)
+		return false;
+
+	auto path = GetCaptureCachePath();
+	if (path.empty())
+		return false;
+
+	std::ifstream file(path / "Capture.json");
+	if (!file)
+		return false;
+
+	Profiler::StutterScope stutter(Profiler::StutterCause::CubemapCache);
+
+	std::array<Texture2D*, 3> textures = { envCaptureTexture, envCaptureRawTexture, envCapturePositionTexture };
+	std::array<DirectX::ScratchImage, 3> images;
+	float3 cameraPosition;
+	try {
+		json info = json::parse(file);
+		auto& position = info["CameraPosition"];
+		cameraPosition = { position[0].get<float>(), position[1].get<float>(), position[2].get<float>() };
+
+		for (size_t i = 0; i < textures.size(); i++) {
+			DX::ThrowIfFailed(LoadFromDDSFile((path / CaptureCacheFiles[i]).c_str(), DirectX::DDS_FLAGS::DDS_FLAGS_NONE, nullptr, images[i]));
+
+			// The reflection cubemap size can change with game settings
+			const auto& metadata = images[i].GetMetadata();
+			const auto& desc = textures[i]->desc;
+			if (metadata.width != desc.Width || metadata.height != desc.Height || metadata.arraySize != desc.ArraySize || metadata.mipLevels != desc.MipLevels || metadata.format != desc.Format)
+				return false;
+		}
+	} catch (const std::exception& e) {
+		// Drop the broken entry so it isn't read again on every visit
+		logger::warn("Failed to read dynamic cubemap cache {}: {}", path.string(), e.what());
+		std::error_code ec;
+		std::filesystem::remove_all(path, ec);
+		return false;
+	}
+
+	auto& context = State::GetSingleton()->context;
+	for (size_t i = 0; i < textures.size(); i++) {
+		const auto& desc = textures[i]->desc;
+		for (uint item = 0; item < desc.ArraySize; item++) {
+			for (uint mip = 0; mip < desc.MipLevels; mip++) {
+				auto image = images[i].GetImage(mip, item, 0);
+				context->UpdateSubresource(textures[i]->resource.get(), D3D11CalcSubresource(mip, item, desc.MipLevels), nullptr, image->pixels, (UINT)image->rowPitch, (UINT)image->slicePitch);
+			}
+		}
+	}
+
+	// The capture shader moves the stored positions from the cached camera to the current one
+	cameraPreviousPosAdjust[0] = cameraPosition;
+	resetCapture[0] = false;
+	captureSteps = MinCaptureSteps;
+
+	// Mark as recently used for trimming
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(path, ec))
+		std::filesystem::last_write_time(entry.path(), std::filesystem::file_time_type::clock::now(), ec);
+
+	logger::debug("Restored dynamic cubemap cache {}", path.string());
+	return true;
+}
+
 void DynamicCubemaps::UpdateCubemap()
 {
 	TracyD3D11Zone(State::GetSingleton()->tracyCtx, "Cubemap Update");
@@ -467,6 +611,20 @@ void DynamicCubemaps::UpdateCubemap()
 		recompileFlag = false;
 	}
 
+	// Go straight to inference so the restored capture shows up without waiting for a new one
+	if (pendingCacheRestore) {
+		pendingCacheRestore = false;
+		if (RestoreCaptureCache())
+			nextTask = NextTask::kInferrence;
+	}
+
+	static auto costScope = Profiler::GetSingleton()->RegisterScope("Dynamic Cubemaps - Update");
+	static auto updateTask = FrameBudget::GetSingleton()->RegisterTask("Dynamic Cubemaps - Update", 2, 2, costScope);
+	if (!FrameBudget::GetSingleton()->Request(updateTask))
+		return;
+
+	PROFILE_GPU_SCOPE("Dynamic Cubemaps - Update");
+
 	switch (nextTask) {
 	case NextTask::kCapture:
 		UpdateCubemapCapture(false);
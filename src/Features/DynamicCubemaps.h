@@ -83,6 +83,20 @@ public:
 
 	NextTask nextTask = NextTask::kCapture;
 
+	float3 cameraPreviousPosAdjust[2] = {};
+
+	// Converged captures of interiors are kept on disk per cell and lighting template, and restored when the cell is entered again
+	static constexpr uint64_t MaxCaptureCacheSize = 256ull << 20;
+	static constexpr uint MinCaptureSteps = 60;
+
+	bool persistCaptures = true;
+	uint captureSteps = 0;
+	bool pendingCacheRestore = false;
+
+	std::filesystem::path GetCaptureCachePath() const;
+	void SaveCaptureCache();
+	bool RestoreCaptureCache();
+
 	// Editor window
 
 	struct Settings
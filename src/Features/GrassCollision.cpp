@@ -1,8 +1,12 @@
 #include "GrassCollision.h"
 
+#include "Profiler.h"
 #include "State.h"
 #include "Util.h"
 
+#include <execution>
+#include <numbers>
+
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
 	GrassCollision::Settings,
 	EnableGrassCollision)
@@ -20,16 +24,13 @@ void GrassCollision::DrawSettings()
 	if (ImGui::TreeNodeEx("Statistics", ImGuiTreeNodeFlags_DefaultOpen)) {
 		ImGui::Text(std::format("Active/Total Actors : {}/{}", activeActorCount, totalActorCount).c_str());
 		ImGui::Text(std::format("Total Collisions : {}", currentCollisionCount).c_str());
+		ImGui::Text(std::format("Proxy Refreshes : {}/{}", proxyRefreshCount, proxyCache.size()).c_str());
 		ImGui::TreePop();
 	}
 }
 
-static bool GetShapeBound(RE::NiAVObject* a_node, RE::NiPoint3& centerPos, float& radius)
+static bool GetShapeBound(RE::bhkNiCollisionObject* Colliedobj, RE::NiPoint3& centerPos, float& radius)
 {
-	RE::bhkNiCollisionObject* Colliedobj = nullptr;
-	if (a_node->collisionObject)
-		Colliedobj = a_node->collisionObject->AsBhkNiCollisionObject();
-
 	if (!Colliedobj)
 		return false;
 
@@ -44,17 +45,13 @@ static bool GetShapeBound(RE::NiAVObject* a_node, RE::NiPoint3& centerPos, float
 
 		const RE::hkpShape* shape = hkpRigid->collidable.GetShape();
 		if (shape) {
-			float upExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 0.0f, 1.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			float downExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 0.0f, -1.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			auto z_extent = (upExtent + downExtent) / 2.0f;
-
-			float forwardExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 1.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			float backwardExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, -1.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			auto y_extent = (forwardExtent + backwardExtent) / 2.0f;
-
-			float leftExtent = shape->GetMaximumProjection(RE::hkVector4{ 1.0f, 0.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			float rightExtent = shape->GetMaximumProjection(RE::hkVector4{ -1.0f, 0.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			auto x_extent = (leftExtent + rightExtent) / 2.0f;
+			// Half the width of the shape along an axis
+			auto extent = [&](float x, float y, float z) {
+				return (shape->GetMaximumProjection(RE::hkVector4{ x, y, z, 0.0f }) + shape->GetMaximumProjection(RE::hkVector4{ -x, -y, -z, 0.0f })) * 0.5f * RE::bhkWorld::GetWorldScaleInverse();
+			};
+			auto x_extent = extent(1.0f, 0.0f, 0.0f);
+			auto y_extent = extent(0.0f, 1.0f, 0.0f);
+			auto z_extent = extent(0.0f, 0.0f, 1.0f);
 
 			radius = sqrtf(x_extent * x_extent + y_extent * y_extent + z_extent * z_extent);
 
@@ -65,46 +62,39 @@ static bool GetShapeBound(RE::NiAVObject* a_node, RE::NiPoint3& centerPos, float
 	return false;
 }
 
-static bool GetShapeBound(RE::bhkNiCollisionObject* Colliedobj, RE::NiPoint3& centerPos, float& radius)
+void GrassCollision::GatherProxies(RE::Actor* a_actor, ActorProxies& a_proxies)
 {
-	if (!Colliedobj)
-		return false;
-
-	RE::bhkRigidBody* bhkRigid = Colliedobj->body.get() ? Colliedobj->body.get()->AsBhkRigidBody() : nullptr;
-	RE::hkpRigidBody* hkpRigid = bhkRigid ? skyrim_cast<RE::hkpRigidBody*>(bhkRigid->referencedObject.get()) : nullptr;
-	if (bhkRigid && hkpRigid) {
-		RE::hkVector4 massCenter;
-		bhkRigid->GetCenterOfMassWorld(massCenter);
-		float massTrans[4];
-		_mm_store_ps(massTrans, massCenter.quad);
-		centerPos = RE::NiPoint3(massTrans[0], massTrans[1], massTrans[2]) * RE::bhkWorld::GetWorldScaleInverse();
-
-		const RE::hkpShape* shape = hkpRigid->collidable.GetShape();
-		if (shape) {
-			float upExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 0.0f, 1.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			float downExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 0.0f, -1.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			auto z_extent = (upExtent + downExtent) / 2.0f;
-
-			float forwardExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 1.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			float backwardExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, -1.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			auto y_extent = (forwardExtent + backwardExtent) / 2.0f;
-
-			float leftExtent = shape->GetMaximumProjection(RE::hkVector4{ 1.0f, 0.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			float rightExtent = shape->GetMaximumProjection(RE::hkVector4{ -1.0f, 0.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			auto x_extent = (leftExtent + rightExtent) / 2.0f;
-
-			radius = sqrtf(x_extent * x_extent + y_extent * y_extent + z_extent * z_extent);
-
-			return true;
+	a_proxies.spheres.clear();
+	a_proxies.position = a_proxies.currentPosition;
+	a_proxies.heading = a_proxies.currentHeading;
+	a_proxies.age = 0;
+	a_proxies.gathered = true;
+
+	auto root = a_actor->Get3D(false);
+	if (!root)
+		return;
+
+	// Offsets are stored unrotated by the heading, which turns clockwise with forward at (sin z, cos z)
+	float c = cos(a_proxies.heading);
+	float s = sin(a_proxies.heading);
+
+	RE::BSVisit::TraverseScenegraphCollision(root, [&](RE::bhkNiCollisionObject* a_object) -> RE::BSVisit::BSVisitControl {
+		RE::NiPoint3 centerPos;
+		float radius;
+		if (GetShapeBound(a_object, centerPos, radius)) {
+			auto offset = centerPos - a_proxies.position;
+			a_proxies.spheres.push_back({ offset.x * c - offset.y * s, offset.x * s + offset.y * c, offset.z, radius * 2.0f });
 		}
-	}
-
-	return false;
+		return RE::BSVisit::BSVisitControl::kContinue;
+	});
 }
 
 void GrassCollision::UpdateCollisions(PerFrame& perFrameData)
 {
+	PROFILE_CPU_SCOPE("GrassCollision::UpdateCollisions");
+
 	actorList.clear();
+	frameIndex++;
 
 	// Actor query code from po3 under MIT
 	// https://github.com/powerof3/PapyrusExtenderSSE/blob/7a73b47bc87331bec4e16f5f42f2dbc98b66c3a7/include/Papyrus/Functions/Faction.h#L24C7-L46
@@ -127,38 +117,70 @@ void GrassCollision::UpdateCollisions(PerFrame& perFrameData)
 
 	RE::NiPoint3 cameraPosition = Util::GetAverageEyePosition();
 
+	std::vector<std::pair<RE::Actor*, RE::FormID>> staleActors;
 	for (const auto actor : actorList) {
-		if (currentCollisionCount == 256)
-			break;
-		if (auto root = actor->Get3D(false)) {
-			auto position = actor->GetPosition();
-			if (cameraPosition.GetDistance(position) > 1024)  // Check against distance
+		if (!actor->Get3D(false))
+			continue;
+
+		auto position = actor->GetPosition();
+		if (cameraPosition.GetDistance(position) > 1024)  // Check against distance
+			continue;
+
+		activeActorCount++;
+
+		auto& proxies = proxyCache[actor->GetFormID()];
+		proxies.currentPosition = position;
+		proxies.currentHeading = actor->GetAngleZ();
+		proxies.lastSeen = frameIndex;
+
+		float turned = std::abs(std::remainder(proxies.currentHeading - proxies.heading, 2.0f * std::numbers::pi_v<float>));
+		if (!proxies.gathered || ++proxies.age >= ProxyMaxAge || position.GetDistance(proxies.position) > ProxyRefreshDistance || turned > ProxyRefreshAngle)
+			staleActors.push_back({ actor, actor->GetFormID() });
+	}
+
+	// Actors that left the area, inserting above may also have moved entries so pointers are only taken now
+	std::vector<RE::FormID> expired;
+	for (const auto& [formID, proxies] : proxyCache) {
+		if (proxies.lastSeen != frameIndex)
+			expired.push_back(formID);
+	}
+	for (auto formID : expired)
+		proxyCache.erase(formID);
+
+	// Traversals only read the scene graph and the havok shapes, so actors can be gathered in parallel
+	std::vector<std::pair<RE::Actor*, ActorProxies*>> refreshes;
+	for (const auto& [actor, formID] : staleActors)
+		refreshes.push_back({ actor, &proxyCache[formID] });
+	proxyRefreshCount = (uint)refreshes.size();
+	std::for_each(std::execution::par, refreshes.begin(), refreshes.end(), [](const auto& a_refresh) {
+		GatherProxies(a_refresh.first, *a_refresh.second);
+	});
+
+	collisions.clear();
+	for (const auto& [formID, proxies] : proxyCache) {
+		float c = cos(-proxies.currentHeading);
+		float s = sin(-proxies.currentHeading);
+		for (const auto& sphere : proxies.spheres) {
+			RE::NiPoint3 centerPos = proxies.currentPosition + RE::NiPoint3{ sphere.x * c - sphere.y * s, sphere.x * s + sphere.y * c, sphere.z };
+
+			// Grass is only displaced within 1024 units of the camera
+			if (cameraPosition.GetDistance(centerPos) > 1024.0f + sphere.w)
 				continue;
 
-			activeActorCount++;
-			RE::BSVisit::TraverseScenegraphCollision(root, [&](RE::bhkNiCollisionObject* a_object) -> RE::BSVisit::BSVisitControl {
-				RE::NiPoint3 centerPos;
-				float radius;
-				if (GetShapeBound(a_object, centerPos, radius)) {
-					radius *= 2.0f;
-					CollisionData data{};
-					RE::NiPoint3 eyePosition{};
-					for (int eyeIndex = 0; eyeIndex < eyeCount; eyeIndex++) {
-						eyePosition = Util::GetEyePosition(eyeIndex);
-						data.centre[eyeIndex].x = centerPos.x - eyePosition.x;
-						data.centre[eyeIndex].y = centerPos.y - eyePosition.y;
-						data.centre[eyeIndex].z = centerPos.z - eyePosition.z;
-					}
-					data.centre[0].w = radius;
-					perFrameData.collisionData[currentCollisionCount] = data;
-					currentCollisionCount++;
-					if (currentCollisionCount == 256)
-						return RE::BSVisit::BSVisitControl::kStop;
-				}
-				return RE::BSVisit::BSVisitControl::kContinue;
-			});
+			CollisionData data{};
+			RE::NiPoint3 eyePosition{};
+			for (int eyeIndex = 0; eyeIndex < eyeCount; eyeIndex++) {
+				eyePosition = Util::GetEyePosition(eyeIndex);
+				data.centre[eyeIndex].x = centerPos.x - eyePosition.x;
+				data.centre[eyeIndex].y = centerPos.y - eyePosition.y;
+				data.centre[eyeIndex].z = centerPos.z - eyePosition.z;
+			}
+			data.centre[0].w = sphere.w;
+			collisions.push_back(data);
 		}
 	}
+
+	currentCollisionCount = (uint)collisions.size();
 	perFrameData.numCollisions = currentCollisionCount;
 }
 
@@ -177,6 +199,15 @@ void GrassCollision::Update()
 
 		perFrame->Update(perFrameData);
 
+		// Grow the buffer in powers of two, only the collisions of this frame are written
+		if (collisions.size() > collisionCapacity) {
+			collisionCapacity = std::bit_ceil((uint)collisions.size());
+			collisionBuffer = std::make_unique<StructuredBuffer>(StructuredBufferDesc<CollisionData>(collisionCapacity), collisionCapacity);
+			collisionBuffer->CreateSRV();
+		}
+		if (perFrameData.numCollisions)
+			collisionBuffer->Update(collisions.data(), sizeof(CollisionData) * perFrameData.numCollisions);
+
 		updatePerFrame = false;
 	}
 
@@ -187,6 +218,9 @@ void GrassCollision::Update()
 		ID3D11Buffer* buffers[1];
 		buffers[0] = perFrame->CB();
 		context->VSSetConstantBuffers(5, ARRAYSIZE(buffers), buffers);
+
+		ID3D11ShaderResourceView* srv = collisionBuffer->SRV();
+		context->VSSetShaderResources(40, 1, &srv);
 	}
 }
 
@@ -213,6 +247,10 @@ void GrassCollision::PostPostLoad()
 void GrassCollision::SetupResources()
 {
 	perFrame = new ConstantBuffer(ConstantBufferDesc<PerFrame>());
+
+	collisionCapacity = 256;
+	collisionBuffer = std::make_unique<StructuredBuffer>(StructuredBufferDesc<CollisionData>(collisionCapacity), collisionCapacity);
+	collisionBuffer->CreateSRV();
 }
 
 void GrassCollision::Reset()
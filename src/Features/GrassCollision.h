@@ -29,27 +29,51 @@ struct GrassCollision : Feature
 
 	struct alignas(16) PerFrame
 	{
-		CollisionData collisionData[256];
 		uint numCollisions;
 		uint pad0[3];
 	};
 
+	// Collision spheres of an actor relative to its position and heading, so they follow it between refreshes
+	struct ActorProxies
+	{
+		std::vector<float4> spheres;  // xyz: offset, w: radius
+		RE::NiPoint3 position;
+		float heading = 0.0f;
+		RE::NiPoint3 currentPosition;
+		float currentHeading = 0.0f;
+		uint age = 0;
+		uint lastSeen = 0;
+		bool gathered = false;
+	};
+
+	// Walking the collision of a skeleton is the expensive part, it is only redone when the actor moved, turned or the proxies got old
+	static constexpr float ProxyRefreshDistance = 32.0f;
+	static constexpr float ProxyRefreshAngle = 0.25f;
+	static constexpr uint ProxyMaxAge = 8;
+
 	std::uint32_t totalActorCount = 0;
 	std::uint32_t activeActorCount = 0;
 	std::uint32_t currentCollisionCount = 0;
+	std::uint32_t proxyRefreshCount = 0;
 	std::vector<RE::Actor*> actorList{};
 	std::uint32_t colllisionCount = 0;
+	ankerl::unordered_dense::map<RE::FormID, ActorProxies> proxyCache;
+	uint frameIndex = 0;
 
 	Settings settings;
 
 	bool updatePerFrame = false;
 	ConstantBuffer* perFrame = nullptr;
+	std::vector<CollisionData> collisions;
+	std::unique_ptr<StructuredBuffer> collisionBuffer;
+	uint collisionCapacity = 0;
 	int eyeCount = !REL::Module::IsVR() ? 1 : 2;
 
 	virtual void SetupResources() override;
 	virtual void Reset() override;
 
 	virtual void DrawSettings() override;
+	static void GatherProxies(RE::Actor* a_actor, ActorProxies& a_proxies);
 	void UpdateCollisions(PerFrame& perFrame);
 	void Update();
 
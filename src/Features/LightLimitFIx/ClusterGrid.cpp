@@ -0,0 +1,79 @@
+#include "ClusterGrid.h"
+
+uint ClusterGridController::ClusterCount(const ClusterGrid& a_grid, uint a_width, uint a_height)
+{
+	return ((a_width + a_grid.tileSize - 1) / a_grid.tileSize) * ((a_height + a_grid.tileSize - 1) / a_grid.tileSize) * a_grid.depthSlices;
+}
+
+std::array<uint, 3> ClusterGridController::Fit(uint a_width, uint a_height)
+{
+	std::array<uint, 3> size = {
+		(a_width + grid.tileSize - 1) / grid.tileSize,
+		(a_height + grid.tileSize - 1) / grid.tileSize,
+		grid.depthSlices
+	};
+	uint clusterCount = size[0] * size[1] * size[2];
+
+	if (grid.lightIndexListSize == 0)
+		grid.lightIndexListSize = clusterCount * grid.maxClusterLights;
+	grid.lightIndexListSize = std::clamp(grid.lightIndexListSize, clusterCount * MinClusterLights, clusterCount * grid.maxClusterLights);
+
+	return size;
+}
+
+void ClusterGridController::AddStatistics(const ClusterStatistics& a_statistics)
+{
+	window.lightIndexCount = std::max(window.lightIndexCount, a_statistics.lightIndexCount);
+	window.overflowClusters = std::max(window.overflowClusters, a_statistics.overflowClusters);
+	window.maxClusterLights = std::max(window.maxClusterLights, a_statistics.maxClusterLights);
+}
+
+bool ClusterGridController::Update(uint a_lightCount, uint a_width, uint a_height)
+{
+	maxLightCount = std::max(maxLightCount, a_lightCount);
+
+	if (++windowFrames < StatisticsWindow)
+		return false;
+
+	ClusterGrid desired{};
+
+	// Tiles keep their pixel size on every resolution so the lights per cluster don't grow with it,
+	// and get smaller when even the largest per-cluster capacity overflows
+	desired.tileSize = window.maxClusterLights > MaxClusterLights ? TileSize / 2 : TileSize;
+	desired.depthSlices = maxLightCount < 128 ? 16 : (maxLightCount < 512 ? 32 : 64);
+	desired.maxClusterLights = std::clamp(std::bit_ceil(window.maxClusterLights + window.maxClusterLights / 4), MinClusterLights, MaxClusterLights);
+	desired.lightIndexListSize = std::bit_ceil(std::max(window.lightIndexCount, 1u) * 2);
+
+	const bool grow = desired.tileSize < grid.tileSize ||
+	                  desired.depthSlices > grid.depthSlices ||
+	                  desired.maxClusterLights > grid.maxClusterLights ||
+	                  window.lightIndexCount > grid.lightIndexListSize;
+
+	if (grow) {
+		// Grow straight away since lights are being dropped, but never shrink anything in the same step
+		desired.tileSize = std::min(desired.tileSize, grid.tileSize);
+		desired.depthSlices = std::max(desired.depthSlices, grid.depthSlices);
+		desired.maxClusterLights = std::max(desired.maxClusterLights, grid.maxClusterLights);
+		desired.lightIndexListSize = std::max(desired.lightIndexListSize, grid.lightIndexListSize);
+	} else if (desired.lightIndexListSize * 2 > grid.lightIndexListSize) {
+		// Only shrink the index list when it is far larger than needed
+		desired.lightIndexListSize = grid.lightIndexListSize;
+	}
+
+	uint clusterCount = ClusterCount(desired, a_width, a_height);
+	desired.lightIndexListSize = std::clamp(desired.lightIndexListSize, clusterCount * MinClusterLights, clusterCount * desired.maxClusterLights);
+
+	bool changed = false;
+	if (desired == grid) {
+		shrinkWindows = 0;
+	} else if (grow || ++shrinkWindows >= ShrinkWindows) {
+		grid = desired;
+		shrinkWindows = 0;
+		changed = true;
+	}
+
+	windowFrames = 0;
+	maxLightCount = 0;
+	window = {};
+	return changed;
+}
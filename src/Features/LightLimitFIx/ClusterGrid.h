@@ -0,0 +1,62 @@
+#pragma once
+
+// Cluster grid dimensions and capacities, resized from the statistics written by ClusterCullingCS
+struct ClusterGrid
+{
+	uint tileSize = 64;
+	uint depthSlices = 32;
+	uint maxClusterLights = 256;
+	uint lightIndexListSize = 0;
+
+	bool operator==(const ClusterGrid&) const = default;
+};
+
+// Layout of the light index counter of ClusterCullingCS
+struct ClusterStatistics
+{
+	uint lightIndexCount;
+	uint overflowClusters;
+	uint maxClusterLights;
+	uint pad0;
+};
+
+/**
+ * Picks the cluster grid from the peaks of a window of frames.
+ * The grid grows as soon as lights are dropped and only shrinks after several windows in a row asked for it.
+ */
+class ClusterGridController
+{
+public:
+	static constexpr uint TileSize = 64;
+	static constexpr uint MinClusterLights = 16;
+	static constexpr uint MaxClusterLights = 512;
+	// Frames of statistics gathered before the grid is re-evaluated
+	static constexpr uint StatisticsWindow = 60;
+	// Consecutive windows that must ask for a smaller grid before it shrinks
+	static constexpr uint ShrinkWindows = 5;
+
+	const ClusterGrid& Get() const { return grid; }
+
+	/**
+	 * Clusters along x, y and depth for a screen of a_width by a_height pixels, clamping the index list to them.
+	 */
+	std::array<uint, 3> Fit(uint a_width, uint a_height);
+
+	// Statistics read back from the GPU, several frames late
+	void AddStatistics(const ClusterStatistics& a_statistics);
+
+	/**
+	 * Called once per frame with the lights culled that frame.
+	 * @return True when the grid changed and its resources have to be recreated.
+	 */
+	bool Update(uint a_lightCount, uint a_width, uint a_height);
+
+private:
+	static uint ClusterCount(const ClusterGrid& a_grid, uint a_width, uint a_height);
+
+	ClusterGrid grid;
+	ClusterStatistics window{};
+	uint windowFrames = 0;
+	uint shrinkWindows = 0;
+	uint maxLightCount = 0;
+};
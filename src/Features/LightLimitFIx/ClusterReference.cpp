@@ -0,0 +1,289 @@
+#include "ClusterReference.h"
+
+namespace ClusterReference
+{
+	static Float3 Sub(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	static Float3 Scale(const Float3& a, float b) { return { a.x * b, a.y * b, a.z * b }; }
+	static Float3 Min(const Float3& a, const Float3& b) { return { std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z) }; }
+	static Float3 Max(const Float3& a, const Float3& b) { return { std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z) }; }
+
+	// mul(a_vector, a_matrix) of a row_major matrix
+	static Float4 Transform(const Float4& a_vector, const Float4x4& a_matrix)
+	{
+		const float v[4] = { a_vector.x, a_vector.y, a_vector.z, a_vector.w };
+		float r[4] = {};
+		for (int column = 0; column < 4; column++)
+			for (int row = 0; row < 4; row++)
+				r[column] += v[row] * a_matrix.m[row][column];
+		return { r[0], r[1], r[2], r[3] };
+	}
+
+	static Float3 GetPositionVS(float a_u, float a_v, float a_depth, const Float4x4& a_invProjMatrix)
+	{
+		Float4 clipSpaceLocation = { a_u * 2.0f - 1.0f, -(a_v * 2.0f - 1.0f), a_depth, 1.0f };
+		Float4 homogenousLocation = Transform(clipSpaceLocation, a_invProjMatrix);
+		return Scale({ homogenousLocation.x, homogenousLocation.y, homogenousLocation.z }, 1.0f / homogenousLocation.w);
+	}
+
+	static Float3 IntersectionZPlane(const Float3& a_direction, float a_zDist)
+	{
+		return Scale(a_direction, a_zDist / a_direction.z);
+	}
+
+	static bool LightIntersectsCluster(const Float4& a_position, float a_radiusSquared, const ClusterAABB& a_cluster)
+	{
+		Float3 closest = {
+			std::max(a_cluster.minPoint.x, std::min(a_position.x, a_cluster.maxPoint.x)),
+			std::max(a_cluster.minPoint.y, std::min(a_position.y, a_cluster.maxPoint.y)),
+			std::max(a_cluster.minPoint.z, std::min(a_position.z, a_cluster.maxPoint.z))
+		};
+		Float3 dist = Sub(closest, { a_position.x, a_position.y, a_position.z });
+		return dist.x * dist.x + dist.y * dist.y + dist.z * dist.z <= a_radiusSquared;
+	}
+
+	std::vector<Light> GatherLights(const Snapshot& a_snapshot)
+	{
+		std::vector<Light> lights = a_snapshot.lights;
+
+		// LightLimitFix::AddCachedParticleLights, particle lights take the slots after the scene lights
+		ParticleMerger merger{ a_snapshot.particleSettings };
+		auto emitLight = [&](const ParticleMerger::Light& a_light) {
+			if (lights.size() >= a_snapshot.maxLights)
+				return;
+
+			Light light{};
+			light.color = { a_light.color[0], a_light.color[1], a_light.color[2] };
+			light.radius = a_light.radius;
+			light.positionWS[0] = {
+				a_light.position[0] + a_snapshot.particleOrigin.x,
+				a_light.position[1] + a_snapshot.particleOrigin.y,
+				a_light.position[2] + a_snapshot.particleOrigin.z,
+				0.0f
+			};
+			light.lightFlags = LightFlags::Simple;
+			lights.push_back(light);
+		};
+
+		for (const auto& particle : a_snapshot.particles)
+			merger.Add(particle, emitLight);
+		merger.Flush(emitLight);
+
+		return lights;
+	}
+
+	std::vector<ClusterAABB> BuildClusters(const BuildingCB& a_data, const uint32_t a_clusterSize[3], int a_eyeCount)
+	{
+		std::vector<ClusterAABB> clusters(a_clusterSize[0] * a_clusterSize[1] * a_clusterSize[2]);
+
+		float tileSizeX = 1.0f / a_clusterSize[0];
+		float tileSizeY = 1.0f / a_clusterSize[1];
+
+		for (uint32_t z = 0; z < a_clusterSize[2]; z++) {
+			float clusterNear = a_data.LightsNear * std::pow(a_data.LightsFar / a_data.LightsNear, z / (float)a_clusterSize[2]);
+			float clusterFar = a_data.LightsNear * std::pow(a_data.LightsFar / a_data.LightsNear, (z + 1) / (float)a_clusterSize[2]);
+
+			for (uint32_t y = 0; y < a_clusterSize[1]; y++) {
+				for (uint32_t x = 0; x < a_clusterSize[0]; x++) {
+					Float3 maxPointVS = GetPositionVS((x + 1) * tileSizeX, (y + 1) * tileSizeY, 1.0f, a_data.InvProjMatrix[0]);
+					Float3 minPointVS = GetPositionVS(x * tileSizeX, y * tileSizeY, 1.0f, a_data.InvProjMatrix[0]);
+					if (a_eyeCount == 2) {
+						maxPointVS = Max(maxPointVS, GetPositionVS((x + 1) * tileSizeX, (y + 1) * tileSizeY, 1.0f, a_data.InvProjMatrix[1]));
+						minPointVS = Min(minPointVS, GetPositionVS(x * tileSizeX, y * tileSizeY, 1.0f, a_data.InvProjMatrix[1]));
+					}
+
+					Float3 minPointNear = IntersectionZPlane(minPointVS, clusterNear);
+					Float3 minPointFar = IntersectionZPlane(minPointVS, clusterFar);
+					Float3 maxPointNear = IntersectionZPlane(maxPointVS, clusterNear);
+					Float3 maxPointFar = IntersectionZPlane(maxPointVS, clusterFar);
+
+					Float3 minPointAABB = Min(Min(minPointNear, minPointFar), Min(maxPointNear, maxPointFar));
+					Float3 maxPointAABB = Max(Max(minPointNear, minPointFar), Max(maxPointNear, maxPointFar));
+
+					auto& cluster = clusters[x + y * a_clusterSize[0] + z * (a_clusterSize[0] * a_clusterSize[1])];
+					cluster.minPoint = { minPointAABB.x, minPointAABB.y, minPointAABB.z, 0.0f };
+					cluster.maxPoint = { maxPointAABB.x, maxPointAABB.y, maxPointAABB.z, 0.0f };
+				}
+			}
+		}
+
+		return clusters;
+	}
+
+	std::vector<Light> TransformLights(const Light* a_lights, uint32_t a_lightCount, const TransformCB& a_data)
+	{
+		std::vector<Light> lights(a_lights, a_lights + a_lightCount);
+
+		for (auto& light : lights) {
+			Float4 positionWorld = light.positionWS[0];
+			for (int eyeIndex = 0; eyeIndex < 2; eyeIndex++) {
+				const auto& eyePosition = a_data.EyePosition[eyeIndex];
+				Float4 positionWS = { positionWorld.x - eyePosition.x, positionWorld.y - eyePosition.y, positionWorld.z - eyePosition.z, 1.0f };
+				Float4 positionVS = Transform(positionWS, a_data.ViewMatrix[eyeIndex]);
+				light.positionWS[eyeIndex] = { positionWS.x, positionWS.y, positionWS.z, 0.0f };
+				light.positionVS[eyeIndex] = { positionVS.x, positionVS.y, positionVS.z, 0.0f };
+			}
+		}
+
+		return lights;
+	}
+
+	ClusterLights CullLights(const std::vector<ClusterAABB>& a_clusters, const Light* a_lights, uint32_t a_lightCount, uint32_t a_maxClusterLights, int a_eyeCount)
+	{
+		ClusterLights result;
+		result.lightGrid.resize(a_clusters.size());
+
+		for (size_t clusterIndex = 0; clusterIndex < a_clusters.size(); clusterIndex++) {
+			const auto& cluster = a_clusters[clusterIndex];
+
+			uint32_t offset = (uint32_t)result.lightIndexList.size();
+			uint32_t visibleLightCount = 0;
+
+			for (uint32_t i = 0; i < a_lightCount && visibleLightCount < a_maxClusterLights; i++) {
+				const auto& light = a_lights[i];
+				float radius = light.radius * light.radius;
+				bool intersects = LightIntersectsCluster(light.positionVS[0], radius, cluster);
+				if (!intersects && a_eyeCount == 2)
+					intersects = LightIntersectsCluster(light.positionVS[1], radius, cluster);
+
+				if (intersects) {
+					result.lightIndexList.push_back(i);
+					visibleLightCount++;
+				}
+			}
+
+			result.lightGrid[clusterIndex] = { offset, visibleLightCount, { 0, 0 } };
+		}
+
+		return result;
+	}
+
+	static constexpr uint32_t SnapshotMagic = 0x53464C4C;  // "LLFS"
+	static constexpr uint32_t SnapshotVersion = 2;
+
+	template <class T>
+	static void Write(std::ofstream& o, const T& a_value)
+	{
+		o.write(reinterpret_cast<const char*>(&a_value), sizeof(T));
+	}
+
+	template <class T>
+	static void Read(std::ifstream& i, T& o_value)
+	{
+		i.read(reinterpret_cast<char*>(&o_value), sizeof(T));
+	}
+
+	template <class T>
+	static void WriteVector(std::ofstream& o, const std::vector<T>& a_values)
+	{
+		Write(o, (uint32_t)a_values.size());
+		o.write(reinterpret_cast<const char*>(a_values.data()), sizeof(T) * a_values.size());
+	}
+
+	template <class T>
+	static void ReadVector(std::ifstream& i, std::vector<T>& o_values)
+	{
+		uint32_t count = 0;
+		Read(i, count);
+		// Guards against reading a truncated or foreign file into a huge allocation
+		if (!i.good() || count > (1u << 24)) {
+			i.setstate(std::ios::failbit);
+			return;
+		}
+		o_values.resize(count);
+		i.read(reinterpret_cast<char*>(o_values.data()), sizeof(T) * count);
+	}
+
+	bool SaveSnapshot(const std::filesystem::path& a_path, const Snapshot& a_snapshot)
+	{
+		std::error_code ec;
+		if (a_path.has_parent_path())
+			std::filesystem::create_directories(a_path.parent_path(), ec);
+
+		std::ofstream o{ a_path, std::ios::binary };
+		if (!o.is_open()) {
+			logger::warn("[LLF] Failed to open {}", a_path.string());
+			return false;
+		}
+
+		Write(o, SnapshotMagic);
+		Write(o, SnapshotVersion);
+		Write(o, a_snapshot.building);
+		Write(o, a_snapshot.transform);
+		Write(o, a_snapshot.clusterSize);
+		Write(o, a_snapshot.maxClusterLights);
+		Write(o, a_snapshot.eyeCount);
+		Write(o, a_snapshot.maxLights);
+		Write(o, a_snapshot.particleOrigin);
+		Write(o, a_snapshot.particleSettings);
+		WriteVector(o, a_snapshot.lights);
+		WriteVector(o, a_snapshot.particles);
+		return o.good();
+	}
+
+	bool LoadSnapshot(const std::filesystem::path& a_path, Snapshot& o_snapshot)
+	{
+		std::ifstream i{ a_path, std::ios::binary };
+		if (!i.is_open())
+			return false;
+
+		uint32_t magic = 0, version = 0;
+		Read(i, magic);
+		Read(i, version);
+		if (magic != SnapshotMagic || version != SnapshotVersion) {
+			logger::warn("[LLF] {} is not a version {} light snapshot", a_path.string(), SnapshotVersion);
+			return false;
+		}
+
+		Read(i, o_snapshot.building);
+		Read(i, o_snapshot.transform);
+		Read(i, o_snapshot.clusterSize);
+		Read(i, o_snapshot.maxClusterLights);
+		Read(i, o_snapshot.eyeCount);
+		Read(i, o_snapshot.maxLights);
+		Read(i, o_snapshot.particleOrigin);
+		Read(i, o_snapshot.particleSettings);
+		ReadVector(i, o_snapshot.lights);
+		ReadVector(i, o_snapshot.particles);
+		return i.good();
+	}
+
+	Result Run(const Snapshot& a_snapshot)
+	{
+		Result result;
+		auto lights = GatherLights(a_snapshot);
+		result.clusters = BuildClusters(a_snapshot.building, a_snapshot.clusterSize, a_snapshot.eyeCount);
+		result.lights = TransformLights(lights.data(), (uint32_t)lights.size(), a_snapshot.transform);
+		result.clusterLights = CullLights(result.clusters, result.lights.data(), (uint32_t)result.lights.size(), a_snapshot.maxClusterLights, a_snapshot.eyeCount);
+		return result;
+	}
+
+	uint32_t CountPixelLights(const Snapshot& a_snapshot, const Result& a_result, float a_u, float a_v, float a_depth, int a_roomIndex)
+	{
+		// LightLimitFix::GetClusterIndex
+		float lightsNear = a_snapshot.building.LightsNear;
+		float lightsFar = a_snapshot.building.LightsFar;
+		float z = std::max(a_depth, lightsNear);
+		if (z > lightsFar)
+			return 0;
+
+		const auto& clusterSize = a_snapshot.clusterSize;
+		uint32_t clusterZ = (uint32_t)std::max((std::log2(z) - std::log2(lightsNear)) * clusterSize[2] / std::log2(lightsFar / lightsNear), 0.0f);
+		uint32_t clusterX = std::min((uint32_t)(a_u * clusterSize[0]), clusterSize[0] - 1);
+		uint32_t clusterY = std::min((uint32_t)(a_v * clusterSize[1]), clusterSize[1] - 1);
+		uint32_t clusterIndex = clusterX + clusterSize[0] * clusterY + clusterSize[0] * clusterSize[1] * std::min(clusterZ, clusterSize[2] - 1);
+
+		const auto& grid = a_result.clusterLights.lightGrid[clusterIndex];
+		uint32_t lightCount = 0;
+		for (uint32_t i = 0; i < grid.lightCount; i++) {
+			const auto& light = a_result.lights[a_result.clusterLights.lightIndexList[grid.offset + i]];
+
+			// LightLimitFix::IsLightIgnored
+			if ((light.lightFlags & LightFlags::PortalStrict) && a_roomIndex >= 0 && a_roomIndex < 128) {
+				if (((light.roomFlags[a_roomIndex / 32] >> (a_roomIndex % 32)) & 1) == 0)
+					continue;
+			}
+			lightCount++;
+		}
+		return lightCount;
+	}
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "ParticleMerger.h"
+
+// CPU reference of the clustered light pipeline (particle merging, LightTransformCS, ClusterBuildingCS and ClusterCullingCS),
+// used to validate the GPU results in developer mode and to replay saved frames in the headless tests.
+// Only plain types are used here, their layouts match LightLimitFix.h and LightLimitFix/Common.hlsli.
+namespace ClusterReference
+{
+	struct Float3
+	{
+		float x, y, z;
+	};
+
+	struct Float4
+	{
+		float x, y, z, w;
+	};
+
+	// Row-major, vectors are multiplied on the left as in the shaders
+	struct Float4x4
+	{
+		float m[4][4];
+	};
+
+	namespace LightFlags
+	{
+		inline constexpr uint32_t PortalStrict = 1 << 0;
+		inline constexpr uint32_t Simple = 1 << 2;
+	}
+
+	struct alignas(16) Light
+	{
+		Float3 color;
+		float radius;
+		Float4 positionWS[2];
+		Float4 positionVS[2];
+		uint32_t roomFlags[4];
+		uint32_t lightFlags;
+		uint32_t shadowMaskIndex;
+		float pad0[2];
+	};
+
+	struct ClusterAABB
+	{
+		Float4 minPoint;
+		Float4 maxPoint;
+	};
+
+	struct alignas(16) LightGrid
+	{
+		uint32_t offset;
+		uint32_t lightCount;
+		uint32_t pad0[2];
+	};
+
+	struct alignas(16) BuildingCB
+	{
+		Float4x4 InvProjMatrix[2];
+		float LightsNear;
+		float LightsFar;
+		uint32_t pad0[2];
+		uint32_t ClusterSize[3];
+		uint32_t pad1;
+	};
+
+	struct alignas(16) TransformCB
+	{
+		Float4x4 ViewMatrix[2];
+		Float4 EyePosition[2];
+		uint32_t LightCount;
+		uint32_t pad0[3];
+	};
+
+	// Inputs of one frame of the clustered light pipeline, enough to replay it without the game or a GPU
+	struct Snapshot
+	{
+		BuildingCB building{};
+		TransformCB transform{};
+		uint32_t clusterSize[3]{};
+		uint32_t maxClusterLights = 0;
+		int32_t eyeCount = 1;
+		uint32_t maxLights = 0;         // light buffer capacity, particle lights past it are dropped
+		Float3 particleOrigin{};        // camera position the particle positions are relative to
+		ParticleMerger::Settings particleSettings{};
+		std::vector<Light> lights;      // scene light slots with world positions
+		std::vector<ParticleMerger::Particle> particles;
+	};
+
+	bool SaveSnapshot(const std::filesystem::path& a_path, const Snapshot& a_snapshot);
+	bool LoadSnapshot(const std::filesystem::path& a_path, Snapshot& o_snapshot);
+
+	struct ClusterLights
+	{
+		std::vector<LightGrid> lightGrid;
+		std::vector<uint32_t> lightIndexList;
+	};
+
+	// Scene lights followed by the merged particle lights, with world positions as uploaded to the light buffer
+	std::vector<Light> GatherLights(const Snapshot& a_snapshot);
+
+	std::vector<ClusterAABB> BuildClusters(const BuildingCB& a_data, const uint32_t a_clusterSize[3], int a_eyeCount);
+
+	// Mirrors LightTransformCS, turning the world positions of the light slots into eye-relative and view-space positions
+	std::vector<Light> TransformLights(const Light* a_lights, uint32_t a_lightCount, const TransformCB& a_data);
+
+	ClusterLights CullLights(const std::vector<ClusterAABB>& a_clusters, const Light* a_lights, uint32_t a_lightCount, uint32_t a_maxClusterLights, int a_eyeCount);
+
+	struct Result
+	{
+		std::vector<ClusterAABB> clusters;
+		std::vector<Light> lights;  // eye-relative, as written by LightTransformCS
+		ClusterLights clusterLights;
+	};
+
+	Result Run(const Snapshot& a_snapshot);
+
+	// Mirrors the cluster lookup and light loop of Lighting.hlsl, returning the clustered lights a pixel would shade
+	uint32_t CountPixelLights(const Snapshot& a_snapshot, const Result& a_result, float a_u, float a_v, float a_depth, int a_roomIndex = -1);
+}
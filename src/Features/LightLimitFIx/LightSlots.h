@@ -0,0 +1,161 @@
+#pragma once
+
+/**
+ * Stable slots of a GPU light buffer, a light keeps its slot while it is seen every frame so only the slots
+ * that changed have to be uploaded.
+ * Slots stay packed so the culling never walks empty ones, the last light moves into the slot of a removed one.
+ * Slots are written through a staging copy with a dirty flag per slot, Upload coalesces the dirty slots into ranges.
+ */
+template <class Key, class Data>
+class LightSlots
+{
+public:
+	static constexpr uint32_t InvalidSlot = UINT32_MAX;
+
+	// Above this share of dirty slots the whole buffer is uploaded at once
+	static constexpr float FullUploadRatio = 0.5f;
+	// Clean slots between two dirty ones that are still uploaded as a single range
+	static constexpr uint32_t MergeGap = 4;
+
+	void Reset(uint32_t a_capacity)
+	{
+		slots.clear();
+		owners.assign(a_capacity, Key{});
+		frames.assign(a_capacity, 0);
+		staging.assign(a_capacity, Data{});
+		dirty.assign(a_capacity, 0);
+		count = 0;
+		forceFullUpload = true;
+	}
+
+	void NextFrame() { frame++; }
+
+	/**
+	 * Slot of a_key, marking it as seen this frame.
+	 * @param o_new Set when the slot was just given to a_key.
+	 * @return InvalidSlot when every slot is taken.
+	 */
+	uint32_t Acquire(Key a_key, bool* o_new = nullptr)
+	{
+		uint32_t slot = 0;
+		if (auto it = slots.find(a_key); it != slots.end()) {
+			slot = it->second;
+			frames[slot] = frame;
+			if (o_new)
+				*o_new = false;
+			return slot;
+		} else if (count < owners.size()) {
+			slot = count++;
+		} else {
+			return InvalidSlot;
+		}
+
+		slots.insert_or_assign(a_key, slot);
+		owners[slot] = a_key;
+		frames[slot] = frame;
+		if (o_new)
+			*o_new = true;
+		return slot;
+	}
+
+	/**
+	 * Frees the slots of keys not acquired this frame, filling each hole with the last slot.
+	 * @param a_onMove Called with (from, to) for every moved slot.
+	 */
+	template <class F>
+	void ReleaseUnused(F&& a_onMove)
+	{
+		uint32_t slot = 0;
+		while (slot < count) {
+			if (frames[slot] == frame) {
+				slot++;
+				continue;
+			}
+
+			slots.erase(owners[slot]);
+			uint32_t last = --count;
+			if (slot != last) {
+				owners[slot] = owners[last];
+				frames[slot] = frames[last];
+				slots.insert_or_assign(owners[slot], slot);
+				Write(slot, staging[last]);
+				a_onMove(last, slot);
+			}
+			owners[last] = Key{};
+		}
+	}
+
+	void ReleaseUnused()
+	{
+		ReleaseUnused([](uint32_t, uint32_t) {});
+	}
+
+	void Write(uint32_t a_slot, const Data& a_data)
+	{
+		if (std::memcmp(&staging[a_slot], &a_data, sizeof(Data)) != 0) {
+			staging[a_slot] = a_data;
+			dirty[a_slot] = 1;
+		}
+	}
+
+	/**
+	 * Calls a_upload(begin, end) for the dirty ranges of the first a_count slots and clears them.
+	 * @return Bytes passed to a_upload.
+	 */
+	template <class F>
+	size_t Upload(uint32_t a_count, F&& a_upload)
+	{
+		size_t bytes = 0;
+		auto uploadRange = [&](uint32_t a_begin, uint32_t a_end) {
+			a_upload(a_begin, a_end);
+			std::fill(dirty.begin() + a_begin, dirty.begin() + a_end, (uint8_t)0);
+			bytes += sizeof(Data) * (a_end - a_begin);
+		};
+
+		if (a_count == 0)
+			return bytes;
+
+		uint32_t dirtyCount = (uint32_t)std::count(dirty.begin(), dirty.begin() + a_count, (uint8_t)1);
+
+		if (forceFullUpload || dirtyCount > a_count * FullUploadRatio) {
+			uploadRange(0, a_count);
+			forceFullUpload = false;
+			return bytes;
+		}
+
+		uint32_t slot = 0;
+		while (slot < a_count) {
+			if (!dirty[slot]) {
+				slot++;
+				continue;
+			}
+
+			uint32_t begin = slot;
+			uint32_t end = slot + 1;
+			for (uint32_t next = end; next < a_count && next <= end + MergeGap; next++) {
+				if (dirty[next])
+					end = next + 1;
+			}
+
+			uploadRange(begin, end);
+			slot = end;
+		}
+		return bytes;
+	}
+
+	uint32_t Count() const { return count; }
+	uint32_t Capacity() const { return (uint32_t)owners.size(); }
+	Key Owner(uint32_t a_slot) const { return owners[a_slot]; }
+	const Data* Staging(uint32_t a_slot) const { return &staging[a_slot]; }
+	bool IsDirty(uint32_t a_slot) const { return dirty[a_slot]; }
+
+private:
+	std::unordered_map<Key, uint32_t> slots;
+	std::vector<Key> owners;
+	std::vector<uint32_t> frames;
+	std::vector<Data> staging;
+	std::vector<uint8_t> dirty;
+	uint32_t count = 0;
+	uint32_t frame = 0;
+	bool forceFullUpload = true;
+};
@@ -1,5 +1,7 @@
 #include "Features/LightLimitFix/ParticleLights.h"
 
+#include "Utils/FileSystem.h"
+
 #include <numbers>
 
 void ParticleLights::GetConfigs()
@@ -7,7 +9,7 @@ void ParticleLights::GetConfigs()
 	if (std::filesystem::exists("Data\\ParticleLights")) {
 		logger::info("[LLF] Loading particle lights configs");
 
-		auto configs = clib_util::distribution::get_configs("Data\\ParticleLights", "", ".ini");
+		auto configs = Util::AssetManifest::GetSingleton()->GetConfigs("Data\\ParticleLights", ".ini");
 
 		if (configs.empty()) {
 			logger::warn("[LLF] No .ini files were found within the Data\\ParticleLights folder, aborting...");
@@ -61,7 +63,7 @@ void ParticleLights::GetConfigs()
 	if (std::filesystem::exists("Data\\ParticleLights\\Gradients")) {
 		logger::info("[LLF] Loading particle lights gradients configs");
 
-		auto configs = clib_util::distribution::get_configs("Data\\ParticleLights\\Gradients", "", ".ini");
+		auto configs = Util::AssetManifest::GetSingleton()->GetConfigs("Data\\ParticleLights\\Gradients", ".ini");
 
 		if (configs.empty()) {
 			logger::warn("[LLF] No .ini files were found within the Data\\ParticleLights\\Gradients folder, aborting...");
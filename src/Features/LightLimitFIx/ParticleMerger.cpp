@@ -0,0 +1,33 @@
+#include "ParticleMerger.h"
+
+bool ParticleMerger::CanMerge(const Particle& a_particle) const
+{
+	float averageRadius = sum.radius / (float)count;
+	float radiusDiff = std::abs(averageRadius - a_particle.radius);
+
+	float positionDiff = 0.0f;
+	for (int i = 0; i < 3; i++) {
+		float diff = a_particle.position[i] - sum.position[i] / (float)count;
+		positionDiff += diff * diff;
+	}
+	positionDiff = std::sqrt(positionDiff);
+
+	return (radiusDiff + positionDiff) <= MergeDistance;
+}
+
+bool ParticleMerger::Fade(Light& a_light) const
+{
+	float distance = a_light.position[0] * a_light.position[0] + a_light.position[1] * a_light.position[1] + a_light.position[2] * a_light.position[2] - a_light.radius * a_light.radius;
+
+	float dimmer = 0.0f;
+	if (distance < settings.fadeStart || settings.fadeEnd == 0.0f) {
+		dimmer = 1.0f;
+	} else if (distance <= settings.fadeEnd) {
+		dimmer = 1.0f - ((distance - settings.fadeStart) / (settings.fadeEnd - settings.fadeStart));
+	}
+
+	for (auto& channel : a_light.color)
+		channel *= dimmer;
+
+	return (a_light.color[0] + a_light.color[1] + a_light.color[2]) > 1e-4 && a_light.radius > 1e-4;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+/**
+ * Merges runs of particles with a similar size and position into one light, since particle systems emit many
+ * overlapping particles, then fades the lights out with distance like the game does for its own lights.
+ * Positions are relative to the camera.
+ */
+class ParticleMerger
+{
+public:
+	struct Settings
+	{
+		float fadeStart = 0.0f;  // squared camera distance less the squared radius, as the game fades its lights
+		float fadeEnd = 0.0f;
+		uint32_t merge = true;
+		uint32_t pad0 = 0;
+	};
+
+	struct Particle
+	{
+		float position[3];
+		float radius;       // compared against the running light when merging
+		float color[3];     // added to the light color
+		float lightRadius;  // averaged into the light radius
+		uint32_t single;    // billboards, never merged
+		uint32_t pad0[3];
+	};
+
+	struct Light
+	{
+		float position[3];
+		float radius;
+		float color[3];
+	};
+
+	// Particles merge while the radius and position differences add up to less than this
+	static constexpr float MergeDistance = 32.0f;
+
+	explicit ParticleMerger(const Settings& a_settings) :
+		settings(a_settings) {}
+
+	/**
+	 * Adds a particle, calling a_emit(const Light&) for every light that is finished and still visible.
+	 */
+	template <class F>
+	void Add(const Particle& a_particle, F&& a_emit)
+	{
+		if (a_particle.single) {
+			Light light{};
+			std::copy_n(a_particle.position, 3, light.position);
+			std::copy_n(a_particle.color, 3, light.color);
+			light.radius = a_particle.lightRadius;
+			if (Fade(light))
+				a_emit(light);
+			return;
+		}
+
+		if (count && (!settings.merge || !CanMerge(a_particle)))
+			Flush(a_emit);
+
+		for (int i = 0; i < 3; i++) {
+			sum.position[i] += a_particle.position[i];
+			sum.color[i] += a_particle.color[i];
+		}
+		sum.radius += a_particle.lightRadius;
+		count++;
+	}
+
+	// Emits the running light, at the end of the particles
+	template <class F>
+	void Flush(F&& a_emit)
+	{
+		if (!count)
+			return;
+
+		Light light = sum;
+		light.radius /= (float)count;
+		for (int i = 0; i < 3; i++)
+			light.position[i] /= (float)count;
+
+		sum = {};
+		count = 0;
+
+		if (Fade(light))
+			a_emit(light);
+	}
+
+private:
+	bool CanMerge(const Particle& a_particle) const;
+
+	// Dims a_light by its distance, false when nothing is left of it
+	bool Fade(Light& a_light) const;
+
+	Settings settings;
+	Light sum{};
+	uint32_t count = 0;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+/**
+ * Strict light sets appended to one buffer that persists across frames, draws with the same lights share a range
+ * so a static scene uploads nothing.
+ * Hash hashes the bytes of a set as a std::string_view, a match is only reused after comparing the bytes.
+ */
+template <class Data, class Hash = std::hash<std::string_view>>
+class StrictLightPool
+{
+public:
+	void Reset(uint32_t a_capacity)
+	{
+		staging.assign(a_capacity, Data{});
+		sets.clear();
+		offset = 0;
+	}
+
+	/**
+	 * Offset of a_count lights in the buffer, calling a_upload(offset, lights, count) when they have to be written.
+	 * Offset 0 of an upload means the earlier contents are no longer referenced and may be discarded.
+	 */
+	template <class F>
+	uint32_t Allocate(const Data* a_lights, uint32_t a_count, F&& a_upload)
+	{
+		const size_t bytes = sizeof(Data) * a_count;
+		const auto hash = (uint64_t)Hash{}(std::string_view(reinterpret_cast<const char*>(a_lights), bytes));
+
+		if (auto it = sets.find(hash); it != sets.end()) {
+			if (it->second + a_count <= offset && std::memcmp(&staging[it->second], a_lights, bytes) == 0)
+				return it->second;
+		}
+
+		// Only new sets are appended, earlier draws keep their data through the discard once the buffer is full
+		if (offset + a_count > staging.size()) {
+			offset = 0;
+			sets.clear();
+		}
+
+		uint32_t setOffset = offset;
+		std::memcpy(&staging[setOffset], a_lights, bytes);
+		a_upload(setOffset, a_lights, a_count);
+
+		offset += a_count;
+		sets.insert_or_assign(hash, setOffset);
+		uploads++;
+
+		return setOffset;
+	}
+
+	uint32_t Size() const { return offset; }
+	uint32_t Capacity() const { return (uint32_t)staging.size(); }
+	uint32_t ConsumeUploads() { return std::exchange(uploads, 0); }
+
+private:
+	std::vector<Data> staging;
+	std::unordered_map<uint64_t, uint32_t> sets;
+	uint32_t offset = 0;
+	uint32_t uploads = 0;
+};
@@ -1,11 +1,14 @@
 #include "LightLimitFix.h"
 
+#include "Profiler.h"
 #include "Shadercache.h"
 #include "State.h"
 #include "Util.h"
 
-static constexpr uint CLUSTER_MAX_LIGHTS = 256;
+#include "Features/LightLimitFix/ClusterReference.h"
+
 static constexpr uint MAX_LIGHTS = 1024;
+static constexpr uint MAX_STRICT_LIGHTS = 8192;
 
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
 	LightLimitFix::Settings,
@@ -106,6 +109,22 @@ void LightLimitFix::DrawSettings()
 	if (ImGui::TreeNodeEx("Statistics", ImGuiTreeNodeFlags_DefaultOpen)) {
 		ImGui::Text(std::format("Clustered Light Count : {}", lightCount).c_str());
 		ImGui::Text(std::format("Particle Lights Count : {}", particleLights.size()).c_str());
+		ImGui::Text(std::format("Light Buffer Upload : {} bytes", lightBytesUploaded).c_str());
+		ImGui::Text(std::format("Strict Light Draws : {}", strictLightDrawsLastFrame).c_str());
+		ImGui::Text(std::format("Strict Light Uploads : {}", strictLightUploadsLastFrame).c_str());
+		ImGui::Text(std::format("Cluster Grid : {}x{}x{}, {} lights per cluster", clusterSize[0], clusterSize[1], clusterSize[2], clusterGridController.Get().maxClusterLights).c_str());
+		ImGui::Text(std::format("Cluster Light Indices : {} / {}", clusterStatistics.lightIndexCount, clusterGridController.Get().lightIndexListSize).c_str());
+		ImGui::Text(std::format("Max Lights In A Cluster : {}", clusterStatistics.maxClusterLights).c_str());
+		ImGui::Text(std::format("Overflowing Clusters : {}", clusterStatistics.overflowClusters).c_str());
+
+		if (State::GetSingleton()->IsDeveloperMode()) {
+			if (ImGui::Button("Validate Clusters"))
+				validateClusters = true;
+			if (auto _tt = Util::HoverTooltipWrapper()) {
+				ImGui::Text("Compares the GPU cluster grid and light lists against a CPU reference and writes the result to the log.\n"
+							"The inputs of the frame are saved to LightLimitFix\\Snapshot.bin so it can be replayed through the reference.");
+			}
+		}
 
 		ImGui::TreePop();
 	}
@@ -126,33 +145,13 @@ void LightLimitFix::CleanupParticleLights(RE::NiNode* a_node)
 	particleLightsReferences.erase(a_node);
 }
 
-void LightLimitFix::SetupResources()
+void LightLimitFix::SetupClusterResources()
 {
-	auto screenSize = Util::ConvertToDynamic(State::GetSingleton()->screenSize);
-	if (REL::Module::IsVR())
-		screenSize.x *= .5;
-	clusterSize[0] = ((uint)screenSize.x + 63) / 64;
-	clusterSize[1] = ((uint)screenSize.y + 63) / 64;
-	clusterSize[2] = 32;
+	auto screenSize = GetClusterScreenSize();
+	auto size = clusterGridController.Fit(screenSize[0], screenSize[1]);
+	std::copy(size.begin(), size.end(), clusterSize);
 	uint clusterCount = clusterSize[0] * clusterSize[1] * clusterSize[2];
-
-	{
-		std::string clusterSizeStrs[3];
-		for (int i = 0; i < 3; ++i)
-			clusterSizeStrs[i] = std::format("{}", clusterSize[i]);
-
-		std::vector<std::pair<const char*, const char*>> defines = {
-			{ "CLUSTER_BUILDING_DISPATCH_SIZE_X", clusterSizeStrs[0].c_str() },
-			{ "CLUSTER_BUILDING_DISPATCH_SIZE_Y", clusterSizeStrs[1].c_str() },
-			{ "CLUSTER_BUILDING_DISPATCH_SIZE_Z", clusterSizeStrs[2].c_str() }
-		};
-
-		clusterBuildingCS = (ID3D11ComputeShader*)Util::CompileShader(L"Data\\Shaders\\LightLimitFix\\ClusterBuildingCS.hlsl", defines, "cs_5_0");
-		clusterCullingCS = (ID3D11ComputeShader*)Util::CompileShader(L"Data\\Shaders\\LightLimitFix\\ClusterCullingCS.hlsl", defines, "cs_5_0");
-
-		lightBuildingCB = new ConstantBuffer(ConstantBufferDesc<LightBuildingCB>());
-		lightCullingCB = new ConstantBuffer(ConstantBufferDesc<LightCullingCB>());
-	}
+	const auto& clusterGrid = clusterGridController.Get();
 
 	{
 		D3D11_BUFFER_DESC sbDesc{};
@@ -182,16 +181,7 @@ void LightLimitFix::SetupResources()
 		uavDesc.Buffer.NumElements = numElements;
 		clusters->CreateUAV(uavDesc);
 
-		numElements = 1;
-		sbDesc.StructureByteStride = sizeof(uint32_t);
-		sbDesc.ByteWidth = sizeof(uint32_t) * numElements;
-		lightIndexCounter = eastl::make_unique<Buffer>(sbDesc);
-		srvDesc.Buffer.NumElements = numElements;
-		lightIndexCounter->CreateSRV(srvDesc);
-		uavDesc.Buffer.NumElements = numElements;
-		lightIndexCounter->CreateUAV(uavDesc);
-
-		numElements = clusterCount * CLUSTER_MAX_LIGHTS;
+		numElements = clusterGrid.lightIndexListSize;
 		sbDesc.StructureByteStride = sizeof(uint32_t);
 		sbDesc.ByteWidth = sizeof(uint32_t) * numElements;
 		lightIndexList = eastl::make_unique<Buffer>(sbDesc);
@@ -210,14 +200,73 @@ void LightLimitFix::SetupResources()
 		lightGrid->CreateUAV(uavDesc);
 	}
 
+	clustersDirty = true;
+
+	logger::debug("[LLF] Cluster grid {}x{}x{}, {} lights per cluster, {} light indices", clusterSize[0], clusterSize[1], clusterSize[2], clusterGrid.maxClusterLights, clusterGrid.lightIndexListSize);
+}
+
+std::array<uint, 2> LightLimitFix::GetClusterScreenSize()
+{
+	auto screenSize = Util::ConvertToDynamic(State::GetSingleton()->screenSize);
+	if (REL::Module::IsVR())
+		screenSize.x *= .5;
+	return { (uint)screenSize.x, (uint)screenSize.y };
+}
+
+void LightLimitFix::SetupResources()
+{
+	// The grid dimensions and capacities are passed in constant buffers, so resizing the grid never recompiles these
+	clusterBuildingCS = (ID3D11ComputeShader*)Util::CompileShader(L"Data\\Shaders\\LightLimitFix\\ClusterBuildingCS.hlsl", {}, "cs_5_0");
+	clusterCullingCS = (ID3D11ComputeShader*)Util::CompileShader(L"Data\\Shaders\\LightLimitFix\\ClusterCullingCS.hlsl", {}, "cs_5_0");
+
+	SetupClusterResources();
+
+	{
+		lightBuildingCB = new ConstantBuffer(ConstantBufferDesc<LightBuildingCB>());
+		lightTransformCB = new ConstantBuffer(ConstantBufferDesc<LightTransformCB>());
+		lightCullingCB = new ConstantBuffer(ConstantBufferDesc<LightCullingCB>());
+	}
+
+	lightTransformCS = (ID3D11ComputeShader*)Util::CompileShader(L"Data\\Shaders\\LightLimitFix\\LightTransformCS.hlsl", {}, "cs_5_0");
+
 	{
 		D3D11_BUFFER_DESC sbDesc{};
-		sbDesc.Usage = D3D11_USAGE_DYNAMIC;
-		sbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		sbDesc.Usage = D3D11_USAGE_DEFAULT;
+		sbDesc.CPUAccessFlags = 0;
+		sbDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+		sbDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		sbDesc.StructureByteStride = sizeof(uint32_t);
+		sbDesc.ByteWidth = sizeof(ClusterStatistics);
+		lightIndexCounter = eastl::make_unique<Buffer>(sbDesc);
+
+		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc{};
+		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+		uavDesc.Buffer.FirstElement = 0;
+		uavDesc.Buffer.Flags = 0;
+		uavDesc.Buffer.NumElements = sizeof(ClusterStatistics) / sizeof(uint32_t);
+		lightIndexCounter->CreateUAV(uavDesc);
+
+		// Counters are read back a few frames late so the CPU never waits on the GPU
+		D3D11_BUFFER_DESC readbackDesc{};
+		readbackDesc.Usage = D3D11_USAGE_STAGING;
+		readbackDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		readbackDesc.ByteWidth = sizeof(ClusterStatistics);
+		for (auto& readback : clusterStatisticsReadback)
+			readback = eastl::make_unique<Buffer>(readbackDesc);
+	}
+
+	{
+		D3D11_BUFFER_DESC sbDesc{};
+		sbDesc.Usage = D3D11_USAGE_DEFAULT;
+		sbDesc.CPUAccessFlags = 0;
 		sbDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 		sbDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
 		sbDesc.StructureByteStride = sizeof(LightData);
 		sbDesc.ByteWidth = sizeof(LightData) * MAX_LIGHTS;
+		worldLights = eastl::make_unique<Buffer>(sbDesc);
+
+		sbDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
 		lights = eastl::make_unique<Buffer>(sbDesc);
 
 		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
@@ -225,11 +274,46 @@ void LightLimitFix::SetupResources()
 		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
 		srvDesc.Buffer.FirstElement = 0;
 		srvDesc.Buffer.NumElements = MAX_LIGHTS;
+		worldLights->CreateSRV(srvDesc);
 		lights->CreateSRV(srvDesc);
+
+		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc{};
+		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+		uavDesc.Buffer.FirstElement = 0;
+		uavDesc.Buffer.Flags = 0;
+		uavDesc.Buffer.NumElements = MAX_LIGHTS;
+		lights->CreateUAV(uavDesc);
+
+		lightSlots.Reset(MAX_LIGHTS);
+		lightSlotRooms.assign(MAX_LIGHTS, LightRoomCache{});
 	}
 
 	{
 		strictLightDataCB = new ConstantBuffer(ConstantBufferDesc<StrictLightDataCB>());
+
+		// Appending with NO_OVERWRITE to a dynamic buffer bound as an SRV requires D3D11.1 support
+		D3D11_FEATURE_DATA_D3D11_OPTIONS options{};
+		auto device = State::GetSingleton()->device;
+		strictLightsNoOverwrite = SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) && options.MapNoOverwriteOnDynamicBufferSRV;
+
+		D3D11_BUFFER_DESC sbDesc{};
+		sbDesc.Usage = strictLightsNoOverwrite ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
+		sbDesc.CPUAccessFlags = strictLightsNoOverwrite ? D3D11_CPU_ACCESS_WRITE : 0;
+		sbDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		sbDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		sbDesc.StructureByteStride = sizeof(LightData);
+		sbDesc.ByteWidth = sizeof(LightData) * MAX_STRICT_LIGHTS;
+		strictLights = eastl::make_unique<Buffer>(sbDesc);
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = MAX_STRICT_LIGHTS;
+		strictLights->CreateSRV(srvDesc);
+
+		strictLightPool.Reset(MAX_STRICT_LIGHTS);
 	}
 }
 
@@ -247,6 +331,9 @@ void LightLimitFix::Reset()
 	}
 	particleLights.clear();
 	std::swap(particleLights, queuedParticleLights);
+
+	strictLightDrawsLastFrame = std::exchange(strictLightDraws, 0);
+	strictLightUploadsLastFrame = strictLightPool.ConsumeUploads();
 }
 
 void LightLimitFix::LoadSettings(json& o_json)
@@ -336,7 +423,7 @@ void LightLimitFix::BSLightingShader_SetupGeometry_GeometrySetupConstantPointLig
 			light.lightFlags.set(LightFlags::Shadow);
 		}
 
-		strictLightDataTemp.StrictLights[i] = light;
+		strictLightsTemp[i] = light;
 	}
 }
 
@@ -348,32 +435,50 @@ void LightLimitFix::BSLightingShader_SetupGeometry_After(RE::BSRenderPass*)
 		return;
 
 	static auto& context = State::GetSingleton()->context;
-	auto accumulator = RE::BSGraphics::BSShaderAccumulator::GetCurrentAccumulator();
 
-	static bool wasEmpty = false;
-	static bool wasWorld = false;
-	static int previousRoomIndex = -1;
+	static StrictLightDataCB previousStrictLightData{};
 
-	static auto shadowSceneNode = RE::BSShaderManager::State::GetSingleton().shadowSceneNode[0];
+	strictLightDataTemp.StrictLightsOffset = 0;
+	if (strictLightDataTemp.NumStrictLights > 0) {
+		strictLightDataTemp.StrictLightsOffset = AllocateStrictLights(strictLightsTemp, strictLightDataTemp.NumStrictLights);
+		strictLightDraws++;
+	}
 
-	const bool isEmpty = strictLightDataTemp.NumStrictLights == 0;
-	const bool isWorld = accumulator->GetRuntimeData().activeShadowSceneNode == shadowSceneNode;
-	const int roomIndex = strictLightDataTemp.RoomIndex;
+	static Util::FrameChecker frameChecker;
+	const bool newFrame = frameChecker.IsNewFrame();
 
-	if (!isEmpty || (isEmpty && !wasEmpty) || isWorld != wasWorld || previousRoomIndex != roomIndex) {
+	if (newFrame || memcmp(&previousStrictLightData, &strictLightDataTemp, sizeof(StrictLightDataCB)) != 0) {
 		strictLightDataCB->Update(strictLightDataTemp);
-		wasEmpty = isEmpty;
-		wasWorld = isWorld;
-		previousRoomIndex = roomIndex;
+		previousStrictLightData = strictLightDataTemp;
 	}
 
-	static Util::FrameChecker frameChecker;
-	if (frameChecker.IsNewFrame()) {
+	if (newFrame) {
 		ID3D11Buffer* buffer = { strictLightDataCB->CB() };
 		context->PSSetConstantBuffers(3, 1, &buffer);
 	}
 }
 
+uint32_t LightLimitFix::AllocateStrictLights(const LightData* a_lights, uint32_t a_count)
+{
+	static auto& context = State::GetSingleton()->context;
+
+	return strictLightPool.Allocate(a_lights, a_count, [&](uint32_t a_offset, const LightData* a_data, uint32_t a_dataCount) {
+		if (strictLightsNoOverwrite) {
+			D3D11_MAPPED_SUBRESOURCE mapped;
+			DX::ThrowIfFailed(context->Map(strictLights->resource.get(), 0, a_offset == 0 ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped));
+			memcpy(static_cast<LightData*>(mapped.pData) + a_offset, a_data, sizeof(LightData) * a_dataCount);
+			context->Unmap(strictLights->resource.get(), 0);
+		} else {
+			D3D11_BOX box{};
+			box.left = sizeof(LightData) * a_offset;
+			box.right = sizeof(LightData) * (a_offset + a_dataCount);
+			box.bottom = 1;
+			box.back = 1;
+			context->UpdateSubresource(strictLights->resource.get(), 0, &box, a_data, 0, 0);
+		}
+	});
+}
+
 void LightLimitFix::SetLightPosition(LightLimitFix::LightData& a_light, RE::NiPoint3 a_initialPosition, bool a_cached)
 {
 	for (int eyeIndex = 0; eyeIndex < eyeCount; eyeIndex++) {
@@ -435,10 +540,11 @@ void LightLimitFix::Prepass()
 
 	UpdateLights();
 
-	ID3D11ShaderResourceView* views[3]{};
+	ID3D11ShaderResourceView* views[4]{};
 	views[0] = lights->srv.get();
 	views[1] = lightIndexList->srv.get();
 	views[2] = lightGrid->srv.get();
+	views[3] = strictLights->srv.get();
 	context->PSSetShaderResources(35, ARRAYSIZE(views), views);
 }
 
@@ -669,45 +775,131 @@ void LightLimitFix::DataLoaded()
 	auto iMagicLightMaxCount = RE::GameSettingCollection::GetSingleton()->GetSetting("iMagicLightMaxCount");
 	iMagicLightMaxCount->data.i = MAXINT32;
 	logger::info("[LLF] Unlocked magic light limit");
+
+	// Rooms belong to the attached cell, so the table is rebuilt whenever the player enters or leaves one
+	Util::ActorCellNotifier::GetSingleton()->AddListener([] { LightLimitFix::GetSingleton()->InvalidateRooms(); });
+}
+
+void LightLimitFix::AddCachedParticleLights(eastl::vector<LightData>& lightsData, const ParticleMerger::Light& a_light)
+{
+	LightData light{};
+	light.color = { a_light.color[0], a_light.color[1], a_light.color[2] };
+	light.radius = a_light.radius;
+	// Slots hold world positions, see LightTransformCS
+	light.positionWS[0].data = { a_light.position[0] + eyePositionCached[0].x, a_light.position[1] + eyePositionCached[0].y, a_light.position[2] + eyePositionCached[0].z };
+	light.lightFlags.set(LightFlags::Simple);
+
+	lightsData.push_back(light);
+
+	CachedParticleLight cachedParticleLight{};
+	cachedParticleLight.grey = float3(light.color.x, light.color.y, light.color.z).Dot(float3(0.3f, 0.59f, 0.11f));
+	cachedParticleLight.radius = light.radius;
+	cachedParticleLight.position = { light.positionWS[0].data.x, light.positionWS[0].data.y, light.positionWS[0].data.z };
+
+	cachedParticleLights.push_back(cachedParticleLight);
 }
 
-float LightLimitFix::CalculateLightDistance(float3 a_lightPosition, float a_radius)
+void LightLimitFix::UploadLights()
 {
-	return (a_lightPosition.x * a_lightPosition.x) + (a_lightPosition.y * a_lightPosition.y) + (a_lightPosition.z * a_lightPosition.z) - (a_radius * a_radius);
+	static auto& context = State::GetSingleton()->context;
+
+	lightBytesUploaded = lightSlots.Upload(lightCount, [&](uint32_t a_begin, uint32_t a_end) {
+		D3D11_BOX box{};
+		box.left = sizeof(LightData) * a_begin;
+		box.right = sizeof(LightData) * a_end;
+		box.bottom = 1;
+		box.back = 1;
+		context->UpdateSubresource(worldLights->resource.get(), 0, &box, lightSlots.Staging(a_begin), 0, 0);
+	});
 }
 
-void LightLimitFix::AddCachedParticleLights(eastl::vector<LightData>& lightsData, LightLimitFix::LightData& light)
+void LightLimitFix::ReadClusterStatistics()
 {
-	static float& lightFadeStart = *reinterpret_cast<float*>(REL::RelocationID(527668, 414582).address());
-	static float& lightFadeEnd = *reinterpret_cast<float*>(REL::RelocationID(527669, 414583).address());
+	static auto& context = State::GetSingleton()->context;
 
-	float distance = CalculateLightDistance(light.positionWS[0].data, light.radius);
+	auto& readback = clusterStatisticsReadback[clusterStatisticsFrame % ARRAYSIZE(clusterStatisticsReadback)];
 
-	float dimmer = 0.0f;
+	// Read the counters copied when this staging buffer was last used, skipping them if the GPU is still behind
+	if (clusterStatisticsFrame >= ARRAYSIZE(clusterStatisticsReadback)) {
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		if (SUCCEEDED(context->Map(readback->resource.get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped))) {
+			clusterStatistics = *static_cast<ClusterStatistics*>(mapped.pData);
+			context->Unmap(readback->resource.get(), 0);
 
-	if (distance < lightFadeStart || lightFadeEnd == 0.0f) {
-		dimmer = 1.0f;
-	} else if (distance <= lightFadeEnd) {
-		dimmer = 1.0f - ((distance - lightFadeStart) / (lightFadeEnd - lightFadeStart));
-	} else {
-		dimmer = 0.0f;
+			clusterGridController.AddStatistics(clusterStatistics);
+		}
+	}
+
+	context->CopySubresourceRegion(readback->resource.get(), 0, 0, 0, 0, lightIndexCounter->resource.get(), 0, nullptr);
+	clusterStatisticsFrame++;
+}
+
+void LightLimitFix::UpdateClusterGrid()
+{
+	auto screenSize = GetClusterScreenSize();
+	if (clusterGridController.Update(lightCount, screenSize[0], screenSize[1]))
+		SetupClusterResources();
+}
+
+void LightLimitFix::InvalidateRooms()
+{
+	roomNodesDirty = true;
+}
+
+int LightLimitFix::GetRoomIndex(RE::NiNode* a_node)
+{
+	if (auto it = roomNodes.find(a_node); it != roomNodes.cend())
+		return it->second;
+
+	// Room flags are 128 bits wide
+	if (roomNodes.size() >= 128) {
+		logger::debug("[LLF] Room limit reached, ignoring room {:x}", reinterpret_cast<uintptr_t>(a_node));
+		return -1;
 	}
 
-	light.color *= dimmer;
+	auto roomIndex = static_cast<uint8_t>(roomNodes.size());
+	roomNodes.insert_or_assign(a_node, roomIndex);
+	return roomIndex;
+}
 
-	if ((light.color.x + light.color.y + light.color.z) > 1e-4 && light.radius > 1e-4) {
-		for (int eyeIndex = 0; eyeIndex < eyeCount; eyeIndex++)
-			light.positionVS[eyeIndex].data = DirectX::SimpleMath::Vector3::Transform(light.positionWS[eyeIndex].data, viewMatrixCached[eyeIndex]);
+const uint128_t& LightLimitFix::GetLightRoomFlags(uint32_t a_slot, RE::BSLight* a_light)
+{
+	auto& cache = lightSlotRooms[a_slot];
 
-		lightsData.push_back(light);
+	const auto& position = a_light->light->world.translate;
 
-		CachedParticleLight cachedParticleLight{};
-		cachedParticleLight.grey = float3(light.color.x, light.color.y, light.color.z).Dot(float3(0.3f, 0.59f, 0.11f));
-		cachedParticleLight.radius = light.radius;
-		cachedParticleLight.position = { light.positionWS[0].data.x + eyePositionCached[0].x, light.positionWS[0].data.y + eyePositionCached[0].y, light.positionWS[0].data.z + eyePositionCached[0].z };
+	bool roomsChanged = cache.rooms.size() != a_light->rooms.size() + a_light->portals.size();
+	if (!roomsChanged) {
+		uint32_t roomIndex = 0;
+		for (const auto& roomPtr : a_light->rooms)
+			roomsChanged |= cache.rooms[roomIndex++] != roomPtr;
+		for (const auto& portalPtr : a_light->portals)
+			roomsChanged |= cache.rooms[roomIndex++] != portalPtr->portalSharedNode.get();
+	}
+
+	// Only rebuild the mask when the light moved, its rooms or portals changed or the room table was rebuilt
+	if (cache.roomGeneration != roomGeneration || roomsChanged || cache.position != position) {
+		cache.roomFlags = uint32_t(0);
+		cache.rooms.clear();
+
+		// List of BSMultiBoundRooms affected by a light
+		for (const auto& roomPtr : a_light->rooms) {
+			cache.rooms.push_back(roomPtr);
+			if (auto roomIndex = GetRoomIndex(roomPtr); roomIndex >= 0)
+				cache.roomFlags.SetBit(roomIndex, 1);
+		}
+		// List of BSPortals affected by a light
+		for (const auto& portalPtr : a_light->portals) {
+			cache.rooms.push_back(portalPtr->portalSharedNode.get());
+			if (auto roomIndex = GetRoomIndex(portalPtr->portalSharedNode.get()); roomIndex >= 0)
+				cache.roomFlags.SetBit(roomIndex, 1);
+		}
 
-		cachedParticleLights.push_back(cachedParticleLight);
+		cache.position = position;
+		cache.roomGeneration = roomGeneration;
 	}
+
+	return cache.roomFlags;
 }
 
 float3 LightLimitFix::Saturation(float3 color, float saturation)
@@ -727,12 +919,16 @@ namespace RE
 
 void LightLimitFix::UpdateLights()
 {
+	PROFILE_CPU_SCOPE("LightLimitFix::UpdateLights");
+
 	static float& cameraNear = (*(float*)(REL::RelocationID(517032, 403540).address() + 0x40));
 	static float& cameraFar = (*(float*)(REL::RelocationID(517032, 403540).address() + 0x44));
 
 	lightsNear = cameraNear;
 	lightsFar = cameraFar;
 
+	UpdateClusterGrid();
+
 	static auto shadowSceneNode = RE::BSShaderManager::State::GetSingleton().shadowSceneNode[0];
 
 	// Cache data since cameraData can become invalid in first-person
@@ -743,23 +939,17 @@ void LightLimitFix::UpdateLights()
 		viewMatrixCached[eyeIndex].Invert(viewMatrixInverseCached[eyeIndex]);
 	}
 
-	eastl::vector<LightData> lightsData{};
-	lightsData.reserve(MAX_LIGHTS);
+	eastl::vector<LightData> particleLightsData{};
+	particleLightsData.reserve(MAX_LIGHTS);
 
-	// Process point lights
+	lightSlots.NextFrame();
 
-	roomNodes.empty();
+	// Process point lights
 
-	auto addRoom = [&](RE::NiNode* node, LightData& light) {
-		uint8_t roomIndex = 0;
-		if (auto it = roomNodes.find(node); it == roomNodes.cend()) {
-			roomIndex = static_cast<uint8_t>(roomNodes.size());
-			roomNodes.insert_or_assign(node, roomIndex);
-		} else {
-			roomIndex = it->second;
-		}
-		light.roomFlags.SetBit(roomIndex, 1);
-	};
+	if (roomNodesDirty.exchange(false)) {
+		roomNodes.clear();
+		roomGeneration++;
+	}
 
 	auto addLight = [&](const RE::NiPointer<RE::BSLight>& e) {
 		if (auto bsLight = e.get()) {
@@ -776,17 +966,9 @@ void LightLimitFix::UpdateLights()
 
 					light.lightFlags = static_cast<LightFlags>(runtimeData.ambient.red);
 
-					if (!IsGlobalLight(bsLight)) {
-						// List of BSMultiBoundRooms affected by a light
-						for (const auto& roomPtr : bsLight->rooms) {
-							addRoom(roomPtr, light);
-						}
-						// List of BSPortals affected by a light
-						for (const auto& portalPtr : bsLight->portals) {
-							addRoom(portalPtr->portalSharedNode.get(), light);
-						}
+					bool portalStrict = !IsGlobalLight(bsLight);
+					if (portalStrict)
 						light.lightFlags.set(LightFlags::PortalStrict);
-					}
 
 					if (bsLight->IsShadowLight()) {
 						auto* shadowLight = static_cast<RE::BSShadowLight*>(bsLight);
@@ -797,10 +979,19 @@ void LightLimitFix::UpdateLights()
 
 					// Check for inactive shadow light
 					if (light.shadowMaskIndex != 255) {
-						SetLightPosition(light, niLight->world.translate);
+						// World position only, so the slot stays clean while the camera moves
+						auto& position = niLight->world.translate;
+						light.positionWS[0].data = { position.x, position.y, position.z };
 
 						if ((light.color.x + light.color.y + light.color.z) > 1e-4 && light.radius > 1e-4) {
-							lightsData.push_back(light);
+							bool newSlot = false;
+							if (auto slot = lightSlots.Acquire(bsLight, &newSlot); slot != LightSlots<RE::BSLight*, LightData>::InvalidSlot) {
+								if (newSlot)
+									lightSlotRooms[slot] = {};
+								if (portalStrict)
+									light.roomFlags = GetLightRoomFlags(slot, bsLight);
+								lightSlots.Write(slot, light);
+							}
 						}
 					}
 				}
@@ -815,14 +1006,30 @@ void LightLimitFix::UpdateLights()
 		addLight(e);
 	}
 
+	lightSlots.ReleaseUnused([&](uint32_t a_from, uint32_t a_to) { lightSlotRooms[a_to] = std::move(lightSlotRooms[a_from]); });
+
 	{
 		std::lock_guard<std::shared_mutex> lk{ cachedParticleLightsMutex };
 		cachedParticleLights.clear();
 
-		LightData clusteredLight{};
-		uint32_t clusteredLights = 0;
+		static float& lightFadeStart = *reinterpret_cast<float*>(REL::RelocationID(527668, 414582).address());
+		static float& lightFadeEnd = *reinterpret_cast<float*>(REL::RelocationID(527669, 414583).address());
 
-		auto eyePositionOffset = eyePositionCached[0] - eyePositionCached[1];
+		ParticleMerger::Settings mergerSettings{};
+		mergerSettings.fadeStart = lightFadeStart;
+		mergerSettings.fadeEnd = lightFadeEnd;
+		mergerSettings.merge = settings.EnableParticleLightsOptimization;
+
+		ParticleMerger merger{ mergerSettings };
+		auto emitLight = [&](const ParticleMerger::Light& a_light) { AddCachedParticleLights(particleLightsData, a_light); };
+
+		validationParticles.clear();
+		validationParticleSettings = mergerSettings;
+		auto addParticle = [&](const ParticleMerger::Particle& a_particle) {
+			if (validateClusters)
+				validationParticles.push_back(a_particle);
+			merger.Add(a_particle, emitLight);
+		};
 
 		for (const auto& particleLight : particleLights) {
 			if (!particleLight.billboard) {
@@ -848,98 +1055,49 @@ void LightLimitFix::UpdateLights()
 
 						RE::NiPoint3 positionWS = initialPosition - eyePositionCached[0];
 
-						if (clusteredLights) {
-							auto averageRadius = clusteredLight.radius / (float)clusteredLights;
-							float radiusDiff = abs(averageRadius - radius);
-
-							auto averagePosition = clusteredLight.positionWS[0].data / (float)clusteredLights;
-							float positionDiff = positionWS.GetDistance({ averagePosition.x, averagePosition.y, averagePosition.z });
-
-							if ((radiusDiff + positionDiff) > 32.0f || !settings.EnableParticleLightsOptimization) {
-								clusteredLight.radius /= (float)clusteredLights;
-								clusteredLight.positionWS[0].data /= (float)clusteredLights;
-								clusteredLight.positionWS[1].data = clusteredLight.positionWS[0].data;
-								if (eyeCount == 2) {
-									clusteredLight.positionWS[1].data.x += eyePositionOffset.x / (float)clusteredLights;
-									clusteredLight.positionWS[1].data.y += eyePositionOffset.y / (float)clusteredLights;
-									clusteredLight.positionWS[1].data.z += eyePositionOffset.z / (float)clusteredLights;
-								}
-
-								clusteredLight.lightFlags.set(LightFlags::Simple);
-
-								AddCachedParticleLights(lightsData, clusteredLight);
-
-								clusteredLights = 0;
-								clusteredLight.color = { 0, 0, 0 };
-								clusteredLight.radius = 0;
-								clusteredLight.positionWS[0].data = { 0, 0, 0 };
-							}
-						}
-
+						float alpha = particleLight.color.alpha;
+						float3 color = { particleLight.color.red, particleLight.color.green, particleLight.color.blue };
 						if (particleRuntimeData.color) {
-							float alpha = particleLight.color.alpha * particleRuntimeData.color[p].alpha;
-
-							float3 color;
-							color.x = particleLight.color.red * particleRuntimeData.color[p].red;
-							color.y = particleLight.color.green * particleRuntimeData.color[p].green;
-							color.z = particleLight.color.blue * particleRuntimeData.color[p].blue;
-
-							clusteredLight.color += Saturation(color, settings.ParticleLightsSaturation) * alpha * settings.ParticleBrightness;
-						} else {
-							float alpha = particleLight.color.alpha;
-
-							float3 color;
-							color.x = particleLight.color.red;
-							color.y = particleLight.color.green;
-							color.z = particleLight.color.blue;
-
-							clusteredLight.color += Saturation(color, settings.ParticleLightsSaturation) * alpha * settings.ParticleBrightness;
+							alpha *= particleRuntimeData.color[p].alpha;
+							color.x *= particleRuntimeData.color[p].red;
+							color.y *= particleRuntimeData.color[p].green;
+							color.z *= particleRuntimeData.color[p].blue;
 						}
-
-						clusteredLight.radius += radius * particleLight.color.alpha * settings.ParticleRadius;
-
-						clusteredLight.positionWS[0].data.x += positionWS.x;
-						clusteredLight.positionWS[0].data.y += positionWS.y;
-						clusteredLight.positionWS[0].data.z += positionWS.z;
-
-						clusteredLights++;
+						color = Saturation(color, settings.ParticleLightsSaturation) * alpha * settings.ParticleBrightness;
+
+						ParticleMerger::Particle particle{};
+						particle.position[0] = positionWS.x;
+						particle.position[1] = positionWS.y;
+						particle.position[2] = positionWS.z;
+						particle.radius = radius;
+						particle.color[0] = color.x;
+						particle.color[1] = color.y;
+						particle.color[2] = color.z;
+						particle.lightRadius = radius * particleLight.color.alpha * settings.ParticleRadius;
+						addParticle(particle);
 					}
 				}
 			} else {
 				// Process billboard
-				LightData light{};
-
-				light.color.x = particleLight.color.red;
-				light.color.y = particleLight.color.green;
-				light.color.z = particleLight.color.blue;
-
-				light.color = Saturation(light.color, settings.ParticleLightsSaturation);
-
-				light.color *= particleLight.color.alpha * settings.BillboardBrightness;
-				light.radius = particleLight.node->worldBound.radius * particleLight.color.alpha * settings.BillboardRadius * 0.5f;
-
-				auto position = particleLight.node->world.translate;
-
-				SetLightPosition(light, position);  // Light is complete for both eyes by now
-
-				light.lightFlags.set(LightFlags::Simple);
-
-				AddCachedParticleLights(lightsData, light);
+				float3 color = { particleLight.color.red, particleLight.color.green, particleLight.color.blue };
+				color = Saturation(color, settings.ParticleLightsSaturation) * particleLight.color.alpha * settings.BillboardBrightness;
+
+				RE::NiPoint3 positionWS = particleLight.node->world.translate - eyePositionCached[0];
+
+				ParticleMerger::Particle particle{};
+				particle.position[0] = positionWS.x;
+				particle.position[1] = positionWS.y;
+				particle.position[2] = positionWS.z;
+				particle.color[0] = color.x;
+				particle.color[1] = color.y;
+				particle.color[2] = color.z;
+				particle.lightRadius = particleLight.node->worldBound.radius * particleLight.color.alpha * settings.BillboardRadius * 0.5f;
+				particle.single = true;
+				addParticle(particle);
 			}
 		}
 
-		if (clusteredLights) {
-			clusteredLight.radius /= (float)clusteredLights;
-			clusteredLight.positionWS[0].data /= (float)clusteredLights;
-			clusteredLight.positionWS[1].data = clusteredLight.positionWS[0].data;
-			if (eyeCount == 2) {
-				clusteredLight.positionWS[1].data.x += eyePositionOffset.x / (float)clusteredLights;
-				clusteredLight.positionWS[1].data.y += eyePositionOffset.y / (float)clusteredLights;
-				clusteredLight.positionWS[1].data.z += eyePositionOffset.z / (float)clusteredLights;
-			}
-			clusteredLight.lightFlags.set(LightFlags::Simple);
-			AddCachedParticleLights(lightsData, clusteredLight);
-		}
+		merger.Flush(emitLight);
 	}
 
 	static auto& context = State::GetSingleton()->context;
@@ -949,7 +1107,7 @@ void LightLimitFix::UpdateLights()
 		float fov = atan(1.0f / static_cast<float4x4>(projMatrixUnjittered).m[0][0]) * 2.0f * (180.0f / 3.14159265359f);
 
 		static float _lightsNear = 0.0f, _lightsFar = 0.0f, _fov = 0.0f;
-		if (fabs(_fov - fov) > 1e-4 || fabs(_lightsNear - lightsNear) > 1e-4 || fabs(_lightsFar - lightsFar) > 1e-4) {
+		if (clustersDirty || fabs(_fov - fov) > 1e-4 || fabs(_lightsNear - lightsNear) > 1e-4 || fabs(_lightsFar - lightsFar) > 1e-4) {
 			LightBuildingCB updateData{};
 			updateData.InvProjMatrix[0] = DirectX::XMMatrixInverse(nullptr, projMatrixUnjittered);
 			if (eyeCount == 1)
@@ -958,8 +1116,10 @@ void LightLimitFix::UpdateLights()
 				updateData.InvProjMatrix[1] = DirectX::XMMatrixInverse(nullptr, Util::GetCameraData(1).projMatrixUnjittered);
 			updateData.LightsNear = lightsNear;
 			updateData.LightsFar = lightsFar;
+			std::copy_n(clusterSize, 3, updateData.ClusterSize);
 
 			lightBuildingCB->Update(updateData);
+			lightBuildingData = updateData;
 
 			ID3D11Buffer* buffer = lightBuildingCB->CB();
 			context->CSSetConstantBuffers(0, 1, &buffer);
@@ -975,21 +1135,58 @@ void LightLimitFix::UpdateLights()
 
 			_fov = fov;
 			_lightsNear = lightsNear;
+			clustersDirty = false;
 			_lightsFar = lightsFar;
 		}
 	}
 
 	{
-		lightCount = std::min((uint)lightsData.size(), MAX_LIGHTS);
+		// Particle lights are rebuilt every frame, so they occupy the slots after the scene lights
+		uint sceneLightCount = lightSlots.Count();
+		uint particleLightCount = std::min((uint)particleLightsData.size(), MAX_LIGHTS - sceneLightCount);
+		for (uint i = 0; i < particleLightCount; i++)
+			lightSlots.Write(sceneLightCount + i, particleLightsData[i]);
+
+		lightCount = sceneLightCount + particleLightCount;
+
+		UploadLights();
+
+		LightTransformCB transformData{};
+		for (int eyeIndex = 0; eyeIndex < 2; eyeIndex++) {
+			int cachedEyeIndex = eyeIndex < eyeCount ? eyeIndex : 0;
+			auto& eyePosition = eyePositionCached[cachedEyeIndex];
+			transformData.ViewMatrix[eyeIndex] = viewMatrixCached[cachedEyeIndex];
+			transformData.EyePosition[eyeIndex] = { eyePosition.x, eyePosition.y, eyePosition.z, 0.0f };
+		}
+		transformData.LightCount = lightCount;
+		lightTransformCB->Update(transformData);
+		lightTransformData = transformData;
 
-		D3D11_MAPPED_SUBRESOURCE mapped;
-		DX::ThrowIfFailed(context->Map(lights->resource.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
-		size_t bytes = sizeof(LightData) * lightCount;
-		memcpy_s(mapped.pData, bytes, lightsData.data(), bytes);
-		context->Unmap(lights->resource.get(), 0);
+		if (lightCount > 0) {
+			ID3D11Buffer* buffer = lightTransformCB->CB();
+			context->CSSetConstantBuffers(0, 1, &buffer);
+
+			ID3D11ShaderResourceView* srv = worldLights->srv.get();
+			context->CSSetShaderResources(0, 1, &srv);
+
+			ID3D11UnorderedAccessView* uav = lights->uav.get();
+			context->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+
+			context->CSSetShader(lightTransformCS, nullptr, 0);
+			context->Dispatch((lightCount + 63) / 64, 1, 1);
+
+			ID3D11ShaderResourceView* null_srv = nullptr;
+			context->CSSetShaderResources(0, 1, &null_srv);
+
+			ID3D11UnorderedAccessView* null_uav = nullptr;
+			context->CSSetUnorderedAccessViews(0, 1, &null_uav, nullptr);
+		}
 
 		LightCullingCB updateData{};
 		updateData.LightCount = lightCount;
+		updateData.MaxClusterLights = clusterGridController.Get().maxClusterLights;
+		updateData.LightIndexListSize = clusterGridController.Get().lightIndexListSize;
+		std::copy_n(clusterSize, 3, updateData.ClusterSize);
 		lightCullingCB->Update(updateData);
 
 		UINT counterReset[4] = { 0, 0, 0, 0 };
@@ -1005,7 +1202,12 @@ void LightLimitFix::UpdateLights()
 		context->CSSetUnorderedAccessViews(0, ARRAYSIZE(uavs), uavs, nullptr);
 
 		context->CSSetShader(clusterCullingCS, nullptr, 0);
-		context->Dispatch((clusterSize[0] + 15) / 16, (clusterSize[1] + 15) / 16, (clusterSize[2] + 3) / 4);
+		{
+			PROFILE_GPU_SCOPE("Light Limit Fix - Cluster Culling");
+			context->Dispatch(clusterSize[0], clusterSize[1], clusterSize[2]);
+		}
+
+		ReadClusterStatistics();
 	}
 
 	context->CSSetShader(nullptr, nullptr, 0);
@@ -1018,4 +1220,122 @@ void LightLimitFix::UpdateLights()
 
 	ID3D11UnorderedAccessView* null_uavs[3] = { nullptr };
 	context->CSSetUnorderedAccessViews(0, 3, null_uavs, nullptr);
+
+	if (validateClusters) {
+		ValidateClusters();
+		validateClusters = false;
+	}
+}
+
+template <class T>
+static eastl::vector<T> ReadbackBuffer(Buffer* a_buffer)
+{
+	static auto& context = State::GetSingleton()->context;
+
+	D3D11_BUFFER_DESC desc = a_buffer->desc;
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.BindFlags = 0;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	Buffer staging(desc);
+	context->CopyResource(staging.resource.get(), a_buffer->resource.get());
+
+	eastl::vector<T> data(desc.ByteWidth / sizeof(T));
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	DX::ThrowIfFailed(context->Map(staging.resource.get(), 0, D3D11_MAP_READ, 0, &mapped));
+	memcpy(data.data(), mapped.pData, data.size() * sizeof(T));
+	context->Unmap(staging.resource.get(), 0);
+	return data;
+}
+
+// ClusterReference mirrors the GPU structs with plain types
+static_assert(sizeof(LightLimitFix::LightData) == sizeof(ClusterReference::Light));
+static_assert(offsetof(LightLimitFix::LightData, positionWS) == offsetof(ClusterReference::Light, positionWS));
+static_assert(offsetof(LightLimitFix::LightData, positionVS) == offsetof(ClusterReference::Light, positionVS));
+static_assert(offsetof(LightLimitFix::LightData, roomFlags) == offsetof(ClusterReference::Light, roomFlags));
+static_assert(offsetof(LightLimitFix::LightData, lightFlags) == offsetof(ClusterReference::Light, lightFlags));
+static_assert(sizeof(LightLimitFix::ClusterAABB) == sizeof(ClusterReference::ClusterAABB));
+static_assert(sizeof(LightLimitFix::LightGrid) == sizeof(ClusterReference::LightGrid));
+static_assert(sizeof(LightLimitFix::LightBuildingCB) == sizeof(ClusterReference::BuildingCB));
+static_assert(offsetof(LightLimitFix::LightBuildingCB, ClusterSize) == offsetof(ClusterReference::BuildingCB, ClusterSize));
+static_assert(sizeof(LightLimitFix::LightTransformCB) == sizeof(ClusterReference::TransformCB));
+static_assert(offsetof(LightLimitFix::LightTransformCB, LightCount) == offsetof(ClusterReference::TransformCB, LightCount));
+
+template <class To, class From>
+static To LayoutCast(const From& a_value)
+{
+	static_assert(sizeof(To) == sizeof(From));
+	To result;
+	memcpy(&result, &a_value, sizeof(To));
+	return result;
+}
+
+void LightLimitFix::ValidateClusters()
+{
+	// Stalls on the GPU, only meant to be used from the developer menu
+	auto gpuClusters = ReadbackBuffer<ClusterAABB>(clusters.get());
+	auto gpuLightGrid = ReadbackBuffer<LightGrid>(lightGrid.get());
+	auto gpuLightIndexList = ReadbackBuffer<uint>(lightIndexList.get());
+
+	ClusterReference::Snapshot snapshot;
+	snapshot.building = LayoutCast<ClusterReference::BuildingCB>(lightBuildingData);
+	snapshot.transform = LayoutCast<ClusterReference::TransformCB>(lightTransformData);
+	std::copy_n(clusterSize, 3, snapshot.clusterSize);
+	snapshot.maxClusterLights = clusterGridController.Get().maxClusterLights;
+	snapshot.eyeCount = eyeCount;
+	snapshot.maxLights = MAX_LIGHTS;
+	snapshot.particleOrigin = { eyePositionCached[0].x, eyePositionCached[0].y, eyePositionCached[0].z };
+	snapshot.particleSettings = validationParticleSettings;
+	snapshot.lights.resize(lightSlots.Count());
+	memcpy(snapshot.lights.data(), lightSlots.Staging(0), sizeof(LightData) * lightSlots.Count());
+	snapshot.particles.assign(validationParticles.begin(), validationParticles.end());
+
+	// Keep the inputs so the same frame can be replayed through ClusterReference::Run outside the game
+	auto snapshotPath = std::filesystem::path(State::GetSingleton()->folderPath) / "LightLimitFix" / "Snapshot.bin";
+	if (ClusterReference::SaveSnapshot(snapshotPath, snapshot))
+		logger::info("[LLF] Saved light snapshot to {}", snapshotPath.string());
+
+	auto start = std::chrono::high_resolution_clock::now();
+	auto cpuWorldLights = ClusterReference::GatherLights(snapshot);
+	auto gatherEnd = std::chrono::high_resolution_clock::now();
+	auto cpuClusters = ClusterReference::BuildClusters(snapshot.building, snapshot.clusterSize, snapshot.eyeCount);
+	auto buildEnd = std::chrono::high_resolution_clock::now();
+	auto transformedLights = ClusterReference::TransformLights(cpuWorldLights.data(), (uint)cpuWorldLights.size(), snapshot.transform);
+	auto cpuLights = ClusterReference::CullLights(cpuClusters, transformedLights.data(), (uint)transformedLights.size(), snapshot.maxClusterLights, snapshot.eyeCount);
+	auto cullEnd = std::chrono::high_resolution_clock::now();
+
+	// The particle lights merged again on the CPU must match the ones uploaded
+	uint comparedLights = std::min((uint)cpuWorldLights.size(), lightCount);
+	uint mismatchedLights = std::max((uint)cpuWorldLights.size(), lightCount) - comparedLights;
+	for (uint i = 0; i < comparedLights; i++) {
+		if (memcmp(&cpuWorldLights[i], lightSlots.Staging(i), sizeof(LightData)) != 0)
+			mismatchedLights++;
+	}
+
+	float maxAABBError = 0.0f;
+	for (size_t i = 0; i < cpuClusters.size(); i++) {
+		auto cpu = LayoutCast<ClusterAABB>(cpuClusters[i]);
+		maxAABBError = std::max(maxAABBError, (cpu.minPoint - gpuClusters[i].minPoint).Length());
+		maxAABBError = std::max(maxAABBError, (cpu.maxPoint - gpuClusters[i].maxPoint).Length());
+	}
+
+	uint mismatchedClusters = 0;
+	for (size_t i = 0; i < cpuLights.lightGrid.size(); i++) {
+		const auto& cpu = cpuLights.lightGrid[i];
+		const auto& gpu = gpuLightGrid[i];
+
+		bool match = cpu.lightCount == gpu.lightCount && gpu.offset + gpu.lightCount <= gpuLightIndexList.size() &&
+		             std::equal(cpuLights.lightIndexList.begin() + cpu.offset, cpuLights.lightIndexList.begin() + cpu.offset + cpu.lightCount, gpuLightIndexList.begin() + gpu.offset);
+
+		if (!match) {
+			if (mismatchedClusters < 16)
+				logger::debug("[LLF] Cluster {} mismatch: CPU {} lights, GPU {} lights", i, cpu.lightCount, gpu.lightCount);
+			mismatchedClusters++;
+		}
+	}
+
+	logger::info("[LLF] Cluster validation: {} lights ({} particles), {} mismatched lights, {} clusters, {} mismatched clusters, max AABB error {:.4f}, CPU gather {:.3f} ms, CPU build {:.3f} ms, CPU cull {:.3f} ms",
+		lightCount, snapshot.particles.size(), mismatchedLights, cpuClusters.size(), mismatchedClusters, maxAABBError,
+		std::chrono::duration<double, std::milli>(gatherEnd - start).count(),
+		std::chrono::duration<double, std::milli>(buildEnd - gatherEnd).count(),
+		std::chrono::duration<double, std::milli>(cullEnd - buildEnd).count());
 }
\ No newline at end of file
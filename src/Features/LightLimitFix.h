@@ -8,7 +8,11 @@
 
 #include "Feature.h"
 #include "ShaderCache.h"
+#include <Features/LightLimitFix/ClusterGrid.h>
+#include <Features/LightLimitFix/LightSlots.h>
 #include <Features/LightLimitFix/ParticleLights.h>
+#include <Features/LightLimitFix/ParticleMerger.h>
+#include <Features/LightLimitFix/StrictLightPool.h>
 
 struct LightLimitFix : Feature
 {
@@ -69,12 +73,26 @@ public:
 		float LightsNear;
 		float LightsFar;
 		uint pad0[2];
+		uint ClusterSize[3];
+		uint pad1;
+	};
+
+	struct alignas(16) LightTransformCB
+	{
+		float4x4 ViewMatrix[2];
+		float4 EyePosition[2];
+		uint LightCount;
+		uint pad0[3];
 	};
 
 	struct alignas(16) LightCullingCB
 	{
 		uint LightCount;
-		uint pad[3];
+		uint MaxClusterLights;
+		uint LightIndexListSize;
+		uint pad0;
+		uint ClusterSize[3];
+		uint pad1;
 	};
 
 	struct alignas(16) PerFrame
@@ -92,11 +110,22 @@ public:
 	{
 		uint NumStrictLights;
 		int RoomIndex;
-		uint pad0[2];
-		LightData StrictLights[15];
+		uint StrictLightsOffset;
+		uint pad0;
 	};
 
-	StrictLightDataCB strictLightDataTemp;
+	StrictLightDataCB strictLightDataTemp{};
+	LightData strictLightsTemp[15];
+
+	// Strict light sets are appended to one buffer that persists across frames, draws with the same lights share a range
+	eastl::unique_ptr<Buffer> strictLights = nullptr;
+	StrictLightPool<LightData, ankerl::unordered_dense::hash<std::string_view>> strictLightPool;
+	bool strictLightsNoOverwrite = false;
+	uint32_t strictLightDraws = 0;
+	uint32_t strictLightDrawsLastFrame = 0;
+	uint32_t strictLightUploadsLastFrame = 0;
+
+	uint32_t AllocateStrictLights(const LightData* a_lights, uint32_t a_count);
 
 	struct CachedParticleLight
 	{
@@ -113,10 +142,13 @@ public:
 
 	ID3D11ComputeShader* clusterBuildingCS = nullptr;
 	ID3D11ComputeShader* clusterCullingCS = nullptr;
+	ID3D11ComputeShader* lightTransformCS = nullptr;
 
 	ConstantBuffer* lightBuildingCB = nullptr;
+	ConstantBuffer* lightTransformCB = nullptr;
 	ConstantBuffer* lightCullingCB = nullptr;
 
+	eastl::unique_ptr<Buffer> worldLights = nullptr;
 	eastl::unique_ptr<Buffer> lights = nullptr;
 	eastl::unique_ptr<Buffer> clusters = nullptr;
 	eastl::unique_ptr<Buffer> lightIndexCounter = nullptr;
@@ -127,6 +159,33 @@ public:
 	float lightsNear = 1;
 	float lightsFar = 16384;
 
+	ClusterGridController clusterGridController;
+	ClusterStatistics clusterStatistics{};
+	eastl::unique_ptr<Buffer> clusterStatisticsReadback[3];
+	uint clusterStatisticsFrame = 0;
+	bool clustersDirty = true;
+
+	void SetupClusterResources();
+	std::array<uint, 2> GetClusterScreenSize();
+	void ReadClusterStatistics();
+	void UpdateClusterGrid();
+
+	LightBuildingCB lightBuildingData{};
+	LightTransformCB lightTransformData{};
+	bool validateClusters = false;
+	// Particles of the frame being validated, merged again by ClusterReference
+	eastl::vector<ParticleMerger::Particle> validationParticles;
+	ParticleMerger::Settings validationParticleSettings{};
+
+	void ValidateClusters();
+
+	// Scene lights keep a stable slot in the light buffer so only changed slots are uploaded,
+	// slots hold world positions and LightTransformCS makes them eye-relative every frame
+	LightSlots<RE::BSLight*, LightData> lightSlots;
+	size_t lightBytesUploaded = 0;
+
+	void UploadLights();
+
 	struct ParticleLightInfo
 	{
 		bool billboard;
@@ -166,8 +225,7 @@ public:
 	virtual void PostPostLoad() override;
 	virtual void DataLoaded() override;
 
-	float CalculateLightDistance(float3 a_lightPosition, float a_radius);
-	void AddCachedParticleLights(eastl::vector<LightData>& lightsData, LightLimitFix::LightData& light);
+	void AddCachedParticleLights(eastl::vector<LightData>& lightsData, const ParticleMerger::Light& a_light);
 	void SetLightPosition(LightLimitFix::LightData& a_light, RE::NiPoint3 a_initialPosition, bool a_cached = true);
 	void UpdateLights();
 	virtual void Prepass() override;
@@ -215,7 +273,24 @@ public:
 	std::shared_mutex cachedParticleLightsMutex;
 	eastl::vector<CachedParticleLight> cachedParticleLights;
 
+	// Room and portal nodes of the current cell, kept until the player changes cell
 	eastl::hash_map<RE::NiNode*, uint8_t> roomNodes;
+	std::atomic<bool> roomNodesDirty = true;
+	uint32_t roomGeneration = 0;
+
+	struct LightRoomCache
+	{
+		uint128_t roomFlags = uint32_t(0);
+		RE::NiPoint3 position;
+		eastl::vector<RE::NiNode*> rooms;  // rooms and portal nodes the mask was built from
+		uint32_t roomGeneration = UINT32_MAX;
+	};
+
+	eastl::vector<LightRoomCache> lightSlotRooms;
+
+	void InvalidateRooms();
+	int GetRoomIndex(RE::NiNode* a_node);
+	const uint128_t& GetLightRoomFlags(uint32_t a_slot, RE::BSLight* a_light);
 
 	float CalculateLuminance(CachedParticleLight& light, RE::NiPoint3& point);
 	void AddParticleLightLuminance(RE::NiPoint3& targetPosition, int& numHits, float& lightLevel);
@@ -2,6 +2,8 @@
 #include "Menu.h"
 
 #include "Deferred.h"
+#include "FrameBudget.h"
+#include "Profiler.h"
 #include "State.h"
 #include "Util.h"
 
@@ -498,6 +500,8 @@ void ScreenSpaceGI::ClearShaderCache()
 
 void ScreenSpaceGI::CompileComputeShaders()
 {
+	Profiler::StutterScope stutter(Profiler::StutterCause::ComputeShaderCompile);
+
 	struct ShaderCompileInfo
 	{
 		winrt::com_ptr<ID3D11ComputeShader>* programPtr;
@@ -572,8 +576,11 @@ void ScreenSpaceGI::UpdateSB()
 		data.RcpFrameDim = float2(1.0f) / dynres;
 		data.FrameIndex = viewport->frameCount;
 
-		data.NumSlices = settings.NumSlices;
-		data.NumSteps = settings.NumSteps;
+		static auto costScope = Profiler::GetSingleton()->RegisterScope("SSGI");
+		static auto slicesKnob = FrameBudget::GetSingleton()->RegisterKnob("SSGI Slices", 2, 0.5f, 0.125f, costScope);
+		static auto stepsKnob = FrameBudget::GetSingleton()->RegisterKnob("SSGI Steps", 1, 0.5f, 0.125f, costScope);
+		data.NumSlices = FrameBudget::GetSingleton()->Scale(slicesKnob, settings.NumSlices);
+		data.NumSteps = FrameBudget::GetSingleton()->Scale(stepsKnob, settings.NumSteps);
 		data.MinScreenRadius = settings.MinScreenRadius * dynres.x;
 
 		data.EffectRadius = std::max(settings.AORadius, settings.GIRadius);
@@ -615,6 +622,7 @@ void ScreenSpaceGI::DrawSSGI(Texture2D* srcPrevAmbient)
 
 	ZoneScoped;
 	TracyD3D11Zone(State::GetSingleton()->tracyCtx, "SSGI");
+	PROFILE_GPU_SCOPE("SSGI");
 
 	static uint lastFrameAoTexIdx = 0;
 	static uint lastFrameGITexIdx = 0;
@@ -1,15 +1,22 @@
 #include "Skylighting.h"
+#include "Skylighting/OcclusionCache.h"
+#include <FrameBudget.h>
+#include <Profiler.h>
 #include <ShaderCache.h>
 
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
 	Skylighting::Settings,
 	MaxZenith,
 	MinDiffuseVisibility,
-	MinSpecularVisibility)
+	MinSpecularVisibility,
+	ProbeResolution,
+	PersistOcclusion)
 
 void Skylighting::LoadSettings(json& o_json)
 {
 	settings = o_json;
+	settings.ProbeResolution = std::min(settings.ProbeResolution, (uint)ProbeResolutions.size() - 1);
+	UpdateProbeResolution();
 }
 
 void Skylighting::SaveSettings(json& o_json)
@@ -20,6 +27,7 @@ void Skylighting::SaveSettings(json& o_json)
 void Skylighting::RestoreDefaultSettings()
 {
 	settings = {};
+	UpdateProbeResolution();
 }
 
 void Skylighting::DrawSettings()
@@ -46,6 +54,39 @@ void Skylighting::DrawSettings()
 	ImGui::SliderAngle("Max Zenith Angle", &settings.MaxZenith, 0, 90);
 	if (auto _tt = Util::HoverTooltipWrapper())
 		ImGui::Text("Smaller angles creates more focused top-down shadow.");
+
+	ImGui::Checkbox("Persist Occlusion", &settings.PersistOcclusion);
+	if (auto _tt = Util::HoverTooltipWrapper())
+		ImGui::Text(
+			"Saves the converged skylighting of exterior areas when leaving them through a loading screen, and restores it when coming back.\n"
+			"The cache of a previous load order is deleted the next time an area is saved, and the cache is limited to %llu MB.",
+			MaxOcclusionCacheSize >> 20);
+
+	// Scales the dense probe volume as a whole, separate from the look of the lighting above
+	ImGui::SeparatorText("Video Memory");
+
+	static const auto resolutionNames = [] {
+		constexpr std::array<const char*, ProbeResolutions.size()> labels = { "Low", "Medium", "High" };
+		std::array<std::string, ProbeResolutions.size()> names;
+		for (size_t i = 0; i < names.size(); i++) {
+			const auto& dims = ProbeResolutions[i];
+			names[i] = std::format("{} ({}x{}x{} probes, {} MB)", labels[i], dims[0], dims[1], dims[2], GetProbeVolumeSize(dims) >> 20);
+		}
+		return names;
+	}();
+	if (ImGui::BeginCombo("Probe Volume Resolution", resolutionNames[settings.ProbeResolution].c_str())) {
+		for (uint i = 0; i < (uint)resolutionNames.size(); i++) {
+			if (ImGui::Selectable(resolutionNames[i].c_str(), i == settings.ProbeResolution) && i != settings.ProbeResolution) {
+				settings.ProbeResolution = i;
+				CreateProbeArray();
+			}
+		}
+		ImGui::EndCombo();
+	}
+	if (auto _tt = Util::HoverTooltipWrapper())
+		ImGui::Text(
+			"Number of probes in the volume around the camera, which always covers the same distance. Every probe is stored, occupied or not.\n"
+			"Lower resolutions use much less video memory but give blurrier shadows. Changing it rebuilds skylighting.");
 }
 
 void Skylighting::SetupResources()
@@ -69,44 +110,7 @@ void Skylighting::SetupResources()
 		texOcclusion->CreateDSV(dsvDesc);
 	}
 
-	{
-		D3D11_TEXTURE3D_DESC texDesc{
-			.Width = probeArrayDims[0],
-			.Height = probeArrayDims[1],
-			.Depth = probeArrayDims[2],
-			.MipLevels = 1,
-			.Format = DXGI_FORMAT_R16G16B16A16_FLOAT,
-			.Usage = D3D11_USAGE_DEFAULT,
-			.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS,
-			.CPUAccessFlags = 0,
-			.MiscFlags = 0
-		};
-		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {
-			.Format = texDesc.Format,
-			.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE3D,
-			.Texture3D = {
-				.MostDetailedMip = 0,
-				.MipLevels = texDesc.MipLevels }
-		};
-		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {
-			.Format = texDesc.Format,
-			.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE3D,
-			.Texture3D = {
-				.MipSlice = 0,
-				.FirstWSlice = 0,
-				.WSize = texDesc.Depth }
-		};
-
-		texProbeArray = new Texture3D(texDesc);
-		texProbeArray->CreateSRV(srvDesc);
-		texProbeArray->CreateUAV(uavDesc);
-
-		texDesc.Format = srvDesc.Format = uavDesc.Format = DXGI_FORMAT_R8_UINT;
-
-		texAccumFramesArray = new Texture3D(texDesc);
-		texAccumFramesArray->CreateSRV(srvDesc);
-		texAccumFramesArray->CreateUAV(uavDesc);
-	}
+	CreateProbeArray();
 
 	{
 		D3D11_SAMPLER_DESC samplerDesc = {
@@ -124,6 +128,65 @@ void Skylighting::SetupResources()
 	CompileComputeShaders();
 }
 
+void Skylighting::UpdateProbeResolution()
+{
+	// Settings can be loaded before the resources exist, SetupResources creates the volume then
+	if (!texProbeArray)
+		return;
+
+	const auto& dims = ProbeResolutions[settings.ProbeResolution];
+	if (!std::equal(dims.begin(), dims.end(), probeArrayDims))
+		CreateProbeArray();
+}
+
+void Skylighting::CreateProbeArray()
+{
+	const auto& dims = ProbeResolutions[settings.ProbeResolution];
+	std::copy(dims.begin(), dims.end(), probeArrayDims);
+
+	delete texProbeArray;
+	delete texAccumFramesArray;
+
+	D3D11_TEXTURE3D_DESC texDesc{
+		.Width = probeArrayDims[0],
+		.Height = probeArrayDims[1],
+		.Depth = probeArrayDims[2],
+		.MipLevels = 1,
+		.Format = DXGI_FORMAT_R16G16B16A16_FLOAT,
+		.Usage = D3D11_USAGE_DEFAULT,
+		.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS,
+		.CPUAccessFlags = 0,
+		.MiscFlags = 0
+	};
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {
+		.Format = texDesc.Format,
+		.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE3D,
+		.Texture3D = {
+			.MostDetailedMip = 0,
+			.MipLevels = texDesc.MipLevels }
+	};
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {
+		.Format = texDesc.Format,
+		.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE3D,
+		.Texture3D = {
+			.MipSlice = 0,
+			.FirstWSlice = 0,
+			.WSize = texDesc.Depth }
+	};
+
+	texProbeArray = new Texture3D(texDesc);
+	texProbeArray->CreateSRV(srvDesc);
+	texProbeArray->CreateUAV(uavDesc);
+
+	texDesc.Format = srvDesc.Format = uavDesc.Format = DXGI_FORMAT_R8_UINT;
+
+	texAccumFramesArray = new Texture3D(texDesc);
+	texAccumFramesArray->CreateSRV(srvDesc);
+	texAccumFramesArray->CreateUAV(uavDesc);
+
+	forceFrames = 255 * 4;
+}
+
 void Skylighting::ClearShaderCache()
 {
 	static const std::vector<winrt::com_ptr<ID3D11ComputeShader>*> shaderPtrs = {
@@ -157,23 +220,28 @@ void Skylighting::CompileComputeShaders()
 	}
 }
 
-Skylighting::SkylightingCB Skylighting::GetCommonBufferData()
+float3 Skylighting::GetProbeCellSize() const
 {
-	static float3 prevCellID = { 0, 0, 0 };
-
-	auto eyePosNI = Util::GetEyePosition(0);
-	auto eyePos = float3{ eyePosNI.x, eyePosNI.y, eyePosNI.z };
-
-	float3 cellSize = {
+	return {
 		occlusionDistance / probeArrayDims[0],
 		occlusionDistance / probeArrayDims[1],
 		occlusionDistance * .5f / probeArrayDims[2]
 	};
+}
+
+Skylighting::SkylightingCB Skylighting::GetCommonBufferData()
+{
+	auto eyePosNI = Util::GetEyePosition(0);
+	auto eyePos = float3{ eyePosNI.x, eyePosNI.y, eyePosNI.z };
+
+	float3 cellSize = GetProbeCellSize();
 	auto cellID = eyePos / cellSize;
 	cellID = { round(cellID.x), round(cellID.y), round(cellID.z) };
 	auto cellOrigin = cellID * cellSize;
 	float3 cellIDDiff = prevCellID - cellID;
 	prevCellID = cellID;
+	cellMoved = cellIDDiff.x != 0 || cellIDDiff.y != 0 || cellIDDiff.z != 0;
+	framesSinceProbeUpdate = std::min(framesSinceProbeUpdate + 1, 255u);
 
 	return {
 		.OcclusionViewProj = OcclusionTransform,
@@ -184,16 +252,257 @@ Skylighting::SkylightingCB Skylighting::GetCommonBufferData()
 			((int)cellID.y - probeArrayDims[1] / 2) % probeArrayDims[1],
 			((int)cellID.z - probeArrayDims[2] / 2) % probeArrayDims[2] },
 		.ValidMargin = { (int)cellIDDiff.x, (int)cellIDDiff.y, (int)cellIDDiff.z },
+		.ArrayDim = { probeArrayDims[0], probeArrayDims[1], probeArrayDims[2] },
 		.MinDiffuseVisibility = settings.MinDiffuseVisibility,
-		.MinSpecularVisibility = settings.MinSpecularVisibility
+		.MinSpecularVisibility = settings.MinSpecularVisibility,
+		.AccumFrames = framesSinceProbeUpdate
+	};
+}
+
+uint Skylighting::SelectOcclusionQuadrant()
+{
+	// Camera forward in occlusion clip space, the quadrant projections only scale and offset so the signs hold for all of them
+	auto cameraData = Util::GetCameraData(0);
+	auto forward = *(float3*)&cameraData.viewForward;
+	float2 forwardOS = {
+		OcclusionTransform._11 * forward.x + OcclusionTransform._12 * forward.y + OcclusionTransform._13 * forward.z,
+		OcclusionTransform._21 * forward.x + OcclusionTransform._22 * forward.y + OcclusionTransform._23 * forward.z
+	};
+	forwardOS.Normalize();
+
+	uint selected = 0;
+	for (uint corner = 0; corner < 4; corner++) {
+		// bit 0: right half, bit 1: top half, see SetViewFrustum
+		float2 quadrantDir = { (corner & 1) ? 0.7071f : -0.7071f, (corner & 2) ? 0.7071f : -0.7071f };
+		quadrantAge[corner] += 1.0f + 2.0f * std::max(0.0f, forwardOS.Dot(quadrantDir));
+		if (quadrantAge[corner] > quadrantAge[selected])
+			selected = corner;
+	}
+	quadrantAge[selected] = 0.0f;
+	return selected;
+}
+
+//////////////////////////////////////////////////////////////
+
+struct OcclusionCacheHeader
+{
+	static constexpr uint32_t Magic = 'SKYC';
+	static constexpr uint32_t Version = 2;
+
+	uint32_t magic = Magic;
+	uint32_t version = Version;
+	uint32_t dims[3];
+	int32_t cellID[3];
+	uint32_t runCount;    // runs of equal accumulation counts and storage
+	uint32_t probeCount;  // quantised probes of the stored runs, the others are the unit probe
+};
+
+static void WriteOcclusionCache(const std::filesystem::path& a_path, OcclusionCacheHeader a_header, const std::vector<uint8_t>& a_accumFrames, const std::vector<uint8_t>& a_probes)
+{
+	std::vector<OcclusionCache::Run> runs;
+	std::vector<uint32_t> storedProbes;
+	OcclusionCache::Encode(a_accumFrames, { (const uint64_t*)a_probes.data(), a_accumFrames.size() }, runs, storedProbes);
+
+	a_header.runCount = (uint32_t)runs.size();
+	a_header.probeCount = (uint32_t)storedProbes.size();
+
+	std::error_code ec;
+	std::filesystem::create_directories(a_path.parent_path(), ec);
+	std::ofstream file(a_path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		logger::warn("[SKYLIGHTING] Failed to write occlusion cache {}", a_path.string());
+		return;
+	}
+	file.write((const char*)&a_header, sizeof(a_header));
+	file.write((const char*)runs.data(), runs.size() * sizeof(OcclusionCache::Run));
+	file.write((const char*)storedProbes.data(), storedProbes.size() * sizeof(uint32_t));
+	file.close();
+
+	logger::debug("[SKYLIGHTING] Saved occlusion cache {} ({} probes)", a_path.string(), storedProbes.size());
+
+	Util::RemoveStaleCacheDirectories(a_path.parent_path().parent_path(), a_path.parent_path().filename());
+	Util::TrimCacheDirectory(a_path.parent_path(), Skylighting::MaxOcclusionCacheSize);
+}
+
+std::filesystem::path Skylighting::GetOcclusionCachePath(const float3& a_position) const
+{
+	auto player = RE::PlayerCharacter::GetSingleton();
+	if (!player)
+		return {};
+
+	auto cell = player->GetParentCell();
+	auto worldspace = player->GetWorldspace();
+	if (!cell || cell->IsInteriorCell() || !worldspace)
+		return {};
+
+	// Exterior cells are 4096 units wide
+	int gridX = (int)std::floor(a_position.x / 4096.f);
+	int gridY = (int)std::floor(a_position.y / 4096.f);
+
+	return std::filesystem::path(State::GetSingleton()->folderPath) / "SkylightingCache" / std::format("{:016X}", Util::GetLoadOrderHash()) /
+	       std::format("{:08X}_{}_{}_{}.bin", worldspace->GetFormID(), gridX, gridY, settings.ProbeResolution);
+}
+
+static std::vector<uint8_t> ReadbackTexture(Texture3D* a_texture, uint a_texelSize)
+{
+	auto& context = State::GetSingleton()->context;
+
+	D3D11_TEXTURE3D_DESC desc = a_texture->desc;
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.BindFlags = 0;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+	Texture3D staging(desc);
+	context->CopyResource(staging.resource.get(), a_texture->resource.get());
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(staging.resource.get(), 0, D3D11_MAP_READ, 0, &mapped)))
+		return {};
+
+	uint rowSize = desc.Width * a_texelSize;
+	std::vector<uint8_t> data((size_t)rowSize * desc.Height * desc.Depth);
+	for (uint z = 0; z < desc.Depth; z++)
+		for (uint y = 0; y < desc.Height; y++)
+			memcpy(data.data() + ((size_t)z * desc.Height + y) * rowSize, (uint8_t*)mapped.pData + (size_t)z * mapped.DepthPitch + (size_t)y * mapped.RowPitch, rowSize);
+
+	context->Unmap(staging.resource.get(), 0);
+	return data;
+}
+
+void Skylighting::SaveOcclusionCache()
+{
+	// Only converged volumes are worth keeping
+	if (!settings.PersistOcclusion || forceFrames || !texProbeArray)
+		return;
+
+	float3 cellSize = GetProbeCellSize();
+	auto path = GetOcclusionCachePath(prevCellID * cellSize);
+	if (path.empty())
+		return;
+
+	std::vector<uint8_t> accumFrames, probes;
+	{
+		Profiler::StutterScope stutter(Profiler::StutterCause::SkylightingCache);
+		accumFrames = ReadbackTexture(texAccumFramesArray, sizeof(uint8_t));
+		probes = ReadbackTexture(texProbeArray, sizeof(uint64_t));
+	}
+	if (accumFrames.empty() || probes.size() != accumFrames.size() * sizeof(uint64_t))
+		return;
+
+	OcclusionCacheHeader header{
+		.dims = { probeArrayDims[0], probeArrayDims[1], probeArrayDims[2] },
+		.cellID = { (int32_t)prevCellID.x, (int32_t)prevCellID.y, (int32_t)prevCellID.z }
 	};
+
+	// Encoding and writing happen on a worker, only the readback stays on the render thread
+	if (pendingCacheWrite.valid())
+		pendingCacheWrite.wait();
+	pendingCacheWrite = std::async(std::launch::async, [path, header, accumFrames = std::move(accumFrames), probes = std::move(probes)]() {
+		WriteOcclusionCache(path, header, accumFrames, probes);
+	});
+}
+
+bool Skylighting::RestoreOcclusionCache()
+{
+	if (!settings.PersistOcclusion)
+		return false;
+
+	auto eyePosNI = Util::GetEyePosition(0);
+	auto eyePos = float3{ eyePosNI.x, eyePosNI.y, eyePosNI.z };
+	auto path = GetOcclusionCachePath(eyePos);
+	if (path.empty())
+		return false;
+
+	// The area may have been saved just before the loading screen
+	if (pendingCacheWrite.valid())
+		pendingCacheWrite.wait();
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	Profiler::StutterScope stutter(Profiler::StutterCause::SkylightingCache);
+
+	OcclusionCacheHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (!file || header.magic != OcclusionCacheHeader::Magic || header.version != OcclusionCacheHeader::Version ||
+		header.dims[0] != probeArrayDims[0] || header.dims[1] != probeArrayDims[1] || header.dims[2] != probeArrayDims[2])
+		return false;
+
+	// The array is addressed by absolute cell modulo its size, so the overlap with the current volume is already in place
+	float3 cellSize = GetProbeCellSize();
+	auto cellID = eyePos / cellSize;
+	cellID = { round(cellID.x), round(cellID.y), round(cellID.z) };
+	float3 overlap = { 1, 1, 1 };
+	for (uint i = 0; i < 3; i++) {
+		int offset = std::abs(header.cellID[i] - (int)(&cellID.x)[i]);
+		if (offset >= (int)probeArrayDims[i])
+			return false;
+		(&overlap.x)[i] = (float)(probeArrayDims[i] - offset) / probeArrayDims[i];
+	}
+
+	size_t probeTotal = (size_t)probeArrayDims[0] * probeArrayDims[1] * probeArrayDims[2];
+	std::vector<OcclusionCache::Run> runs(header.runCount);
+	std::vector<uint32_t> storedProbes(header.probeCount);
+	file.read((char*)runs.data(), runs.size() * sizeof(OcclusionCache::Run));
+	file.read((char*)storedProbes.data(), storedProbes.size() * sizeof(uint32_t));
+	if (!file)
+		return false;
+
+	std::vector<uint8_t> accumFrames;
+	std::vector<uint64_t> probes;
+	if (!OcclusionCache::Decode(runs, storedProbes, probeTotal, accumFrames, probes)) {
+		logger::warn("[SKYLIGHTING] Discarding corrupt occlusion cache {}", path.string());
+		return false;
+	}
+
+	auto& context = State::GetSingleton()->context;
+	context->UpdateSubresource(texProbeArray->resource.get(), 0, nullptr, probes.data(), probeArrayDims[0] * sizeof(uint64_t), probeArrayDims[0] * probeArrayDims[1] * sizeof(uint64_t));
+	context->UpdateSubresource(texAccumFramesArray->resource.get(), 0, nullptr, accumFrames.data(), probeArrayDims[0], probeArrayDims[0] * probeArrayDims[1]);
+
+	// The next scroll from the cached cell to the current one resets the probes that were not in the cached volume
+	prevCellID = { (float)header.cellID[0], (float)header.cellID[1], (float)header.cellID[2] };
+	forceFrames = (uint)std::ceil(255 * 4 * (1.0f - overlap.x * overlap.y * overlap.z));
+
+	// Mark as recently used for trimming
+	std::error_code ec;
+	std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+	logger::debug("[SKYLIGHTING] Restored occlusion cache {} ({} probes)", path.string(), storedProbes.size());
+	return true;
 }
 
 void Skylighting::Prepass()
+{
+	auto& context = State::GetSingleton()->context;
+
+	bool restored = false;
+	if (pendingCacheRestore) {
+		pendingCacheRestore = false;
+		restored = RestoreOcclusionCache();
+	}
+
+	// Nothing new to accumulate, running the update again would only re-weight the last sample.
+	// Each sample is weighted by the frames since the previous update so the fade in keeps its per-frame pace.
+	// Right after a restore the constant buffer still describes the volume from before the loading screen.
+	if (!restored && (occlusionUpdated || cellMoved))
+		UpdateProbes();
+
+	// set PS shader resource
+	{
+		ID3D11ShaderResourceView* srv = texProbeArray->srv.get();
+		context->PSSetShaderResources(50, 1, &srv);
+	}
+}
+
+void Skylighting::UpdateProbes()
 {
 	TracyD3D11Zone(State::GetSingleton()->tracyCtx, "Skylighting - Update Probes");
+	PROFILE_GPU_SCOPE("Skylighting - Update Probes");
 
 	auto& context = State::GetSingleton()->context;
+	occlusionUpdated = false;
+	framesSinceProbeUpdate = 0;
 
 	std::array<ID3D11ShaderResourceView*, 1> srvs = { texOcclusion->srv.get() };
 	std::array<ID3D11UnorderedAccessView*, 2> uavs = { texProbeArray->uav.get(), texAccumFramesArray->uav.get() };
@@ -219,12 +528,6 @@ void Skylighting::Prepass()
 		context->CSSetUnorderedAccessViews(0, (uint)uavs.size(), uavs.data(), nullptr);
 		context->CSSetShader(nullptr, nullptr, 0);
 	}
-
-	// set PS shader resource
-	{
-		ID3D11ShaderResourceView* srv = texProbeArray->srv.get();
-		context->PSSetShaderResources(50, 1, &srv);
-	}
 }
 
 void Skylighting::PostPostLoad()
@@ -411,10 +714,14 @@ void Skylighting::Main_Precipitation_RenderOcclusion::thunk()
 				std::chrono::time_point<std::chrono::system_clock> currentTimer = std::chrono::system_clock::now();
 				auto timePassed = std::chrono::duration_cast<std::chrono::milliseconds>(currentTimer - singleton->lastUpdateTimer).count();
 
-				if (singleton->forceFrames || timePassed >= (1000.0f / 30.0f)) {
+				static auto costScope = Profiler::GetSingleton()->RegisterScope("Skylighting - Render Occlusion");
+				static auto renderTask = FrameBudget::GetSingleton()->RegisterTask("Skylighting - Render Occlusion", 1, 4, costScope);
+				if (singleton->forceFrames || (timePassed >= (1000.0f / 30.0f) && FrameBudget::GetSingleton()->Request(renderTask))) {
+					PROFILE_GPU_SCOPE("Skylighting - Render Occlusion");
 					singleton->forceFrames = (uint)std::max(0, (int)singleton->forceFrames - 1);
 					singleton->lastUpdateTimer = currentTimer;
 					singleton->frameCount++;
+					singleton->occlusionQuadrant = singleton->SelectOcclusionQuadrant();
 
 					auto renderer = RE::BSGraphics::Renderer::GetSingleton();
 					auto& precipitation = renderer->GetDepthStencilData().depthStencils[RE::RENDER_TARGETS_DEPTHSTENCIL::kPRECIPITATION_OCCLUSION_MAP];
@@ -480,6 +787,8 @@ void Skylighting::Main_Precipitation_RenderOcclusion::thunk()
 
 					delete rain;
 
+					singleton->occlusionUpdated = true;
+
 					PrecipitationShaderCubeSize = originalPrecipitationShaderCubeSize;
 					precip->lastCubeSize = originaLastCubeSize;
 
@@ -496,7 +805,7 @@ void Skylighting::Main_Precipitation_RenderOcclusion::thunk()
 void Skylighting::SetViewFrustum::thunk(RE::NiCamera* a_camera, RE::NiFrustum* a_frustum)
 {
 	if (GetSingleton()->inOcclusion) {
-		uint corner = GetSingleton()->frameCount % 4;
+		uint corner = GetSingleton()->occlusionQuadrant;
 
 		a_frustum->fBottom = (corner == 0 || corner == 1) ? -5000.0f : 0.0f;
 
@@ -29,8 +29,11 @@ struct Skylighting : Feature
 	virtual void SetupResources() override;
 	virtual void ClearShaderCache() override;
 	void CompileComputeShaders();
+	void CreateProbeArray();
+	void UpdateProbeResolution();
 
 	virtual void Prepass() override;
+	void UpdateProbes();
 
 	virtual void PostPostLoad() override;
 
@@ -42,8 +45,24 @@ struct Skylighting : Feature
 		float MinDiffuseVisibility = 0.1f;
 		float MinSpecularVisibility = 0.f;
 		uint pad0;
+		uint ProbeResolution = 2;  // index into ProbeResolutions, High (72 MB) like the fixed volume it replaced
+		bool PersistOcclusion = true;
 	} settings;
 
+	// Probe counts of the dense volume, which always covers occlusionDistance around the camera.
+	// Powers of two only, the toroidal addressing relies on unsigned wraparound.
+	static constexpr std::array<std::array<uint, 3>, 3> ProbeResolutions = { {
+		{ 128, 128, 64 },
+		{ 256, 256, 64 },
+		{ 256, 256, 128 },
+	} };
+
+	// Video memory of a probe volume, an RGBA16F probe and an R8 accumulation counter per probe
+	static constexpr size_t GetProbeVolumeSize(const std::array<uint, 3>& a_dims)
+	{
+		return (size_t)a_dims[0] * a_dims[1] * a_dims[2] * (sizeof(uint64_t) + sizeof(uint8_t));
+	}
+
 	struct SkylightingCB
 	{
 		REX::W32::XMFLOAT4X4 OcclusionViewProj;
@@ -54,14 +73,28 @@ struct Skylighting : Feature
 		uint ArrayOrigin[3];  // xyz: array origin, w: max accum frames
 		uint _pad1;
 		int ValidMargin[4];
+		uint ArrayDim[3];
+		uint _pad3;
 
 		float MinDiffuseVisibility;
 		float MinSpecularVisibility;
-		uint _pad2[2];
+		uint AccumFrames;  // frames the probe update accounts for, it no longer runs every frame
+		uint _pad2;
 	};
 	static_assert(sizeof(SkylightingCB) % 16 == 0);
 
 	SkylightingCB GetCommonBufferData();
+	float3 GetProbeCellSize() const;
+
+	// Converged probes are kept on disk per worldspace cell and load order, quantised to 8 bits per coefficient,
+	// and restored when the area is entered again
+	static constexpr uint64_t MaxOcclusionCacheSize = 512ull << 20;
+	std::filesystem::path GetOcclusionCachePath(const float3& a_position) const;
+	void SaveOcclusionCache();
+	bool RestoreOcclusionCache();
+
+	// Picks the occlusion quadrant to render next, the stalest one weighted towards where the camera looks
+	uint SelectOcclusionQuadrant();
 
 	winrt::com_ptr<ID3D11SamplerState> pointClampSampler = nullptr;
 
@@ -73,7 +106,7 @@ struct Skylighting : Feature
 
 	// misc parameters
 	bool doOcclusion = true;
-	uint probeArrayDims[3] = { 256, 256, 128 };
+	uint probeArrayDims[3] = {};
 	float occlusionDistance = 4096.f * 3.f;  // 3 cells
 
 	// cached variables
@@ -83,6 +116,17 @@ struct Skylighting : Feature
 	uint forceFrames = 255 * 4;
 	uint frameCount = 0;
 
+	// The probe update only accumulates new information when there is a fresh occlusion sample or the volume scrolled
+	bool occlusionUpdated = false;
+	bool cellMoved = false;
+	uint framesSinceProbeUpdate = 0;
+	float3 prevCellID = { 0, 0, 0 };
+	bool pendingCacheRestore = false;
+	std::future<void> pendingCacheWrite;
+
+	uint occlusionQuadrant = 0;
+	std::array<float, 4> quadrantAge = {};
+
 	std::chrono::time_point<std::chrono::system_clock> lastUpdateTimer = std::chrono::system_clock::now();
 
 	//////////////////////////////////////////////////////////////////////////////////
@@ -114,8 +158,13 @@ struct Skylighting : Feature
 		{
 			// When entering a new cell through a loadscreen, update every frame until completion
 			if (a_event->menuName == RE::LoadingMenu::MENU_NAME) {
-				if (!a_event->opening)
-					Skylighting::GetSingleton()->forceFrames = 255 * 4;
+				auto singleton = Skylighting::GetSingleton();
+				if (a_event->opening) {
+					singleton->SaveOcclusionCache();
+				} else {
+					singleton->forceFrames = 255 * 4;
+					singleton->pendingCacheRestore = true;
+				}
 			}
 
 			return RE::BSEventNotifyControl::kContinue;
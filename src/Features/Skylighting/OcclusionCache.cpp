@@ -0,0 +1,125 @@
+#include "OcclusionCache.h"
+
+namespace OcclusionCache
+{
+	// Rounds to nearest even like XMConvertFloatToHalf
+	uint16_t FloatToHalf(float a_value)
+	{
+		uint32_t bits = std::bit_cast<uint32_t>(a_value);
+		uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+		uint32_t magnitude = bits & 0x7FFFFFFF;
+
+		if (magnitude >= 0x7F800000)  // infinity and NaN
+			return sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0);
+		if (magnitude >= 0x477FF000)  // rounds past 65504
+			return sign | 0x7C00;
+		if (magnitude < 0x33000000)  // rounds to zero
+			return sign;
+
+		if (magnitude < 0x38800000) {
+			// Denormal, counted in units of 2^-24
+			uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+			uint32_t shift = 126 - (magnitude >> 23);
+			uint32_t half = mantissa >> shift;
+			uint32_t remainder = mantissa & ((1u << shift) - 1);
+			uint32_t halfway = 1u << (shift - 1);
+			if (remainder > halfway || (remainder == halfway && (half & 1)))
+				half++;
+			return sign | (uint16_t)half;
+		}
+
+		magnitude -= 112u << 23;
+		return sign | (uint16_t)((magnitude + 0xFFF + ((magnitude >> 13) & 1)) >> 13);
+	}
+
+	float HalfToFloat(uint16_t a_value)
+	{
+		uint32_t sign = (uint32_t)(a_value & 0x8000) << 16;
+		uint32_t exponent = (a_value >> 10) & 0x1F;
+		uint32_t mantissa = a_value & 0x3FF;
+
+		if (exponent == 0x1F)
+			return std::bit_cast<float>(sign | 0x7F800000 | (mantissa << 13));
+		if (exponent == 0) {
+			float denormal = std::ldexp((float)mantissa, -24);
+			return sign ? -denormal : denormal;
+		}
+		return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+	}
+
+	uint64_t GetUnitProbe()
+	{
+		return FloatToHalf(UnitProbeDC);
+	}
+
+	// Quantises a probe to 8 bits per coefficient: the DC term relative to the unit probe, and the linear terms
+	// relative to the DC term, which a non-negative visibility keeps within +-sqrt(3)
+	uint32_t EncodeProbe(uint64_t a_probe)
+	{
+		float sh[4];
+		for (uint i = 0; i < 4; i++)
+			sh[i] = HalfToFloat((uint16_t)(a_probe >> (16 * i)));
+
+		uint32_t encoded = (uint32_t)std::lround(std::clamp(sh[0] / UnitProbeDC, 0.f, 1.f) * 255.f);
+		for (uint i = 1; i < 4; i++) {
+			float linear = sh[0] > 1e-4f ? std::clamp(sh[i] / (sh[0] * std::numbers::sqrt3_v<float>), -1.f, 1.f) : 0.f;
+			encoded |= (uint32_t)(std::lround(linear * 127.f) + 128) << (8 * i);
+		}
+		return encoded;
+	}
+
+	uint64_t DecodeProbe(uint32_t a_encoded)
+	{
+		float sh[4];
+		sh[0] = (a_encoded & 0xFF) / 255.f * UnitProbeDC;
+		for (uint i = 1; i < 4; i++)
+			sh[i] = ((int)((a_encoded >> (8 * i)) & 0xFF) - 128) / 127.f * sh[0] * std::numbers::sqrt3_v<float>;
+
+		uint64_t probe = 0;
+		for (uint i = 0; i < 4; i++)
+			probe |= (uint64_t)FloatToHalf(sh[i]) << (16 * i);
+		return probe;
+	}
+
+	void Encode(std::span<const uint8_t> a_accumFrames, std::span<const uint64_t> a_probes, std::vector<Run>& o_runs, std::vector<uint32_t>& o_storedProbes)
+	{
+		// Converged volumes have counts everywhere, so open sky is folded into the runs as well and only other probes are stored
+		static const uint32_t unitProbeEncoded = EncodeProbe(GetUnitProbe());
+
+		o_runs.clear();
+		o_storedProbes.clear();
+		for (size_t i = 0; i < a_accumFrames.size(); i++) {
+			uint32_t encoded = a_accumFrames[i] ? EncodeProbe(a_probes[i]) : unitProbeEncoded;
+			uint16_t stored = encoded != unitProbeEncoded;
+			if (o_runs.empty() || o_runs.back().accumFrames != a_accumFrames[i] || o_runs.back().stored != stored)
+				o_runs.push_back({ 0, a_accumFrames[i], stored });
+			o_runs.back().length++;
+			if (stored)
+				o_storedProbes.push_back(encoded);
+		}
+	}
+
+	bool Decode(std::span<const Run> a_runs, std::span<const uint32_t> a_storedProbes, size_t a_probeTotal, std::vector<uint8_t>& o_accumFrames, std::vector<uint64_t>& o_probes)
+	{
+		const uint64_t unitProbe = GetUnitProbe();
+
+		o_accumFrames.clear();
+		o_probes.clear();
+		o_accumFrames.reserve(a_probeTotal);
+		o_probes.reserve(a_probeTotal);
+		size_t storedIndex = 0;
+		for (const auto& run : a_runs) {
+			if (o_accumFrames.size() + run.length > a_probeTotal || (run.stored && storedIndex + run.length > a_storedProbes.size()))
+				return false;
+			o_accumFrames.insert(o_accumFrames.end(), run.length, (uint8_t)run.accumFrames);
+			if (run.stored) {
+				for (uint32_t i = 0; i < run.length; i++)
+					o_probes.push_back(DecodeProbe(a_storedProbes[storedIndex + i]));
+				storedIndex += run.length;
+			} else {
+				o_probes.insert(o_probes.end(), run.length, unitProbe);
+			}
+		}
+		return o_accumFrames.size() == a_probeTotal && storedIndex == a_storedProbes.size();
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <numbers>
+
+/**
+ * Encoding of the skylighting occlusion cache, kept apart from the feature so it builds without D3D.
+ * Probes are the RGBA16F texels of the probe array, quantised to 8 bits per coefficient when stored,
+ * and the volume is written as runs of equal accumulation counts in which either every probe is stored
+ * or every probe is the unit probe.
+ */
+namespace OcclusionCache
+{
+	struct Run
+	{
+		uint32_t length;
+		uint16_t accumFrames;
+		uint16_t stored;
+	};
+
+	// The unit probe written by UpdateProbesCS is (sqrt(4 pi), 0, 0, 0), an unoccluded sky
+	inline const float UnitProbeDC = std::sqrt(4.f * std::numbers::pi_v<float>);
+
+	uint16_t FloatToHalf(float a_value);
+	float HalfToFloat(uint16_t a_value);
+
+	uint64_t GetUnitProbe();
+	uint32_t EncodeProbe(uint64_t a_probe);
+	uint64_t DecodeProbe(uint32_t a_encoded);
+
+	/**
+	 * Splits a volume into runs, storing only the accumulated probes that do not quantise to the unit probe.
+	 */
+	void Encode(std::span<const uint8_t> a_accumFrames, std::span<const uint64_t> a_probes, std::vector<Run>& o_runs, std::vector<uint32_t>& o_storedProbes);
+
+	/**
+	 * Expands the runs back into a volume of a_probeTotal probes, false when they do not add up to it.
+	 */
+	bool Decode(std::span<const Run> a_runs, std::span<const uint32_t> a_storedProbes, size_t a_probeTotal, std::vector<uint8_t>& o_accumFrames, std::vector<uint64_t>& o_probes);
+}
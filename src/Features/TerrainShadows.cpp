@@ -2,6 +2,8 @@
 #include "Menu.h"
 
 #include "Deferred.h"
+#include "FrameBudget.h"
+#include "Profiler.h"
 #include "State.h"
 #include "Util.h"
 
@@ -42,13 +44,14 @@ void TerrainShadows::DrawSettings()
 
 		ImGui::Separator();
 
-		ImGui::BulletText("shadowUpdateCBData");
+		ImGui::BulletText("windowSweep.cbData");
 		ImGui::Indent();
 		{
-			ImGui::Text(fmt::format("LightPxDir: ({}, {})", shadowUpdateCBData.LightPxDir.x, shadowUpdateCBData.LightPxDir.y).c_str());
-			ImGui::Text(fmt::format("LightDeltaZ: ({}, {})", shadowUpdateCBData.LightDeltaZ.x, shadowUpdateCBData.LightDeltaZ.y).c_str());
-			ImGui::Text(fmt::format("StartPxCoord: {}", shadowUpdateCBData.StartPxCoord).c_str());
-			ImGui::Text(fmt::format("PxSize: ({}, {})", shadowUpdateCBData.PxSize.x, shadowUpdateCBData.PxSize.y).c_str());
+			ImGui::Text(fmt::format("LightPxDir: ({}, {})", windowSweep.cbData.LightPxDir.x, windowSweep.cbData.LightPxDir.y).c_str());
+			ImGui::Text(fmt::format("LightDeltaZ: ({}, {})", windowSweep.cbData.LightDeltaZ.x, windowSweep.cbData.LightDeltaZ.y).c_str());
+			ImGui::Text(fmt::format("StartPxCoord: {}", windowSweep.cbData.StartPxCoord).c_str());
+			ImGui::Text(fmt::format("PxSize: ({}, {})", windowSweep.cbData.PxSize.x, windowSweep.cbData.PxSize.y).c_str());
+			ImGui::Text(fmt::format("Completed sweeps: {}{}", completedSweeps, completedSweeps >= ConvergeSweeps ? " (idle)" : "").c_str());
 		}
 		ImGui::Unindent();
 
@@ -133,22 +136,23 @@ void TerrainShadows::SetupResources()
 {
 	logger::debug("Listing xLODGen height maps...");
 	{
+		auto manifest = Util::AssetManifest::GetSingleton();
 		std::filesystem::path texture_dir{ L"Data\\textures\\Terrain\\" };
-		for (auto const& dir_entry : std::filesystem::directory_iterator{ texture_dir }) {
-			auto dir_path = dir_entry.path();
-			if (!std::filesystem::is_directory(dir_path))
+		for (auto const& dir_entry : manifest->List(texture_dir)) {
+			if (!dir_entry.isDirectory)
 				continue;
 
-			for (auto const& sub_dir_entry : std::filesystem::directory_iterator{ dir_path })
-				ParseHeightmapPath(sub_dir_entry.path(), true);
+			auto dir_path = texture_dir / dir_entry.name;
+			for (auto const& sub_dir_entry : manifest->List(dir_path))
+				ParseHeightmapPath(dir_path / sub_dir_entry.name, true);
 		}
 	}
 
 	logger::debug("Listing height maps...");
 	{
 		std::filesystem::path texture_dir{ L"Data\\textures\\heightmaps\\" };
-		for (auto const& dir_entry : std::filesystem::directory_iterator{ texture_dir })
-			ParseHeightmapPath(dir_entry.path(), false);
+		for (auto const& dir_entry : Util::AssetManifest::GetSingleton()->List(texture_dir))
+			ParseHeightmapPath(texture_dir / dir_entry.name, false);
 	}
 
 	logger::debug("Creating constant buffers...");
@@ -186,17 +190,279 @@ TerrainShadows::PerFrame TerrainShadows::GetCommonBufferData()
 	};
 
 	if (isHeightmapReady) {
-		auto invScale = cachedHeightmap->pos1 - cachedHeightmap->pos0;
+		auto invScale = heightmapWindow.pos1 - heightmapWindow.pos0;
 		data.Scale = float3(1.f, 1.f, 1.f) / invScale;
-		data.Offset = -cachedHeightmap->pos0 * float2{ data.Scale.x, data.Scale.y };
+		data.Offset = -heightmapWindow.pos0 * float2{ data.Scale.x, data.Scale.y };
 		data.ZRange = cachedHeightmap->zRange;
+
+		if (texOverviewShadowHeight) {
+			data.OverviewScale = float2{ 1.f, 1.f } / float2{ cachedHeightmap->pos1.x - cachedHeightmap->pos0.x, cachedHeightmap->pos1.y - cachedHeightmap->pos0.y };
+			data.OverviewOffset = -float2{ cachedHeightmap->pos0.x, cachedHeightmap->pos0.y } * data.OverviewScale;
+		} else {
+			// every position falls outside the missing overview
+			data.OverviewScale = { 0.f, 0.f };
+			data.OverviewOffset = { -1.f, -1.f };
+		}
 	}
 
 	return data;
 }
 
+TerrainShadows::HeightmapWindow TerrainShadows::CreateHeightmapTexture(std::filesystem::path a_path, HeightMapMetadata a_metadata, float2 a_centre)
+{
+	Profiler::StutterScope stutter(Profiler::StutterCause::HeightmapLoad);
+
+	if (auto source = GetHeightmapSource(a_path); source && (source->width > MaxResidentSize || source->height > MaxResidentSize)) {
+		auto sharedSource = std::make_shared<const HeightmapSource>(std::move(*source));
+		auto window = CreateHeightmapWindow(sharedSource, std::move(a_metadata), a_centre);
+		if (window.texture)
+			window.overview = CreateHeightmapOverview(*sharedSource);
+		return window;
+	}
+
+	DirectX::ScratchImage image;
+	try {
+		DX::ThrowIfFailed(LoadFromDDSFile(a_path.c_str(), DirectX::DDS_FLAGS_NONE, nullptr, image));
+	} catch (const DX::com_exception& e) {
+		logger::error("{}", e.what());
+		return {};
+	}
+
+	const auto& metadata = image.GetMetadata();
+	if (metadata.width > MaxResidentSize || metadata.height > MaxResidentSize)
+		logger::warn("Height map {} is larger than {} but not stored uncompressed, loading it whole", a_metadata.filename, MaxResidentSize);
+
+	HeightmapWindow window;
+	window.pos0 = a_metadata.pos0;
+	window.pos1 = a_metadata.pos1;
+	window.texture = CreateHeightmapResource(image);
+	return window;
+}
+
+std::optional<TerrainShadows::HeightmapSource> TerrainShadows::GetHeightmapSource(const std::filesystem::path& a_path)
+{
+	DirectX::TexMetadata metadata;
+	if (FAILED(DirectX::GetMetadataFromDDSFile(a_path.c_str(), DirectX::DDS_FLAGS_NONE, metadata)))
+		return std::nullopt;
+	size_t bitsPerPixel = DirectX::BitsPerPixel(metadata.format);
+	if (metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D || DirectX::IsCompressed(metadata.format) || DirectX::IsPacked(metadata.format) ||
+		DirectX::IsPlanar(metadata.format) || bitsPerPixel == 0 || bitsPerPixel % 8 != 0)
+		return std::nullopt;
+
+	// magic and DDS_HEADER, followed by DDS_HEADER_DXT10 when the pixel format's four CC is DX10
+	std::array<uint32_t, 32> header;
+	std::ifstream file(a_path, std::ios::binary);
+	if (!file.read(reinterpret_cast<char*>(header.data()), sizeof(header)))
+		return std::nullopt;
+
+	constexpr uint32_t DDPF_FOURCC = 0x4;
+	constexpr uint32_t FourCCDX10 = 'D' | ('X' << 8) | ('1' << 16) | ('0' << 24);
+	uint32_t pixelFormatFlags = header[20];
+	uint32_t fourCC = header[21];
+	uint32_t rgbBitCount = header[22];
+
+	HeightmapSource source{
+		.path = a_path,
+		.format = metadata.format,
+		.width = metadata.width,
+		.height = metadata.height,
+		.dataOffset = sizeof(header),
+		.rowPitch = metadata.width * bitsPerPixel / 8,
+		.bytesPerPixel = bitsPerPixel / 8
+	};
+	if (pixelFormatFlags & DDPF_FOURCC) {
+		if (fourCC == FourCCDX10)
+			source.dataOffset += 20;
+	} else if (rgbBitCount != bitsPerPixel) {
+		return std::nullopt;  // expanded while loading, e.g. 24 bit RGB
+	}
+
+	std::error_code ec;
+	if (std::filesystem::file_size(a_path, ec) < source.dataOffset + source.rowPitch * source.height || ec)
+		return std::nullopt;
+	return source;
+}
+
+bool TerrainShadows::ReadHeightmapRows(std::ifstream& a_file, const HeightmapSource& a_source, size_t a_x, size_t a_y, const DirectX::Image& o_image)
+{
+	for (size_t row = 0; row < o_image.height; row++) {
+		a_file.seekg((std::streamoff)(a_source.dataOffset + (a_y + row) * a_source.rowPitch + a_x * a_source.bytesPerPixel));
+		if (!a_file.read(reinterpret_cast<char*>(o_image.pixels + row * o_image.rowPitch), (std::streamsize)(o_image.width * a_source.bytesPerPixel)))
+			return false;
+	}
+	return true;
+}
+
+std::array<int, 2> TerrainShadows::GetWindowOrigin(size_t a_width, size_t a_height, const HeightMapMetadata& a_metadata, float2 a_centre)
+{
+	int width = (int)a_width;
+	int height = (int)a_height;
+	int windowWidth = std::min(width, (int)MaxResidentSize);
+	int windowHeight = std::min(height, (int)MaxResidentSize);
+
+	float2 uv = (a_centre - float2{ a_metadata.pos0.x, a_metadata.pos0.y }) / float2{ a_metadata.pos1.x - a_metadata.pos0.x, a_metadata.pos1.y - a_metadata.pos0.y };
+	return {
+		std::clamp((int)(uv.x * width) - windowWidth / 2, 0, width - windowWidth),
+		std::clamp((int)(uv.y * height) - windowHeight / 2, 0, height - windowHeight)
+	};
+}
+
+TerrainShadows::HeightmapWindow TerrainShadows::CreateHeightmapWindow(std::shared_ptr<const HeightmapSource> a_source, HeightMapMetadata a_metadata, float2 a_centre)
+{
+	size_t windowWidth = std::min(a_source->width, (size_t)MaxResidentSize);
+	size_t windowHeight = std::min(a_source->height, (size_t)MaxResidentSize);
+
+	HeightmapWindow window;
+	window.origin = GetWindowOrigin(a_source->width, a_source->height, a_metadata, a_centre);
+
+	DirectX::ScratchImage image;
+	std::ifstream file(a_source->path, std::ios::binary);
+	if (FAILED(image.Initialize2D(a_source->format, windowWidth, windowHeight, 1, 1)) ||
+		!ReadHeightmapRows(file, *a_source, (size_t)window.origin[0], (size_t)window.origin[1], *image.GetImage(0, 0, 0))) {
+		logger::error("Failed to read height map window from {}", a_metadata.filename);
+		return {};
+	}
+
+	window.texture = CreateHeightmapResource(image);
+	if (!window.texture)
+		return {};
+
+	float3 extent = a_metadata.pos1 - a_metadata.pos0;
+	window.pos0 = a_metadata.pos0;
+	window.pos1 = a_metadata.pos1;
+	window.pos0.x = a_metadata.pos0.x + extent.x * window.origin[0] / a_source->width;
+	window.pos0.y = a_metadata.pos0.y + extent.y * window.origin[1] / a_source->height;
+	window.pos1.x = a_metadata.pos0.x + extent.x * (window.origin[0] + windowWidth) / a_source->width;
+	window.pos1.y = a_metadata.pos0.y + extent.y * (window.origin[1] + windowHeight) / a_source->height;
+	window.source = std::move(a_source);
+	return window;
+}
+
+std::unique_ptr<Texture2D> TerrainShadows::CreateHeightmapOverview(const HeightmapSource& a_source)
+{
+	size_t stride = (std::max(a_source.width, a_source.height) + OverviewSize - 1) / OverviewSize;
+	size_t width = (a_source.width + stride - 1) / stride;
+	size_t height = (a_source.height + stride - 1) / stride;
+
+	// stride rows at a time are read and filtered down to one overview row, only that strip is in memory
+	DirectX::ScratchImage overview, strip, row;
+	std::ifstream file(a_source.path, std::ios::binary);
+	try {
+		DX::ThrowIfFailed(overview.Initialize2D(a_source.format, width, height, 1, 1));
+		const auto& overviewImage = *overview.GetImage(0, 0, 0);
+		for (size_t y = 0; y < height; y++) {
+			size_t rows = std::min(stride, a_source.height - y * stride);
+			DX::ThrowIfFailed(strip.Initialize2D(a_source.format, a_source.width, rows, 1, 1));
+			if (!ReadHeightmapRows(file, a_source, 0, y * stride, *strip.GetImage(0, 0, 0))) {
+				logger::error("Failed to read height map overview from {}", a_source.path.string());
+				return nullptr;
+			}
+			DX::ThrowIfFailed(DirectX::Resize(*strip.GetImage(0, 0, 0), width, 1, DirectX::TEX_FILTER_TRIANGLE, row));
+			std::memcpy(overviewImage.pixels + y * overviewImage.rowPitch, row.GetImage(0, 0, 0)->pixels, overviewImage.rowPitch);
+		}
+	} catch (const DX::com_exception& e) {
+		logger::error("{}", e.what());
+		return nullptr;
+	}
+
+	return CreateHeightmapResource(overview);
+}
+
+std::unique_ptr<Texture2D> TerrainShadows::CreateHeightmapResource(const DirectX::ScratchImage& a_image)
+{
+	auto& device = State::GetSingleton()->device;
+
+	ID3D11Resource* pResource = nullptr;
+	try {
+		DX::ThrowIfFailed(CreateTexture(device, a_image.GetImages(), a_image.GetImageCount(), a_image.GetMetadata(), &pResource));
+	} catch (const DX::com_exception& e) {
+		logger::error("{}", e.what());
+		return nullptr;
+	}
+
+	auto texture = std::make_unique<Texture2D>(reinterpret_cast<ID3D11Texture2D*>(pResource));
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {
+		.Format = texture->desc.Format,
+		.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D,
+		.Texture2D = {
+			.MostDetailedMip = 0,
+			.MipLevels = 1 }
+	};
+	try {
+		texture->CreateSRV(srvDesc);
+	} catch (const DX::com_exception& e) {
+		logger::error("{}", e.what());
+		return nullptr;
+	}
+
+	return texture;
+}
+
+void TerrainShadows::SwapHeightmap(HeightmapWindow&& a_window)
+{
+	auto& worldspace = pendingHeightmap.worldspace;
+	bool recentre = cachedHeightmap && cachedHeightmap->worldspace == worldspace && texShadowHeight &&
+	                texHeightMap->desc.Width == a_window.texture->desc.Width && texHeightMap->desc.Height == a_window.texture->desc.Height;
+	int dx = a_window.origin[0] - heightmapWindow.origin[0];
+	int dy = a_window.origin[1] - heightmapWindow.origin[1];
+
+	texHeightMap = std::move(a_window.texture);
+	if (!recentre) {
+		texOverviewHeightMap = std::move(a_window.overview);
+		texOverviewShadowHeight = texOverviewHeightMap ? CreateShadowHeightTexture(texOverviewHeightMap->desc.Width, texOverviewHeightMap->desc.Height) : nullptr;
+		overviewSweep = {};
+	}
+	heightmapWindow = std::move(a_window);
+	cachedHeightmap = &heightmaps[worldspace];
+	windowSweep.updateIdx = 0;
+
+	if (!recentre) {
+		completedSweeps = 0;
+		fastConverge = true;
+		needPrecompute = true;
+		return;
+	}
+
+	// the overlap is copied over, an incremental sweep at the normal rate fills in the newly exposed edge
+	completedSweeps = std::min(completedSweeps, ConvergeSweeps - 1);
+
+	// keep the shadows of the overlapping part so moving the window doesn't flash
+	auto oldShadowHeight = std::move(texShadowHeight);
+	Precompute();
+
+	int width = (int)texHeightMap->desc.Width;
+	int height = (int)texHeightMap->desc.Height;
+	if (std::abs(dx) < width && std::abs(dy) < height) {
+		D3D11_BOX box = {
+			.left = (uint)std::max(dx, 0),
+			.top = (uint)std::max(dy, 0),
+			.front = 0,
+			.right = (uint)(width - std::max(-dx, 0)),
+			.bottom = (uint)(height - std::max(-dy, 0)),
+			.back = 1
+		};
+		State::GetSingleton()->context->CopySubresourceRegion(texShadowHeight->resource.get(), 0, std::max(-dx, 0), std::max(-dy, 0), 0, oldShadowHeight->resource.get(), 0, &box);
+	}
+}
+
 void TerrainShadows::LoadHeightmap()
 {
+	// swap in a finished load, restarting the sweep on the new heightmap
+	if (pendingHeightmap.window.valid()) {
+		if (pendingHeightmap.window.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return;
+
+		auto window = pendingHeightmap.window.get();
+		if (window.texture) {
+			logger::debug("Height map for {} ready", pendingHeightmap.worldspace);
+			SwapHeightmap(std::move(window));
+		} else {
+			failedHeightmaps.insert(pendingHeightmap.worldspace);
+		}
+		pendingHeightmap.worldspace.clear();
+	}
+
 	auto tes = RE::TES::GetSingleton();
 	if (!tes)
 		return;
@@ -206,53 +472,65 @@ void TerrainShadows::LoadHeightmap()
 	std::string worldspace_name = worldspace->GetFormEditorID();
 	if (!heightmaps.contains(worldspace_name))  // no height map for that, but we don't remove cache
 		return;
-	if (cachedHeightmap && cachedHeightmap->worldspace == worldspace_name)  // already cached
-		return;
 
-	auto& device = State::GetSingleton()->device;
+	auto eyePosition = Util::GetEyePosition(0);
+	float2 centre = { eyePosition.x, eyePosition.y };
+
+	if (cachedHeightmap && cachedHeightmap->worldspace == worldspace_name) {  // already cached
+		// move the window once the camera is a quarter of it away from the centre
+		if (auto source = heightmapWindow.source) {
+			auto origin = GetWindowOrigin(source->width, source->height, *cachedHeightmap, centre);
+			if (std::abs(origin[0] - heightmapWindow.origin[0]) > (int)MaxResidentSize / 4 || std::abs(origin[1] - heightmapWindow.origin[1]) > (int)MaxResidentSize / 4) {
+				pendingHeightmap.worldspace = worldspace_name;
+				pendingHeightmap.window = std::async(std::launch::async, CreateHeightmapWindow, std::move(source), *cachedHeightmap, centre);
+			}
+		}
+		return;
+	}
+	if (failedHeightmaps.contains(worldspace_name))  // don't retry every frame
+		return;
 
 	logger::debug("Loading height map...");
 	{
 		auto& target_heightmap = heightmaps[worldspace_name];
 
-		DirectX::ScratchImage image;
-		try {
-			std::filesystem::path path{ target_heightmap.dir };
-			path /= target_heightmap.filename;
+		std::filesystem::path path{ target_heightmap.dir };
+		path /= target_heightmap.filename;
 
-			DX::ThrowIfFailed(LoadFromDDSFile(path.c_str(), DirectX::DDS_FLAGS_NONE, nullptr, image));
-		} catch (const DX::com_exception& e) {
-			logger::error("{}", e.what());
-			return;
-		}
-
-		ID3D11Resource* pResource = nullptr;
-		try {
-			DX::ThrowIfFailed(CreateTexture(device,
-				image.GetImages(), image.GetImageCount(),
-				image.GetMetadata(), &pResource));
-		} catch (const DX::com_exception& e) {
-			logger::error("{}", e.what());
-			return;
-		}
-
-		texHeightMap.release();
-		texHeightMap = std::make_unique<Texture2D>(reinterpret_cast<ID3D11Texture2D*>(pResource));
-
-		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {
-			.Format = texHeightMap->desc.Format,
-			.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D,
-			.Texture2D = {
-				.MostDetailedMip = 0,
-				.MipLevels = 1 }
-		};
-		texHeightMap->CreateSRV(srvDesc);
-
-		cachedHeightmap = &heightmaps[worldspace_name];
+		pendingHeightmap.worldspace = worldspace_name;
+		pendingHeightmap.window = std::async(std::launch::async, CreateHeightmapTexture, std::move(path), target_heightmap, centre);
 	}
+}
+
+std::unique_ptr<Texture2D> TerrainShadows::CreateShadowHeightTexture(uint a_width, uint a_height)
+{
+	D3D11_TEXTURE2D_DESC texDesc = {
+		.Width = a_width,
+		.Height = a_height,
+		.MipLevels = 1,
+		.ArraySize = 1,
+		.Format = DXGI_FORMAT_R16G16_FLOAT,
+		.SampleDesc = { .Count = 1 },
+		.Usage = D3D11_USAGE_DEFAULT,
+		.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS
+	};
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {
+		.Format = texDesc.Format,
+		.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D,
+		.Texture2D = {
+			.MostDetailedMip = 0,
+			.MipLevels = 1 }
+	};
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {
+		.Format = texDesc.Format,
+		.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D,
+		.Texture2D = { .MipSlice = 0 }
+	};
 
-	shadowUpdateIdx = 0;
-	needPrecompute = true;
+	auto texture = std::make_unique<Texture2D>(texDesc);
+	texture->CreateSRV(srvDesc);
+	texture->CreateUAV(uavDesc);
+	return texture;
 }
 
 void TerrainShadows::Precompute()
@@ -262,113 +540,94 @@ void TerrainShadows::Precompute()
 
 	logger::info("Creating shadow texture...");
 	{
-		texShadowHeight.release();
-
-		D3D11_TEXTURE2D_DESC texDesc = {
-			.Width = texHeightMap->desc.Width,
-			.Height = texHeightMap->desc.Height,
-			.MipLevels = 1,
-			.ArraySize = 1,
-			.Format = DXGI_FORMAT_R16G16_FLOAT,
-			.SampleDesc = { .Count = 1 },
-			.Usage = D3D11_USAGE_DEFAULT,
-			.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS
-		};
-		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {
-			.Format = texDesc.Format,
-			.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D,
-			.Texture2D = {
-				.MostDetailedMip = 0,
-				.MipLevels = 1 }
-		};
-		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {
-			.Format = texDesc.Format,
-			.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D,
-			.Texture2D = { .MipSlice = 0 }
-		};
-
-		texShadowHeight = std::make_unique<Texture2D>(texDesc);
-		texShadowHeight->CreateSRV(srvDesc);
-		texShadowHeight->CreateUAV(uavDesc);
+		texShadowHeight.reset();
+		texShadowHeight = CreateShadowHeightTexture(texHeightMap->desc.Width, texHeightMap->desc.Height);
 	}
 
 	needPrecompute = false;
 }
 
-void TerrainShadows::UpdateShadow()
+std::optional<float3> TerrainShadows::GetSunDirection()
 {
-	if (!IsHeightMapReady())
-		return;
-
-	// don't forget to change NTHREADS in shader!
-	constexpr uint updateLength = 128u;
-	constexpr uint logUpdateLength = std::bit_width(128u) - 1;  // integer log2, https://stackoverflow.com/questions/994593/how-to-do-an-integer-log2-in-c
-
-	auto& context = State::GetSingleton()->context;
 	auto accumulator = RE::BSGraphics::BSShaderAccumulator::GetCurrentAccumulator();
 	auto sunLight = skyrim_cast<RE::NiDirectionalLight*>(accumulator->GetRuntimeData().activeShadowSceneNode->GetRuntimeData().sunLight->light.get());
 	if (!sunLight)
-		return;
-
-	ZoneScoped;
-	TracyD3D11Zone(State::GetSingleton()->tracyCtx, "Terrain Occlusion - Update Shadows");
+		return std::nullopt;
+
+	auto direction = sunLight->GetWorldDirection();
+	float3 dirLightDir = { direction.x, direction.y, direction.z };
+	if (dirLightDir.z > 0)
+		dirLightDir = -dirLightDir;
+	dirLightDir.Normalize();
+	return dirLightDir;
+}
 
-	/* ---- UPDATE CB ---- */
-	uint width = texHeightMap->desc.Width;
-	uint height = texHeightMap->desc.Height;
+bool TerrainShadows::NeedsShadowUpdate()
+{
+	if (!IsHeightMapReady())
+		return false;
 
-	// only update direction at the start of each cycle
-	static uint edgePxCoord;
-	static int signDir;
-	static uint maxUpdates;
-	if (shadowUpdateIdx == 0) {
-		auto direction = sunLight->GetWorldDirection();
-		float3 dirLightDir = { direction.x, direction.y, direction.z };
-		if (dirLightDir.z > 0)
-			dirLightDir = -dirLightDir;
-
-		// in UV
-		float3 invScale = cachedHeightmap->pos1 - cachedHeightmap->pos0;
-		invScale.z = cachedHeightmap->zRange.y - cachedHeightmap->zRange.x;
-		float3 dirLightPxDir = dirLightDir / invScale;
-		dirLightPxDir.x *= width;
-		dirLightPxDir.y *= height;
-
-		float stepMult;
-		if (abs(dirLightPxDir.x) >= abs(dirLightPxDir.y)) {
-			stepMult = 1.f / abs(dirLightPxDir.x);
-			edgePxCoord = dirLightPxDir.x > 0 ? 0 : (width - 1);
-			signDir = dirLightPxDir.x > 0 ? 1 : -1;
-			maxUpdates = (width + updateLength - 1) >> logUpdateLength;
-		} else {
-			stepMult = 1.f / abs(dirLightPxDir.y);
-			edgePxCoord = dirLightPxDir.y > 0 ? 0 : height - 1;
-			signDir = dirLightPxDir.y > 0 ? 1 : -1;
-			maxUpdates = (height + updateLength - 1) >> logUpdateLength;
-		}
-		dirLightPxDir *= stepMult;
+	auto dirLightDir = GetSunDirection();
+	if (!dirLightDir)
+		return false;
 
-		shadowUpdateCBData.LightPxDir = { dirLightPxDir.x, dirLightPxDir.y };
+	// mid sweep, not converged yet, or the sun moved since the last sweep
+	return windowSweep.updateIdx != 0 || completedSweeps < ConvergeSweeps || dirLightDir->Dot(sweepLightDir) <= std::cos(SweepAngleThreshold);
+}
 
-		// soft shadow angles
-		float lenUV = float2{ dirLightDir.x, dirLightDir.y }.Length();
-		float dirLightAngle = atan2(-dirLightDir.z, lenUV);
-		float shadowSofteningRadiusAngle = 4.f * RE::NI_PI / 180.f;
-		float upperAngle = std::max(0.f, dirLightAngle - shadowSofteningRadiusAngle);
-		float lowerAngle = std::min(RE::NI_HALF_PI - 1e-2f, dirLightAngle + shadowSofteningRadiusAngle);
+// don't forget to change NTHREADS in shader!
+static constexpr uint updateLength = 128u;
+static constexpr uint logUpdateLength = std::bit_width(128u) - 1;  // integer log2, https://stackoverflow.com/questions/994593/how-to-do-an-integer-log2-in-c
 
-		shadowUpdateCBData.LightDeltaZ = -(lenUV / invScale.z * stepMult) * float2{ std::tan(upperAngle), std::tan(lowerAngle) };
+void TerrainShadows::BeginSweep(ShadowSweep& a_sweep, const float3& a_dirLightDir, const float3& a_pos0, const float3& a_pos1, uint a_width, uint a_height)
+{
+	// in UV
+	float3 invScale = a_pos1 - a_pos0;
+	invScale.z = cachedHeightmap->zRange.y - cachedHeightmap->zRange.x;
+	float3 dirLightPxDir = a_dirLightDir / invScale;
+	dirLightPxDir.x *= a_width;
+	dirLightPxDir.y *= a_height;
+
+	float stepMult;
+	if (abs(dirLightPxDir.x) >= abs(dirLightPxDir.y)) {
+		stepMult = 1.f / abs(dirLightPxDir.x);
+		a_sweep.edgePxCoord = dirLightPxDir.x > 0 ? 0 : (a_width - 1);
+		a_sweep.signDir = dirLightPxDir.x > 0 ? 1 : -1;
+		a_sweep.maxUpdates = (a_width + updateLength - 1) >> logUpdateLength;
+	} else {
+		stepMult = 1.f / abs(dirLightPxDir.y);
+		a_sweep.edgePxCoord = dirLightPxDir.y > 0 ? 0 : a_height - 1;
+		a_sweep.signDir = dirLightPxDir.y > 0 ? 1 : -1;
+		a_sweep.maxUpdates = (a_height + updateLength - 1) >> logUpdateLength;
 	}
+	dirLightPxDir *= stepMult;
 
-	shadowUpdateCBData.StartPxCoord = edgePxCoord + signDir * shadowUpdateIdx * updateLength;
-	shadowUpdateCBData.PxSize = { 1.f / texHeightMap->desc.Width, 1.f / texHeightMap->desc.Height };
+	a_sweep.cbData.LightPxDir = { dirLightPxDir.x, dirLightPxDir.y };
 
-	shadowUpdateCBData.PosRange = { cachedHeightmap->pos0.z, cachedHeightmap->pos1.z };
-	shadowUpdateCBData.ZRange = cachedHeightmap->zRange;
+	// soft shadow angles
+	float lenUV = float2{ a_dirLightDir.x, a_dirLightDir.y }.Length();
+	float dirLightAngle = atan2(-a_dirLightDir.z, lenUV);
+	float shadowSofteningRadiusAngle = 4.f * RE::NI_PI / 180.f;
+	float upperAngle = std::max(0.f, dirLightAngle - shadowSofteningRadiusAngle);
+	float lowerAngle = std::min(RE::NI_HALF_PI - 1e-2f, dirLightAngle + shadowSofteningRadiusAngle);
 
-	shadowUpdateCB->Update(shadowUpdateCBData);
+	a_sweep.cbData.LightDeltaZ = -(lenUV / invScale.z * stepMult) * float2{ std::tan(upperAngle), std::tan(lowerAngle) };
+}
 
-	shadowUpdateIdx = (shadowUpdateIdx + 1) % maxUpdates;
+void TerrainShadows::DispatchSweepSlice(ShadowSweep& a_sweep, Texture2D* a_heightMap, Texture2D* a_shadowHeight, const float3& a_pos0, const float3& a_pos1)
+{
+	auto& context = State::GetSingleton()->context;
+
+	/* ---- UPDATE CB ---- */
+	a_sweep.cbData.StartPxCoord = a_sweep.edgePxCoord + a_sweep.signDir * a_sweep.updateIdx * updateLength;
+	a_sweep.cbData.PxSize = { 1.f / a_heightMap->desc.Width, 1.f / a_heightMap->desc.Height };
+
+	a_sweep.cbData.PosRange = { a_pos0.z, a_pos1.z };
+	a_sweep.cbData.ZRange = cachedHeightmap->zRange;
+
+	shadowUpdateCB->Update(a_sweep.cbData);
+
+	a_sweep.updateIdx = (a_sweep.updateIdx + 1) % a_sweep.maxUpdates;
 
 	/* ---- BACKUP ---- */
 	struct ShaderState
@@ -380,15 +639,15 @@ void TerrainShadows::UpdateShadow()
 	} old, newer;
 
 	/* ---- DISPATCH ---- */
-	newer.srvs[0] = texHeightMap->srv.get();
-	newer.uavs[0] = texShadowHeight->uav.get();
+	newer.srvs[0] = a_heightMap->srv.get();
+	newer.uavs[0] = a_shadowHeight->uav.get();
 	newer.buffer = shadowUpdateCB->CB();
 
 	context->CSSetShaderResources(0, ARRAYSIZE(newer.srvs), newer.srvs);
 	context->CSSetUnorderedAccessViews(0, ARRAYSIZE(newer.uavs), newer.uavs, nullptr);
 	context->CSSetConstantBuffers(0, 1, &newer.buffer);
 	context->CSSetShader(shadowUpdateProgram.get(), nullptr, 0);
-	context->Dispatch(abs(shadowUpdateCBData.LightPxDir.x) >= abs(shadowUpdateCBData.LightPxDir.y) ? height : width, 1, 1);
+	context->Dispatch(abs(a_sweep.cbData.LightPxDir.x) >= abs(a_sweep.cbData.LightPxDir.y) ? a_heightMap->desc.Height : a_heightMap->desc.Width, 1, 1);
 
 	/* ---- RESTORE ---- */
 	context->CSSetShaderResources(0, ARRAYSIZE(old.srvs), old.srvs);
@@ -397,6 +656,46 @@ void TerrainShadows::UpdateShadow()
 	context->CSSetConstantBuffers(0, 1, &old.buffer);
 }
 
+bool TerrainShadows::UpdateShadow()
+{
+	if (!NeedsShadowUpdate())
+		return false;
+
+	ZoneScoped;
+	TracyD3D11Zone(State::GetSingleton()->tracyCtx, "Terrain Occlusion - Update Shadows");
+
+	// only update direction at the start of each cycle
+	if (windowSweep.updateIdx == 0) {
+		float3 dirLightDir = *GetSunDirection();
+
+		// converged but the sun moved, one more sweep to follow it
+		if (completedSweeps >= ConvergeSweeps)
+			completedSweeps = ConvergeSweeps - 1;
+		sweepLightDir = dirLightDir;
+
+		BeginSweep(windowSweep, dirLightDir, heightmapWindow.pos0, heightmapWindow.pos1, texHeightMap->desc.Width, texHeightMap->desc.Height);
+		overviewSweepPending = texOverviewHeightMap != nullptr;
+	}
+
+	DispatchSweepSlice(windowSweep, texHeightMap.get(), texShadowHeight.get(), heightmapWindow.pos0, heightmapWindow.pos1);
+	if (windowSweep.updateIdx == 0) {
+		completedSweeps++;
+		if (completedSweeps >= ConvergeSweeps)
+			fastConverge = false;
+	}
+
+	// the overview has fewer slices, one of them goes along with each slice of the window until it is swept
+	if (texOverviewHeightMap && (overviewSweepPending || overviewSweep.updateIdx != 0)) {
+		if (overviewSweep.updateIdx == 0) {
+			BeginSweep(overviewSweep, sweepLightDir, cachedHeightmap->pos0, cachedHeightmap->pos1, texOverviewHeightMap->desc.Width, texOverviewHeightMap->desc.Height);
+			overviewSweepPending = false;
+		}
+		DispatchSweepSlice(overviewSweep, texOverviewHeightMap.get(), texOverviewShadowHeight.get(), cachedHeightmap->pos0, cachedHeightmap->pos1);
+	}
+
+	return true;
+}
+
 void TerrainShadows::Prepass()
 {
 	LoadHeightmap();
@@ -407,12 +706,22 @@ void TerrainShadows::Prepass()
 	if (needPrecompute)
 		Precompute();
 
-	UpdateShadow();
+	static auto costScope = Profiler::GetSingleton()->RegisterScope("Terrain Shadows - Update Shadow");
+	static auto updateKnob = FrameBudget::GetSingleton()->RegisterKnob("Terrain Shadows Update Rate", 0, 0.25f, 0.25f, costScope);
+	static auto updateTask = FrameBudget::GetSingleton()->RegisterTask("Terrain Shadows - Update Shadow", 0, 8, costScope);
+	if (NeedsShadowUpdate() && FrameBudget::GetSingleton()->Tick(updateKnob) && FrameBudget::GetSingleton()->Request(updateTask)) {
+		PROFILE_GPU_SCOPE("Terrain Shadows - Update Shadow");
+		uint slices = fastConverge ? FastConvergeSlices : 1;
+		for (uint i = 0; i < slices; i++) {
+			if (!UpdateShadow())
+				break;
+		}
+	}
 
 	if (texShadowHeight) {
 		auto context = State::GetSingleton()->context;
 
-		std::array<ID3D11ShaderResourceView*, 1> srvs = { texShadowHeight->srv.get() };
+		std::array<ID3D11ShaderResourceView*, 2> srvs = { texShadowHeight->srv.get(), texOverviewShadowHeight ? texOverviewShadowHeight->srv.get() : nullptr };
 		context->PSSetShaderResources(60, (uint)srvs.size(), srvs.data());
 	}
 }
@@ -4,6 +4,13 @@
 #include "Feature.h"
 
 #include <filesystem>
+#include <future>
+
+namespace DirectX
+{
+	class ScratchImage;
+	struct Image;
+}
 
 struct TerrainShadows : public Feature
 {
@@ -24,7 +31,14 @@ struct TerrainShadows : public Feature
 	} settings;
 
 	bool needPrecompute = false;
-	uint shadowUpdateIdx = 0;
+
+	// Sweeps stop once converged and resume when the sun moves by more than SweepAngleThreshold
+	static constexpr uint ConvergeSweeps = 4;  // each sweep blends half way towards the new result
+	static constexpr float SweepAngleThreshold = 0.5f * RE::NI_PI / 180.f;
+	float3 sweepLightDir = {};
+	uint completedSweeps = 0;
+	static constexpr uint FastConvergeSlices = 4;
+	bool fastConverge = false;  // update FastConvergeSlices slices per tick after a new heightmap
 
 	struct HeightMapMetadata
 	{
@@ -37,6 +51,42 @@ struct TerrainShadows : public Feature
 	std::unordered_map<std::string, HeightMapMetadata> heightmaps;
 	HeightMapMetadata* cachedHeightmap;
 
+	// Uncompressed heightmaps larger than MaxResidentSize only keep a window around the camera on the GPU.
+	// Its rows are read from the DDS again when the camera moves away from its centre, nothing else stays in memory.
+	// Outside the window shadows come from an overview of the whole heightmap, downsampled to at most OverviewSize.
+	static constexpr uint MaxResidentSize = 4096;
+	static constexpr uint OverviewSize = 1024;
+
+	// Layout of mip 0 of an uncompressed DDS, its rows are read straight from the file
+	struct HeightmapSource
+	{
+		std::filesystem::path path;
+		DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+		size_t width = 0;
+		size_t height = 0;
+		size_t dataOffset = 0;
+		size_t rowPitch = 0;
+		size_t bytesPerPixel = 0;
+	};
+
+	struct HeightmapWindow
+	{
+		std::unique_ptr<Texture2D> texture;
+		std::unique_ptr<Texture2D> overview;            // only created with the first window of a heightmap
+		std::shared_ptr<const HeightmapSource> source;  // only kept when windowed
+		std::array<int, 2> origin = {};                 // in source pixels
+		float3 pos0, pos1;                              // window corners, same convention as HeightMapMetadata
+	};
+	HeightmapWindow heightmapWindow;
+
+	// Decoded and uploaded on a worker, the current heightmap stays in use until the new one is swapped in
+	struct PendingHeightmap
+	{
+		std::string worldspace;
+		std::future<HeightmapWindow> window;
+	} pendingHeightmap;
+	std::unordered_set<std::string> failedHeightmaps;
+
 	struct ShadowUpdateCB
 	{
 		float2 LightPxDir;   // direction on which light descends, from one pixel to next via dda
@@ -46,16 +96,31 @@ struct TerrainShadows : public Feature
 		uint pad0[1];
 		float2 PosRange;
 		float2 ZRange;
-	} shadowUpdateCBData;
+	};
 	static_assert(sizeof(ShadowUpdateCB) % 16 == 0);
 	std::unique_ptr<ConstantBuffer> shadowUpdateCB = nullptr;
 
+	// Progress of a sweep over one heightmap, the window and the overview are swept in the same light direction
+	struct ShadowSweep
+	{
+		uint updateIdx = 0;
+		uint edgePxCoord = 0;
+		int signDir = 1;
+		uint maxUpdates = 1;
+		ShadowUpdateCB cbData = {};
+	};
+	ShadowSweep windowSweep;
+	ShadowSweep overviewSweep;
+	bool overviewSweepPending = false;  // starts alongside the next window sweep
+
 	struct alignas(16) PerFrame
 	{
 		uint EnableTerrainShadow;
 		float3 Scale;
 		float2 ZRange;
 		float2 Offset;
+		float2 OverviewScale;
+		float2 OverviewOffset;
 	};
 
 	PerFrame GetCommonBufferData();
@@ -64,6 +129,8 @@ struct TerrainShadows : public Feature
 
 	std::unique_ptr<Texture2D> texHeightMap = nullptr;
 	std::unique_ptr<Texture2D> texShadowHeight = nullptr;
+	std::unique_ptr<Texture2D> texOverviewHeightMap = nullptr;
+	std::unique_ptr<Texture2D> texOverviewShadowHeight = nullptr;
 
 	bool IsHeightMapReady();
 
@@ -75,8 +142,23 @@ struct TerrainShadows : public Feature
 
 	virtual void Prepass() override;
 	void LoadHeightmap();
+	static HeightmapWindow CreateHeightmapTexture(std::filesystem::path a_path, HeightMapMetadata a_metadata, float2 a_centre);
+	static HeightmapWindow CreateHeightmapWindow(std::shared_ptr<const HeightmapSource> a_source, HeightMapMetadata a_metadata, float2 a_centre);
+	static std::unique_ptr<Texture2D> CreateHeightmapOverview(const HeightmapSource& a_source);
+	static std::unique_ptr<Texture2D> CreateHeightmapResource(const DirectX::ScratchImage& a_image);
+	static std::unique_ptr<Texture2D> CreateShadowHeightTexture(uint a_width, uint a_height);
+	// nullopt for compressed or legacy formats whose rows in the file don't match the decoded image
+	static std::optional<HeightmapSource> GetHeightmapSource(const std::filesystem::path& a_path);
+	static bool ReadHeightmapRows(std::ifstream& a_file, const HeightmapSource& a_source, size_t a_x, size_t a_y, const DirectX::Image& o_image);
+	static std::array<int, 2> GetWindowOrigin(size_t a_width, size_t a_height, const HeightMapMetadata& a_metadata, float2 a_centre);
+	void SwapHeightmap(HeightmapWindow&& a_window);
 	void Precompute();
-	void UpdateShadow();
+	std::optional<float3> GetSunDirection();
+	// the heightmap is loaded and the sweep is unfinished, not converged or behind the sun
+	bool NeedsShadowUpdate();
+	bool UpdateShadow();
+	void BeginSweep(ShadowSweep& a_sweep, const float3& a_dirLightDir, const float3& a_pos0, const float3& a_pos1, uint a_width, uint a_height);
+	void DispatchSweepSlice(ShadowSweep& a_sweep, Texture2D* a_heightMap, Texture2D* a_shadowHeight, const float3& a_pos0, const float3& a_pos1);
 
 	virtual void LoadSettings(json& o_json) override;
 	virtual void SaveSettings(json& o_json) override;
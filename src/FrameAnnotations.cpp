@@ -12,9 +12,11 @@ namespace FrameAnnotations
 		static void thunk(RE::BSShader* shader, RE::BSRenderPass* pass, uint32_t renderFlags)
 		{
 			if (State::GetSingleton()->extendedFrameAnnotations) {
-				const std::string passName = std::format("[{}:{:X}] <{}> {}", magic_enum::enum_name(ShaderType), pass->passEnum,
-					pass->accumulationHint, pass->geometry->name.c_str());
-				State::GetSingleton()->BeginPerfEvent(passName);
+				const auto key = State::GetPerfEventKey(State::PerfEvent::SetupGeometry, ShaderType, pass->passEnum, pass->accumulationHint, pass->geometry->name.data());
+				State::GetSingleton()->BeginPerfEvent(key, [&] {
+					return std::format("[{}:{:X}] <{}> {}", magic_enum::enum_name(ShaderType), pass->passEnum,
+						pass->accumulationHint, pass->geometry->name.c_str());
+				});
 			}
 
 			func(shader, pass, renderFlags);
@@ -43,7 +45,9 @@ namespace FrameAnnotations
 	{
 		static void thunk(void* imageSpaceShader, RE::BSTriShape* shape, RE::ImageSpaceEffectParam* param)
 		{
-			State::GetSingleton()->BeginPerfEvent(std::format("{} Draw", magic_enum::enum_name(EffectType)));
+			State::GetSingleton()->BeginPerfEvent(State::GetPerfEventKey(State::PerfEvent::ImagespaceRender, EffectType), [] {
+				return std::format("{} Draw", magic_enum::enum_name(EffectType));
+			});
 
 			func(imageSpaceShader, shape, param);
 
@@ -58,7 +62,9 @@ namespace FrameAnnotations
 	{
 		static void thunk(void* imageSpaceShader, uint32_t a1, uint32_t a2, uint32_t a3)
 		{
-			State::GetSingleton()->BeginPerfEvent(std::format("{} Dispatch", magic_enum::enum_name(EffectType)));
+			State::GetSingleton()->BeginPerfEvent(State::GetPerfEventKey(State::PerfEvent::ImagespaceDispatch, EffectType), [] {
+				return std::format("{} Dispatch", magic_enum::enum_name(EffectType));
+			});
 
 			func(imageSpaceShader, a1, a2, a3);
 
@@ -74,8 +80,10 @@ namespace FrameAnnotations
 		{
 			const bool extendedFrameAnnotations = State::GetSingleton()->extendedFrameAnnotations;
 			if (extendedFrameAnnotations) {
-				State::GetSingleton()->BeginPerfEvent(std::format("BSShaderAccumulator::FinishAccumulatingDispatch [{}] <{}>",
-					static_cast<uint32_t>(shaderAccumulator->GetRuntimeData().renderMode), renderFlags));
+				const auto renderMode = static_cast<uint32_t>(shaderAccumulator->GetRuntimeData().renderMode);
+				State::GetSingleton()->BeginPerfEvent(State::GetPerfEventKey(State::PerfEvent::FinishAccumulatingDispatch, renderMode, renderFlags), [&] {
+					return std::format("BSShaderAccumulator::FinishAccumulatingDispatch [{}] <{}>", renderMode, renderFlags);
+				});
 			}
 
 			func(shaderAccumulator, renderFlags);
@@ -92,7 +100,9 @@ namespace FrameAnnotations
 	{
 		static void thunk(RE::NiAVObject* camera, int a2, bool a3, bool a4, bool a5)
 		{
-			State::GetSingleton()->BeginPerfEvent(std::format("Cubemap {}", camera->name.c_str()));
+			State::GetSingleton()->BeginPerfEvent(State::GetPerfEventKey(State::PerfEvent::RenderCubemap, camera->name.data()), [&] {
+				return std::format("Cubemap {}", camera->name.c_str());
+			});
 
 			func(camera, a2, a3, a4, a5);
 
@@ -152,8 +162,9 @@ namespace FrameAnnotations
 		{
 			const bool extendedFrameAnnotations = State::GetSingleton()->extendedFrameAnnotations;
 			if (extendedFrameAnnotations) {
-				State::GetSingleton()->BeginPerfEvent(std::format("BSBatchRenderer::RenderBatches ({:X})[{}] <{}>", *currentPass, *bucketIndex,
-					renderFlags));
+				State::GetSingleton()->BeginPerfEvent(State::GetPerfEventKey(State::PerfEvent::RenderBatches, *currentPass, *bucketIndex, renderFlags), [&] {
+					return std::format("BSBatchRenderer::RenderBatches ({:X})[{}] <{}>", *currentPass, *bucketIndex, renderFlags);
+				});
 			}
 
 			const bool result = func(renderer, currentPass, bucketIndex, passIndexList, renderFlags);
@@ -264,8 +275,9 @@ namespace FrameAnnotations
 		{
 			const bool extendedFrameAnnotations = State::GetSingleton()->extendedFrameAnnotations;
 			if (extendedFrameAnnotations) {
-				State::GetSingleton()->BeginPerfEvent(std::format("BSShaderAccumulator::RenderBatches ({:X}:{:X})[{}] <{}>", firstPass, lastPass, groupIndex,
-					renderFlags));
+				State::GetSingleton()->BeginPerfEvent(State::GetPerfEventKey(State::PerfEvent::AccumulatorRenderBatches, firstPass, lastPass, groupIndex, renderFlags), [&] {
+					return std::format("BSShaderAccumulator::RenderBatches ({:X}:{:X})[{}] <{}>", firstPass, lastPass, groupIndex, renderFlags);
+				});
 			}
 
 			func(shaderAccumulator, firstPass, lastPass, renderFlags, groupIndex);
@@ -283,7 +295,9 @@ namespace FrameAnnotations
 		{
 			const bool extendedFrameAnnotations = State::GetSingleton()->extendedFrameAnnotations;
 			if (extendedFrameAnnotations) {
-				State::GetSingleton()->BeginPerfEvent(std::format("BSShaderAccumulator::RenderPersistentPassList <{}>", renderFlags));
+				State::GetSingleton()->BeginPerfEvent(State::GetPerfEventKey(State::PerfEvent::RenderPersistentPassList, renderFlags), [&] {
+					return std::format("BSShaderAccumulator::RenderPersistentPassList <{}>", renderFlags);
+				});
 			}
 
 			func(passList, renderFlags);
@@ -0,0 +1,291 @@
+#include "FrameBudget.h"
+
+#include "Util.h"
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
+	FrameBudget::Settings,
+	Enabled,
+	TargetFrameTime,
+	Hysteresis,
+	CooldownFrames,
+	WorkBudget);
+
+FrameBudget::KnobId FrameBudget::RegisterKnob(std::string_view a_name, int a_priority, float a_minScale, float a_step, Profiler::ScopeId a_costScope)
+{
+	for (KnobId i = 0; i < knobs.size(); i++) {
+		if (knobs[i].name == a_name)
+			return i;
+	}
+
+	auto& knob = knobs.emplace_back();
+	knob.name = a_name;
+	knob.priority = a_priority;
+	knob.minScale = std::clamp(a_minScale, 0.0f, 1.0f);
+	knob.step = std::max(a_step, 0.01f);
+	knob.costScope = a_costScope;
+	return (KnobId)knobs.size() - 1;
+}
+
+bool FrameBudget::Tick(KnobId a_id)
+{
+	auto& knob = knobs[a_id];
+	knob.accumulator += knob.scale;
+	if (knob.accumulator < 1.0f)
+		return false;
+	knob.accumulator -= 1.0f;
+	return true;
+}
+
+FrameBudget::TaskId FrameBudget::RegisterTask(std::string_view a_name, int a_priority, uint a_deadline, Profiler::ScopeId a_costScope)
+{
+	for (TaskId i = 0; i < tasks.size(); i++) {
+		if (tasks[i].name == a_name)
+			return i;
+	}
+
+	auto& task = tasks.emplace_back();
+	task.name = a_name;
+	task.priority = a_priority;
+	task.deadline = std::max(a_deadline, 1u);
+	task.costScope = a_costScope;
+	task.granted = true;
+	return (TaskId)tasks.size() - 1;
+}
+
+bool FrameBudget::Request(TaskId a_id)
+{
+	auto& task = tasks[a_id];
+	task.requested = true;
+
+	// Tasks that were idle last frame were not planned for, they can have what the plan left over
+	if (!task.granted && !task.planned && task.cost <= unplannedBudget) {
+		unplannedBudget -= task.cost;
+		task.granted = true;
+	}
+	if (!task.granted)
+		return false;
+
+	task.steps++;
+	task.averageLatency = std::lerp(task.averageLatency, (float)task.waited, task.steps == 1 ? 1.0f : 0.05f);
+	task.maxLatency = std::max(task.maxLatency, task.waited);
+	task.waited = 0;
+	return true;
+}
+
+void FrameBudget::ScheduleTasks()
+{
+	auto profiler = Profiler::GetSingleton();
+
+	std::vector<Task*> pending;
+	for (auto& task : tasks) {
+		float measured = profiler->GetLastFrameTime(task.costScope) + profiler->GetLastGPUFrameTime(task.costScope);
+		if (measured > 0.0f)
+			task.cost = task.cost > 0.0f ? std::lerp(task.cost, measured, 0.1f) : measured;
+
+		if (task.requested && !task.granted && task.waited < UINT_MAX)
+			task.waited++;
+		task.planned = task.requested;
+		task.granted = false;
+		task.requested = false;
+		if (task.planned)
+			pending.push_back(&task);
+	}
+
+	if (!settings.Enabled) {
+		for (auto& task : tasks)
+			task.granted = true;
+		unplannedBudget = 0.0f;
+		return;
+	}
+
+	// Overdue tasks first, then by priority, then the one that waited longest
+	std::stable_sort(pending.begin(), pending.end(), [](const Task* a, const Task* b) {
+		bool aOverdue = a->waited >= a->deadline;
+		bool bOverdue = b->waited >= b->deadline;
+		if (aOverdue != bOverdue)
+			return aOverdue;
+		if (a->priority != b->priority)
+			return a->priority > b->priority;
+		return a->waited > b->waited;
+	});
+
+	float remaining = settings.WorkBudget;
+	bool any = false;
+	for (auto* task : pending) {
+		// Something always runs, a single task over the whole budget would otherwise only run at its deadline
+		if (task->waited >= task->deadline || task->cost <= remaining || !any) {
+			task->granted = true;
+			remaining -= task->cost;
+			any = true;
+		}
+	}
+	unplannedBudget = std::max(remaining, 0.0f);
+}
+
+bool FrameBudget::Reduce()
+{
+	// Lowest priority first, the most expensive knob among equals
+	Knob* best = nullptr;
+	for (auto& knob : knobs) {
+		if (knob.scale <= knob.minScale)
+			continue;
+		if (!best || knob.priority < best->priority || (knob.priority == best->priority && knob.cost > best->cost))
+			best = &knob;
+	}
+	if (!best)
+		return false;
+
+	best->scale = std::max(best->scale - best->step, best->minScale);
+	return true;
+}
+
+bool FrameBudget::Restore(float a_headroom)
+{
+	// Highest priority first, the cheapest knob among equals
+	Knob* best = nullptr;
+	for (auto& knob : knobs) {
+		if (knob.scale >= 1.0f)
+			continue;
+		if (!best || knob.priority > best->priority || (knob.priority == best->priority && knob.cost < best->cost))
+			best = &knob;
+	}
+	if (!best)
+		return false;
+
+	// Assume cost is linear in the scale and only step up if the estimate fits in the headroom
+	float predicted = best->cost * best->step / std::max(best->scale, 0.01f);
+	if (predicted > a_headroom)
+		return false;
+
+	best->scale = std::min(best->scale + best->step, 1.0f);
+	return true;
+}
+
+void FrameBudget::Update()
+{
+	ScheduleTasks();
+
+	if (!settings.Enabled) {
+		for (auto& knob : knobs)
+			knob.scale = 1.0f;
+		smoothedFrameTime = 0.0f;
+		cooldown = 0;
+		return;
+	}
+
+	auto profiler = Profiler::GetSingleton();
+	float frameTime = profiler->GetFrameTime();
+	if (frameTime <= 0.0f)
+		return;
+
+	// Loading screens and alt-tab produce single huge frames, don't let them drag the average
+	frameTime = std::min(frameTime, settings.TargetFrameTime * 4.0f);
+	smoothedFrameTime = smoothedFrameTime > 0.0f ? std::lerp(smoothedFrameTime, frameTime, 0.1f) : frameTime;
+
+	// Knobs whose scope did not run last frame keep their previous estimate
+	for (auto& knob : knobs) {
+		float measured = profiler->GetLastFrameTime(knob.costScope) + profiler->GetLastGPUFrameTime(knob.costScope);
+		if (measured > 0.0f)
+			knob.cost = knob.cost > 0.0f ? std::lerp(knob.cost, measured, 0.1f) : measured;
+	}
+
+	if (cooldown) {
+		cooldown--;
+		return;
+	}
+
+	bool changed = false;
+	if (smoothedFrameTime > settings.TargetFrameTime * (1.0f + settings.Hysteresis))
+		changed = Reduce();
+	else if (smoothedFrameTime < settings.TargetFrameTime * (1.0f - settings.Hysteresis))
+		changed = Restore(settings.TargetFrameTime - smoothedFrameTime);
+
+	// Give the change time to show up in the measurements before moving again
+	if (changed)
+		cooldown = settings.CooldownFrames;
+}
+
+void FrameBudget::DrawSettings()
+{
+	if (ImGui::TreeNodeEx("Frame Budget")) {
+		ImGui::Checkbox("Enable Frame Budget", &settings.Enabled);
+		if (auto _tt = Util::HoverTooltipWrapper()) {
+			ImGui::Text(
+				"Lowers the quality of expensive effects when the frame time goes over the target, and restores it when there is headroom. "
+				"Your own settings are the upper limit and are never changed.");
+		}
+
+		ImGui::SliderFloat("Target Frame Time", &settings.TargetFrameTime, 4.0f, 50.0f, "%.1f ms");
+		ImGui::SliderFloat("Hysteresis", &settings.Hysteresis, 0.0f, 0.5f, "%.2f");
+		if (auto _tt = Util::HoverTooltipWrapper()) {
+			ImGui::Text("Fraction of the target the frame time has to be above or below before anything changes.");
+		}
+		static constexpr uint minCooldown = 1, maxCooldown = 120;
+		ImGui::SliderScalar("Cooldown", ImGuiDataType_U32, &settings.CooldownFrames, &minCooldown, &maxCooldown, "%u frames");
+
+		ImGui::Text("Smoothed Frame Time : %.2f ms", smoothedFrameTime);
+
+		if (ImGui::BeginTable("##FrameBudgetKnobs", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+			ImGui::TableSetupColumn("Knob");
+			ImGui::TableSetupColumn("Priority");
+			ImGui::TableSetupColumn("Scale");
+			ImGui::TableSetupColumn("Cost (ms)");
+			ImGui::TableHeadersRow();
+			for (const auto& knob : knobs) {
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(knob.name.c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%d", knob.priority);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f (min %.2f)", knob.scale, knob.minScale);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", knob.cost);
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::SliderFloat("Work Budget", &settings.WorkBudget, 0.1f, 10.0f, "%.1f ms");
+		if (auto _tt = Util::HoverTooltipWrapper()) {
+			ImGui::Text(
+				"Time per frame shared by the effects that spread their updates over several frames. "
+				"Steps that do not fit are deferred to a later frame, up to the deadline of each effect.");
+		}
+
+		if (ImGui::BeginTable("##FrameBudgetTasks", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+			ImGui::TableSetupColumn("Task");
+			ImGui::TableSetupColumn("Priority");
+			ImGui::TableSetupColumn("Deadline");
+			ImGui::TableSetupColumn("Cost (ms)");
+			ImGui::TableSetupColumn("Latency (frames)");
+			ImGui::TableSetupColumn("Steps");
+			ImGui::TableHeadersRow();
+			for (const auto& task : tasks) {
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(task.name.c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%d", task.priority);
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", task.deadline);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", task.cost);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.1f (max %u)", task.averageLatency, task.maxLatency);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", task.steps);
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::TreePop();
+	}
+}
+
+void FrameBudget::SaveSettings(json& o_json)
+{
+	o_json = settings;
+}
+
+void FrameBudget::LoadSettings(json& o_json)
+{
+	settings = o_json;
+}
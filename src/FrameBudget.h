@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Profiler.h"
+
+/**
+ * Scales declared quality knobs of costly features to hold a target frame time.
+ *
+ * Features register a knob with a priority, a lower bound and the profiler scope that measures its cost,
+ * then read back a scale in [minScale, 1] that is multiplied onto their own setting.
+ * The user setting is never modified, so the governor can only trade quality down from what was chosen.
+ * Lower priority knobs are reduced first and restored last.
+ *
+ * Amortized work that features spread over frames themselves is registered as a task instead.
+ * Tasks share a per-frame work budget, so in a bad frame they are staggered instead of all running at once.
+ */
+class FrameBudget
+{
+public:
+	static FrameBudget* GetSingleton()
+	{
+		static FrameBudget singleton;
+		return &singleton;
+	}
+
+	using KnobId = uint32_t;
+	using TaskId = uint32_t;
+
+	struct Settings
+	{
+		bool Enabled = false;
+		float TargetFrameTime = 16.6f;
+		float Hysteresis = 0.1f;
+		uint CooldownFrames = 15;
+		float WorkBudget = 2.0f;
+	};
+
+	Settings settings;
+
+	/**
+	 * Returns the id of the knob with this name, registering it on first use.
+	 * Render thread only.
+	 */
+	KnobId RegisterKnob(std::string_view a_name, int a_priority, float a_minScale, float a_step, Profiler::ScopeId a_costScope);
+
+	float GetScale(KnobId a_id) const { return knobs[a_id].scale; }
+
+	// Scales an integer setting, never going below a_min
+	uint Scale(KnobId a_id, uint a_value, uint a_min = 1) const
+	{
+		return std::max(a_min, (uint)std::lround((float)a_value * knobs[a_id].scale));
+	}
+
+	// For rate knobs, returns true on the fraction of calls given by the current scale
+	bool Tick(KnobId a_id);
+
+	/**
+	 * Returns the id of the task with this name, registering it on first use.
+	 * The task may be deferred for up to a_deadline frames, after that it runs regardless of the budget.
+	 * Render thread only.
+	 */
+	TaskId RegisterTask(std::string_view a_name, int a_priority, uint a_deadline, Profiler::ScopeId a_costScope);
+
+	/**
+	 * Called when a task has a step of work ready, returns true if the step should run this frame.
+	 * Tasks that asked in the previous frame are planned at its end, so the answer does not depend on the order features run in.
+	 */
+	bool Request(TaskId a_id);
+
+	/**
+	 * Moves at most one knob by one step based on the smoothed frame time.
+	 * Called once per frame from present, after the profiler closed the frame.
+	 */
+	void Update();
+
+	void DrawSettings();
+	void SaveSettings(json& o_json);
+	void LoadSettings(json& o_json);
+
+private:
+	struct Knob
+	{
+		std::string name;
+		int priority = 0;
+		float minScale = 1.0f;
+		float step = 0.1f;
+		Profiler::ScopeId costScope = 0;
+		float scale = 1.0f;
+		float accumulator = 0.0f;
+		float cost = 0.0f;  // smoothed ms of its scope
+	};
+
+	struct Task
+	{
+		std::string name;
+		int priority = 0;
+		uint deadline = 1;
+		Profiler::ScopeId costScope = 0;
+		float cost = 0.0f;  // smoothed ms per step
+		uint waited = 0;    // frames the pending step has been deferred
+		bool requested = false;
+		bool planned = false;
+		bool granted = false;
+		uint64_t steps = 0;
+		float averageLatency = 0.0f;
+		uint maxLatency = 0;
+	};
+
+	bool Reduce();
+	bool Restore(float a_headroom);
+	void ScheduleTasks();
+
+	std::vector<Knob> knobs;
+	std::vector<Task> tasks;
+	float unplannedBudget = 0.0f;
+	float smoothedFrameTime = 0.0f;
+	uint cooldown = 0;
+};
@@ -0,0 +1,21 @@
+#include "GPUTimer.h"
+
+uint32_t GPUTimer::Begin(uint32_t a_id)
+{
+	auto& frame = frames[frameIndex];
+	if (!frameActive || frame.count == MaxScopesPerFrame)
+		return InvalidSlot;
+
+	uint32_t slot = frame.count++;
+	frame.ids[slot] = a_id;
+	queries->Timestamp(frameIndex, slot * 2);
+	return slot;
+}
+
+void GPUTimer::End(uint32_t a_slot)
+{
+	if (!frameActive || a_slot == InvalidSlot)
+		return;
+
+	queries->Timestamp(frameIndex, a_slot * 2 + 1);
+}
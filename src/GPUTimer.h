@@ -0,0 +1,146 @@
+#pragma once
+
+/**
+ * GPU timestamp and disjoint queries of a few frames in flight, implemented on D3D11 by the profiler and mocked in the tests.
+ * Frames and timestamps are indices into the queries made by Create.
+ */
+class GPUQueries
+{
+public:
+	virtual ~GPUQueries() = default;
+
+	// Creates one disjoint query and a_timestamps timestamp queries for each of a_frames frames
+	virtual bool Create(uint32_t a_frames, uint32_t a_timestamps) = 0;
+
+	virtual void BeginDisjoint(uint32_t a_frame) = 0;
+	virtual void EndDisjoint(uint32_t a_frame) = 0;
+	virtual void Timestamp(uint32_t a_frame, uint32_t a_index) = 0;
+
+	// Results without waiting, false while the frame is still in flight
+	virtual bool GetDisjoint(uint32_t a_frame, uint64_t& o_frequency, bool& o_disjoint) = 0;
+	virtual bool GetTimestamp(uint32_t a_frame, uint32_t a_index, uint64_t& o_ticks) = 0;
+};
+
+/**
+ * Times scopes on the GPU with FrameLatency frames of queries in flight.
+ * A frame is read back once the GPU finished it, a frame whose queries are all still in flight is skipped rather than waited on,
+ * and disjoint frames are dropped since their timestamps are unreliable.
+ */
+class GPUTimer
+{
+public:
+	static constexpr uint32_t FrameLatency = 4;
+	static constexpr uint32_t MaxScopesPerFrame = 64;
+	static constexpr uint32_t InvalidSlot = UINT32_MAX;
+
+	// History value of a frame without timestamps for a scope: not issued, disjoint or never resolved
+	static constexpr float Unrecorded = std::numeric_limits<float>::quiet_NaN();
+
+	explicit GPUTimer(std::unique_ptr<GPUQueries> a_queries) :
+		queries(std::move(a_queries)) {}
+
+	// Returns InvalidSlot when no query is available this frame
+	uint32_t Begin(uint32_t a_id);
+	void End(uint32_t a_slot);
+
+	/**
+	 * Closes the current frame, reads back finished frames oldest first and opens a frame recorded into a_historyIndex.
+	 * @param a_record Called with (id, historyIndex, milliseconds) for every scope of a resolved frame.
+	 */
+	template <class F>
+	void Advance(uint32_t a_historyIndex, F&& a_record)
+	{
+		if (failed)
+			return;
+
+		if (!created) {
+			if (!queries->Create(FrameLatency, MaxScopesPerFrame * 2)) {
+				logger::warn("[Profiler] Failed to create GPU timestamp queries, GPU scopes are disabled");
+				failed = true;
+				return;
+			}
+			created = true;
+		}
+
+		if (frameActive) {
+			queries->EndDisjoint(frameIndex);
+			frames[frameIndex].pending = true;
+			frameIndex = (frameIndex + 1) % FrameLatency;
+		}
+
+		for (uint32_t i = 0; i < FrameLatency; i++) {
+			uint32_t index = (frameIndex + i) % FrameLatency;
+			if (frames[index].pending)
+				Resolve(index, a_record);
+		}
+
+		auto& frame = frames[frameIndex];
+		frameActive = !frame.pending;
+		if (frameActive) {
+			frame.count = 0;
+			frame.historyIndex = a_historyIndex;
+			queries->BeginDisjoint(frameIndex);
+		} else {
+			framesSkipped++;
+		}
+	}
+
+	// Adds a_milliseconds to a history value, which starts at Unrecorded
+	static void Accumulate(float& a_time, float a_milliseconds)
+	{
+		if (std::isnan(a_time))
+			a_time = 0.0f;
+		a_time += a_milliseconds;
+	}
+
+	// History index of the most recently resolved frame, UINT32_MAX before the first one
+	uint32_t GetLastHistoryIndex() const { return lastHistoryIndex; }
+	uint32_t GetFramesSkipped() const { return framesSkipped; }
+	bool IsFailed() const { return failed; }
+
+private:
+	struct Frame
+	{
+		std::array<uint32_t, MaxScopesPerFrame> ids{};
+		uint32_t count = 0;
+		uint32_t historyIndex = 0;
+		bool pending = false;
+	};
+
+	template <class F>
+	bool Resolve(uint32_t a_frame, F&& a_record)
+	{
+		auto& frame = frames[a_frame];
+
+		uint64_t frequency = 0;
+		bool disjoint = false;
+		if (!queries->GetDisjoint(a_frame, frequency, disjoint))
+			return false;
+
+		std::array<uint64_t, MaxScopesPerFrame * 2> times;
+		for (uint32_t i = 0; i < frame.count * 2; i++) {
+			if (!queries->GetTimestamp(a_frame, i, times[i]))
+				return false;
+		}
+
+		// A disjoint frame has unreliable timestamps, it is dropped rather than recorded as garbage
+		if (!disjoint && frequency) {
+			for (uint32_t i = 0; i < frame.count; i++)
+				a_record(frame.ids[i], frame.historyIndex, (float)((double)(times[i * 2 + 1] - times[i * 2]) * 1000.0 / (double)frequency));
+			lastHistoryIndex = frame.historyIndex;
+		}
+
+		frame.pending = false;
+		frame.count = 0;
+		return true;
+	}
+
+	std::unique_ptr<GPUQueries> queries;
+	std::array<Frame, FrameLatency> frames;
+	uint32_t frameIndex = 0;
+	uint32_t lastHistoryIndex = UINT32_MAX;
+	uint32_t framesSkipped = 0;
+	bool frameActive = false;
+	bool created = false;
+	bool failed = false;
+};
@@ -1,6 +1,8 @@
 #include "Hooks.h"
 
 #include "Menu.h"
+#include "FrameBudget.h"
+#include "Profiler.h"
 #include "ShaderCache.h"
 #include "State.h"
 #include "TruePBR.h"
@@ -99,6 +101,31 @@ struct BSShader_LoadShaders
 	static inline REL::Relocation<decltype(thunk)> func;
 };
 
+// Direct-mapped cache of resolved shaders, repeated draws skip the string keyed lookups in ShaderCache
+struct ShaderLookupCache
+{
+	struct Entry
+	{
+		RE::BSShader* shader = nullptr;
+		uint32_t vertexDescriptor = 0;
+		uint32_t pixelDescriptor = 0;
+		uint32_t generation = 0;
+		RE::BSGraphics::VertexShader* vertexShader = nullptr;
+		RE::BSGraphics::PixelShader* pixelShader = nullptr;
+	};
+
+	static constexpr size_t Size = 64;
+	std::array<Entry, Size> entries{};
+
+	Entry& Get(RE::BSShader* a_shader, uint32_t a_vertexDescriptor, uint32_t a_pixelDescriptor)
+	{
+		auto hash = (uint32_t)(reinterpret_cast<std::uintptr_t>(a_shader) >> 4) ^ (a_vertexDescriptor * 0x9E3779B1u) ^ (a_pixelDescriptor * 0x85EBCA77u);
+		return entries[(hash ^ (hash >> 16)) & (Size - 1)];
+	}
+};
+
+static ShaderLookupCache shaderLookupCache;
+
 bool Hooks::BSShader_BeginTechnique::thunk(RE::BSShader* shader, uint32_t vertexDescriptor, uint32_t pixelDescriptor, bool skipPixelShader)
 {
 	auto state = State::GetSingleton();
@@ -118,8 +145,24 @@ bool Hooks::BSShader_BeginTechnique::thunk(RE::BSShader* shader, uint32_t vertex
 
 	if (!shaderFound && shader->shaderType.get() != RE::BSShader::Type::Effect) {
 		auto& shaderCache = SIE::ShaderCache::Instance();
-		RE::BSGraphics::VertexShader* vertexShader = shaderCache.GetVertexShader(*shader, state->modifiedVertexDescriptor);
-		RE::BSGraphics::PixelShader* pixelShader = shaderCache.GetPixelShader(*shader, state->modifiedPixelDescriptor);
+		auto generation = shaderCache.GetGeneration();
+
+		// Developer mode can block or disable shaders per lookup, so it always goes through the shader cache
+		bool useLookupCache = state->enableVShaders && state->enablePShaders && !state->IsDeveloperMode();
+		auto& entry = shaderLookupCache.Get(shader, state->modifiedVertexDescriptor, state->modifiedPixelDescriptor);
+
+		RE::BSGraphics::VertexShader* vertexShader = nullptr;
+		RE::BSGraphics::PixelShader* pixelShader = nullptr;
+		if (useLookupCache && entry.shader == shader && entry.vertexDescriptor == state->modifiedVertexDescriptor &&
+			entry.pixelDescriptor == state->modifiedPixelDescriptor && entry.generation == generation) {
+			vertexShader = entry.vertexShader;
+			pixelShader = entry.pixelShader;
+		} else {
+			vertexShader = shaderCache.GetVertexShader(*shader, state->modifiedVertexDescriptor);
+			pixelShader = shaderCache.GetPixelShader(*shader, state->modifiedPixelDescriptor);
+			if (useLookupCache && vertexShader && pixelShader)
+				entry = { shader, state->modifiedVertexDescriptor, state->modifiedPixelDescriptor, generation, vertexShader, pixelShader };
+		}
 		if (vertexShader == nullptr || (!skipPixelShader && pixelShader == nullptr)) {
 			shaderFound = false;
 		} else {
@@ -162,6 +205,8 @@ struct IDXGISwapChain_Present
 	static HRESULT WINAPI thunk(IDXGISwapChain* This, UINT SyncInterval, UINT Flags)
 	{
 		State::GetSingleton()->Reset();
+		Profiler::GetSingleton()->EndFrame();
+		FrameBudget::GetSingleton()->Update();
 		Menu::GetSingleton()->DrawOverlay();
 		Streamline::GetSingleton()->Present();
 		auto retval = func(This, SyncInterval, Flags);
@@ -16,6 +16,8 @@
 #include "Features/LightLimitFix/ParticleLights.h"
 
 #include "Deferred.h"
+#include "FrameBudget.h"
+#include "Profiler.h"
 #include "TruePBR.h"
 
 #include "Streamline.h"
@@ -856,6 +858,15 @@ void Menu::DrawAdvancedSettings()
 			ImGui::Text(std::format("Shader Compiler : {}", shaderCache.GetShaderStatsString()).c_str());
 			ImGui::TreePop();
 		}
+		Profiler::GetSingleton()->DrawSettings();
+		FrameBudget::GetSingleton()->DrawSettings();
+		if (ImGui::Button("Rebuild Asset Manifest"))
+			Util::AssetManifest::GetSingleton()->Clear();
+		if (auto _tt = Util::HoverTooltipWrapper()) {
+			ImGui::Text(
+				"Folder listings read at startup are cached and only refreshed when a folder's modified date changes. "
+				"If files added by a mod are not picked up, rebuild the manifest and restart the game.");
+		}
 		ImGui::Checkbox("Extended Frame Annotations", &State::GetSingleton()->extendedFrameAnnotations);
 	}
 
@@ -1025,7 +1036,9 @@ void Menu::DrawOverlay()
 	auto failed = shaderCache.GetFailedTasks();
 	auto hide = shaderCache.IsHideErrors();
 
-	if (!(shaderCache.IsCompiling() || IsEnabled || inTestMode || (failed && !hide))) {
+	auto profiler = Profiler::GetSingleton();
+
+	if (!(shaderCache.IsCompiling() || IsEnabled || inTestMode || (failed && !hide) || profiler->settings.ShowOverlay)) {
 		auto& io = ImGui::GetIO();
 		io.ClearInputKeys();
 		io.ClearEventsQueue();
@@ -1091,6 +1104,9 @@ void Menu::DrawOverlay()
 		ImGui::GetIO().MouseDrawCursor = false;
 	}
 
+	if (profiler->settings.ShowOverlay)
+		profiler->DrawOverlay();
+
 	if (inTestMode) {  // In test mode
 		float seconds = (float)duration_cast<std::chrono::milliseconds>(high_resolution_clock::now() - lastTestSwitch).count() / 1000;
 		auto remaining = (float)testInterval - seconds;
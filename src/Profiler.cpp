@@ -0,0 +1,488 @@
+#include "Profiler.h"
+
+#include "State.h"
+#include "Util.h"
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
+	Profiler::Settings,
+	ShowOverlay,
+	StutterThreshold);
+
+Profiler::Profiler()
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	ticksToMs = 1000.0 / (double)frequency.QuadPart;
+}
+
+Profiler::ScopeId Profiler::RegisterScope(std::string_view a_name)
+{
+	std::lock_guard lock(scopesMutex);
+
+	std::string name{ a_name };
+	if (auto it = scopeIds.find(name); it != scopeIds.end())
+		return it->second;
+
+	if (scopeCount == MaxScopes) {
+		logger::warn("[Profiler] Scope limit reached, {} shares the last scope", name);
+		return MaxScopes - 1;
+	}
+
+	ScopeId id = scopeCount++;
+	scopes[id].name = name;
+	scopes[id].gpuHistory.fill(UnrecordedGPUTime);
+	scopeIds.emplace(std::move(name), id);
+	return id;
+}
+
+static constexpr std::array<const char*, (size_t)Profiler::StutterCause::Count> StutterCauseNames = {
+	"Shader Compile",
+	"Disk Cache Load",
+	"Heightmap Load",
+	"Compute Shader Compile",
+	"Settings Save",
+	"Skylighting Cache",
+	"Cubemap Cache"
+};
+
+void Profiler::PostStutterEvent(StutterCause a_cause, int64_t a_start, int64_t a_end)
+{
+	journal.Post({ a_cause, GetCurrentThreadId() == frameThreadId.load(std::memory_order_relaxed), a_end - a_start });
+}
+
+void Profiler::DrainJournal()
+{
+	droppedEvents += journal.Drain([&](const StutterEvent& a_event) {
+		float time = (float)((double)a_event.ticks * ticksToMs);
+		if (a_event.frameThread) {
+			pendingStutter.causeTime[(size_t)a_event.cause] += time;
+			pendingStutter.causeCount[(size_t)a_event.cause]++;
+		} else {
+			pendingStutter.backgroundTime += time;
+		}
+	});
+}
+
+Profiler::ThreadRing* Profiler::GetThreadRing()
+{
+	thread_local ThreadRing* ring = nullptr;
+	if (!ring) {
+		std::lock_guard lock(ringsMutex);
+		ring = rings.emplace_back(std::make_unique<ThreadRing>()).get();
+	}
+	return ring;
+}
+
+void Profiler::Record(ScopeId a_id, int64_t a_start, int64_t a_end)
+{
+	GetThreadRing()->Push({ a_id, a_start, a_end });
+}
+
+namespace
+{
+	class D3D11GPUQueries : public GPUQueries
+	{
+	public:
+		bool Create(uint32_t a_frames, uint32_t a_timestamps) override
+		{
+			auto device = State::GetSingleton()->device;
+			if (!device)
+				return false;
+
+			D3D11_QUERY_DESC disjointDesc{ D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+			D3D11_QUERY_DESC timestampDesc{ D3D11_QUERY_TIMESTAMP, 0 };
+
+			frames.resize(a_frames);
+			for (auto& frame : frames) {
+				if (FAILED(device->CreateQuery(&disjointDesc, frame.disjoint.put())))
+					return false;
+				frame.timestamps.resize(a_timestamps);
+				for (auto& timestamp : frame.timestamps) {
+					if (FAILED(device->CreateQuery(&timestampDesc, timestamp.put())))
+						return false;
+				}
+			}
+			return true;
+		}
+
+		void BeginDisjoint(uint32_t a_frame) override { State::GetSingleton()->context->Begin(frames[a_frame].disjoint.get()); }
+		void EndDisjoint(uint32_t a_frame) override { State::GetSingleton()->context->End(frames[a_frame].disjoint.get()); }
+		void Timestamp(uint32_t a_frame, uint32_t a_index) override { State::GetSingleton()->context->End(frames[a_frame].timestamps[a_index].get()); }
+
+		bool GetDisjoint(uint32_t a_frame, uint64_t& o_frequency, bool& o_disjoint) override
+		{
+			D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+			if (State::GetSingleton()->context->GetData(frames[a_frame].disjoint.get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+				return false;
+			o_frequency = disjoint.Frequency;
+			o_disjoint = disjoint.Disjoint;
+			return true;
+		}
+
+		bool GetTimestamp(uint32_t a_frame, uint32_t a_index, uint64_t& o_ticks) override
+		{
+			return State::GetSingleton()->context->GetData(frames[a_frame].timestamps[a_index].get(), &o_ticks, sizeof(uint64_t), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK;
+		}
+
+	private:
+		struct Frame
+		{
+			winrt::com_ptr<ID3D11Query> disjoint;
+			std::vector<winrt::com_ptr<ID3D11Query>> timestamps;
+		};
+
+		std::vector<Frame> frames;
+	};
+}
+
+uint32_t Profiler::BeginGPU(ScopeId a_id)
+{
+	return gpuTimer ? gpuTimer->Begin(a_id) : GPUTimer::InvalidSlot;
+}
+
+void Profiler::EndGPU(uint32_t a_slot)
+{
+	if (gpuTimer)
+		gpuTimer->End(a_slot);
+}
+
+void Profiler::AdvanceGPUFrame()
+{
+	if (!State::GetSingleton()->context)
+		return;
+
+	if (!gpuTimer)
+		gpuTimer = std::make_unique<GPUTimer>(std::make_unique<D3D11GPUQueries>());
+
+	gpuTimer->Advance(historyIndex, [&](ScopeId a_id, uint32_t a_historyIndex, float a_time) {
+		auto& scope = scopes[a_id];
+		GPUTimer::Accumulate(scope.gpuHistory[a_historyIndex], a_time);
+		scope.hasGPU = true;
+	});
+}
+
+void Profiler::EndFrame()
+{
+	std::lock_guard scopesLock(scopesMutex);
+
+	int64_t now = Now();
+	if (lastFrameEnd)
+		frameTime = (float)((double)(now - lastFrameEnd) * ticksToMs);
+	lastFrameEnd = now;
+	frameThreadId.store(GetCurrentThreadId(), std::memory_order_relaxed);
+
+	DrainJournal();
+	if (frameTime > settings.StutterThreshold) {
+		pendingStutter.frame = frameNumber;
+		pendingStutter.frameTime = frameTime;
+		stutters[stutterIndex] = pendingStutter;
+		stutterIndex = (stutterIndex + 1) % MaxStutters;
+		stutterCount = std::min(stutterCount + 1, MaxStutters);
+	}
+	pendingStutter = {};
+	frameNumber++;
+
+	{
+		std::lock_guard ringsLock(ringsMutex);
+		for (auto& ring : rings) {
+			droppedEvents += ring->Drain([&](const Event& a_event) {
+				auto& scope = scopes[a_event.id];
+				scope.frameTicks += a_event.end - a_event.start;
+				scope.frameCalls++;
+			});
+		}
+	}
+
+	for (uint32_t i = 0; i < scopeCount; i++) {
+		auto& scope = scopes[i];
+		scope.history[historyIndex] = (float)((double)scope.frameTicks * ticksToMs);
+		scope.callHistory[historyIndex] = scope.frameCalls;
+		scope.frameTicks = 0;
+		scope.frameCalls = 0;
+	}
+
+	historyIndex = (historyIndex + 1) % HistoryFrames;
+	historyCount = std::min(historyCount + 1, HistoryFrames);
+
+	for (uint32_t i = 0; i < scopeCount; i++)
+		scopes[i].gpuHistory[historyIndex] = UnrecordedGPUTime;
+
+	AdvanceGPUFrame();
+}
+
+std::vector<Profiler::ScopeSummary> Profiler::GetSummaries()
+{
+	std::lock_guard lock(scopesMutex);
+
+	std::vector<ScopeSummary> summaries;
+	summaries.reserve(scopeCount);
+
+	std::vector<float> sorted;
+	sorted.reserve(historyCount);
+
+	for (uint32_t i = 0; i < scopeCount; i++) {
+		const auto& scope = scopes[i];
+
+		ScopeSummary summary;
+		summary.name = scope.name;
+
+		if (historyCount > 0) {
+			sorted.assign(scope.history.begin(), scope.history.begin() + historyCount);
+			std::sort(sorted.begin(), sorted.end());
+
+			uint64_t calls = 0;
+			for (uint32_t frame = 0; frame < historyCount; frame++)
+				calls += scope.callHistory[frame];
+
+			summary.average = std::accumulate(sorted.begin(), sorted.end(), 0.0f) / (float)historyCount;
+			summary.p95 = sorted[std::min(historyCount - 1, (historyCount * 95) / 100)];
+			summary.max = sorted.back();
+			summary.last = scope.history[(historyIndex + HistoryFrames - 1) % HistoryFrames];
+			summary.calls = (float)calls / (float)historyCount;
+		}
+
+		// The newest frames are still in flight on the GPU and excluded, as are frames the scope was not recorded in
+		if (scope.hasGPU && historyCount > GPUFrameLatency + 1) {
+			sorted.clear();
+			for (uint32_t frame = 0; frame < historyCount - GPUFrameLatency - 1; frame++) {
+				float time = scope.gpuHistory[(historyIndex + HistoryFrames - GPUFrameLatency - 1 - frame) % HistoryFrames];
+				if (!std::isnan(time))
+					sorted.push_back(time);
+			}
+			std::sort(sorted.begin(), sorted.end());
+
+			if (uint32_t gpuCount = (uint32_t)sorted.size()) {
+				summary.hasGPU = true;
+				summary.gpuAverage = std::accumulate(sorted.begin(), sorted.end(), 0.0f) / (float)gpuCount;
+				summary.gpuP95 = sorted[std::min(gpuCount - 1, (gpuCount * 95) / 100)];
+				summary.gpuLast = GetLastGPUFrameTime(i);
+			}
+		}
+
+		summaries.push_back(std::move(summary));
+	}
+
+	return summaries;
+}
+
+float Profiler::GetLastFrameTime(ScopeId a_id)
+{
+	if (historyCount == 0 || a_id >= MaxScopes)
+		return 0.0f;
+	return scopes[a_id].history[(historyIndex + HistoryFrames - 1) % HistoryFrames];
+}
+
+float Profiler::GetLastGPUFrameTime(ScopeId a_id)
+{
+	uint32_t lastGPUHistoryIndex = gpuTimer ? gpuTimer->GetLastHistoryIndex() : UINT32_MAX;
+	if (lastGPUHistoryIndex >= HistoryFrames || a_id >= MaxScopes)
+		return 0.0f;
+	float time = scopes[a_id].gpuHistory[lastGPUHistoryIndex];
+	return std::isnan(time) ? 0.0f : time;
+}
+
+static void DrawSummaryTable(const std::vector<Profiler::ScopeSummary>& a_summaries)
+{
+	if (ImGui::BeginTable("##ProfilerScopes", 9, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders)) {
+		ImGui::TableSetupColumn("Scope");
+		ImGui::TableSetupColumn("Last (ms)");
+		ImGui::TableSetupColumn("Avg (ms)");
+		ImGui::TableSetupColumn("P95 (ms)");
+		ImGui::TableSetupColumn("Max (ms)");
+		ImGui::TableSetupColumn("Calls");
+		ImGui::TableSetupColumn("GPU Last (ms)");
+		ImGui::TableSetupColumn("GPU Avg (ms)");
+		ImGui::TableSetupColumn("GPU P95 (ms)");
+		ImGui::TableHeadersRow();
+
+		for (const auto& summary : a_summaries) {
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(summary.name.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", summary.last);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", summary.average);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", summary.p95);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", summary.max);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", summary.calls);
+
+			if (summary.hasGPU) {
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", summary.gpuLast);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", summary.gpuAverage);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", summary.gpuP95);
+			} else {
+				ImGui::TableNextColumn();
+				ImGui::TableNextColumn();
+				ImGui::TableNextColumn();
+			}
+		}
+
+		ImGui::EndTable();
+	}
+}
+
+// Newest first
+void Profiler::DrawStutters(uint32_t a_count)
+{
+	for (uint32_t i = 0; i < std::min(a_count, stutterCount); i++) {
+		const auto& stutter = stutters[(stutterIndex + MaxStutters - 1 - i) % MaxStutters];
+
+		std::string causes;
+		for (size_t cause = 0; cause < (size_t)StutterCause::Count; cause++) {
+			if (stutter.causeCount[cause])
+				causes += std::format("{}{} {:.1f} ms ({})", causes.empty() ? "" : ", ", StutterCauseNames[cause], stutter.causeTime[cause], stutter.causeCount[cause]);
+		}
+		if (causes.empty())
+			causes = "Unattributed";
+		if (stutter.backgroundTime > 0.0f)
+			causes += std::format(", background {:.1f} ms", stutter.backgroundTime);
+
+		ImGui::Text("Frame %llu : %.1f ms - %s", stutter.frame, stutter.frameTime, causes.c_str());
+	}
+}
+
+void Profiler::SaveSettings(json& o_json)
+{
+	o_json = settings;
+}
+
+void Profiler::LoadSettings(json& o_json)
+{
+	settings = o_json;
+}
+
+void Profiler::DrawSettings()
+{
+	if (ImGui::TreeNodeEx("Profiler")) {
+		ImGui::Checkbox("Show Profiler Overlay", &settings.ShowOverlay);
+		if (auto _tt = Util::HoverTooltipWrapper()) {
+			ImGui::Text("Shows the CPU time of instrumented scopes while the menu is closed.");
+		}
+
+		auto folder = State::GetSingleton()->folderPath;
+		if (ImGui::Button("Export CSV"))
+			ExportCSV(folder + "\\Profiler.csv");
+		ImGui::SameLine();
+		if (ImGui::Button("Export JSON"))
+			ExportJSON(folder + "\\Profiler.json");
+		if (auto _tt = Util::HoverTooltipWrapper()) {
+			ImGui::Text("Writes the per-frame history of every scope to %s.", folder.c_str());
+		}
+
+		if (droppedEvents)
+			ImGui::Text("Dropped Events : %u", droppedEvents);
+		if (gpuTimer && gpuTimer->GetFramesSkipped())
+			ImGui::Text("GPU Frames Skipped : %u", gpuTimer->GetFramesSkipped());
+
+		DrawSummaryTable(GetSummaries());
+
+		if (ImGui::TreeNodeEx("Stutters")) {
+			ImGui::SliderFloat("Stutter Threshold", &settings.StutterThreshold, 20.0f, 500.0f, "%.0f ms");
+			if (auto _tt = Util::HoverTooltipWrapper()) {
+				ImGui::Text(
+					"Frames slower than this are recorded with the shader compiles, disk cache loads, heightmap loads and settings saves that happened during them. "
+					"Work done on other threads is listed as background.");
+			}
+			if (ImGui::Button("Clear"))
+				stutterCount = 0;
+			DrawStutters(MaxStutters);
+			ImGui::TreePop();
+		}
+
+		ImGui::TreePop();
+	}
+}
+
+void Profiler::DrawOverlay()
+{
+	ImGui::SetNextWindowBgAlpha(0.6f);
+	ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
+	if (ImGui::Begin("Profiler", &settings.ShowOverlay, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing)) {
+		DrawSummaryTable(GetSummaries());
+		DrawStutters(5);
+	}
+	ImGui::End();
+}
+
+bool Profiler::ExportCSV(const std::string& a_path)
+{
+	std::lock_guard lock(scopesMutex);
+
+	std::ofstream o{ a_path };
+	if (!o.is_open()) {
+		logger::warn("[Profiler] Failed to open {}", a_path);
+		return false;
+	}
+
+	o << "Frame";
+	for (uint32_t i = 0; i < scopeCount; i++)
+		o << ",\"" << scopes[i].name << "\"";
+	o << "\n";
+
+	for (uint32_t frame = 0; frame < historyCount; frame++) {
+		uint32_t index = (historyIndex + HistoryFrames - historyCount + frame) % HistoryFrames;
+		o << frame;
+		for (uint32_t i = 0; i < scopeCount; i++)
+			o << "," << scopes[i].history[index];
+		o << "\n";
+	}
+
+	logger::info("[Profiler] Exported {} frames to {}", historyCount, a_path);
+	return true;
+}
+
+bool Profiler::ExportJSON(const std::string& a_path)
+{
+	json exported;
+	{
+		std::lock_guard lock(scopesMutex);
+
+		exported["Frames"] = historyCount;
+		for (uint32_t i = 0; i < scopeCount; i++) {
+			json& scope = exported["Scopes"][scopes[i].name];
+			scope["Time"] = json::array();
+			scope["Calls"] = json::array();
+			for (uint32_t frame = 0; frame < historyCount; frame++) {
+				uint32_t index = (historyIndex + HistoryFrames - historyCount + frame) % HistoryFrames;
+				scope["Time"].push_back(scopes[i].history[index]);
+				scope["Calls"].push_back(scopes[i].callHistory[index]);
+			}
+			if (scopes[i].hasGPU) {
+				scope["GPUTime"] = json::array();
+				for (uint32_t frame = 0; frame < historyCount; frame++)
+					scope["GPUTime"].push_back(scopes[i].gpuHistory[(historyIndex + HistoryFrames - historyCount + frame) % HistoryFrames]);
+			}
+		}
+
+		exported["Stutters"] = json::array();
+		for (uint32_t i = 0; i < stutterCount; i++) {
+			const auto& stutter = stutters[(stutterIndex + MaxStutters - stutterCount + i) % MaxStutters];
+			json entry;
+			entry["Frame"] = stutter.frame;
+			entry["FrameTime"] = stutter.frameTime;
+			entry["Background"] = stutter.backgroundTime;
+			for (size_t cause = 0; cause < (size_t)StutterCause::Count; cause++) {
+				if (stutter.causeCount[cause])
+					entry["Causes"][StutterCauseNames[cause]] = { { "Time", stutter.causeTime[cause] }, { "Count", stutter.causeCount[cause] } };
+			}
+			exported["Stutters"].push_back(entry);
+		}
+	}
+
+	std::ofstream o{ a_path };
+	if (!o.is_open()) {
+		logger::warn("[Profiler] Failed to open {}", a_path);
+		return false;
+	}
+
+	o << exported.dump(1);
+
+	logger::info("[Profiler] Exported {} frames to {}", exported["Frames"].get<uint32_t>(), a_path);
+	return true;
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include "EventJournal.h"
+#include "EventRing.h"
+#include "GPUTimer.h"
+
+/**
+ * Always-on CPU and GPU timing of named scopes.
+ *
+ * CPU scopes are recorded into a lock-free ring per thread and folded into per-scope history once per frame,
+ * so the cost on the recording side is two QPC reads and a ring write.
+ * GPU scopes issue timestamp queries on the immediate context, results are read back a few frames later without stalling.
+ * Known sources of hitches post stutter events, frames over the stutter threshold are recorded with the events that landed in them.
+ *
+ * Usage:
+ * void Feature::Prepass()
+ * {
+ *     PROFILE_CPU_SCOPE("Feature::Prepass");
+ *     ...
+ * }
+ */
+class Profiler
+{
+public:
+	static Profiler* GetSingleton()
+	{
+		static Profiler singleton;
+		return &singleton;
+	}
+
+	using ScopeId = uint32_t;
+
+	static constexpr uint32_t MaxScopes = 256;
+	static constexpr uint32_t HistoryFrames = 256;
+	static constexpr uint32_t RingSize = 4096;
+	static constexpr uint32_t GPUFrameLatency = GPUTimer::FrameLatency;
+	static constexpr uint32_t MaxGPUScopesPerFrame = GPUTimer::MaxScopesPerFrame;
+	static constexpr uint32_t JournalSize = 1024;
+	static constexpr uint32_t MaxStutters = 64;
+	static constexpr float UnrecordedGPUTime = GPUTimer::Unrecorded;
+
+	enum class StutterCause : uint32_t
+	{
+		ShaderCompile,
+		DiskCacheLoad,
+		HeightmapLoad,
+		ComputeShaderCompile,
+		SettingsSave,
+		SkylightingCache,
+		CubemapCache,
+		Count
+	};
+
+	static int64_t Now()
+	{
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		return counter.QuadPart;
+	}
+
+	class CPUScope
+	{
+	public:
+		explicit CPUScope(ScopeId a_id) :
+			id(a_id), start(Now())
+		{}
+
+		~CPUScope() { Profiler::GetSingleton()->Record(id, start, Now()); }
+
+		CPUScope(const CPUScope&) = delete;
+		CPUScope& operator=(const CPUScope&) = delete;
+
+	private:
+		ScopeId id;
+		int64_t start;
+	};
+
+	class GPUScope
+	{
+	public:
+		explicit GPUScope(ScopeId a_id) :
+			slot(Profiler::GetSingleton()->BeginGPU(a_id))
+		{}
+
+		~GPUScope() { Profiler::GetSingleton()->EndGPU(slot); }
+
+		GPUScope(const GPUScope&) = delete;
+		GPUScope& operator=(const GPUScope&) = delete;
+
+	private:
+		uint32_t slot;
+	};
+
+	// Times a blocking operation and posts it to the stutter journal, events may nest
+	class StutterScope
+	{
+	public:
+		explicit StutterScope(StutterCause a_cause) :
+			cause(a_cause), start(Now())
+		{}
+
+		~StutterScope() { Profiler::GetSingleton()->PostStutterEvent(cause, start, Now()); }
+
+		StutterScope(const StutterScope&) = delete;
+		StutterScope& operator=(const StutterScope&) = delete;
+
+	private:
+		StutterCause cause;
+		int64_t start;
+	};
+
+	/**
+	 * Returns the id of the scope with this name, registering it on first use.
+	 * Takes a lock, callers are expected to keep the id around.
+	 */
+	ScopeId RegisterScope(std::string_view a_name);
+
+	void Record(ScopeId a_id, int64_t a_start, int64_t a_end);
+
+	// Any thread, lock-free
+	void PostStutterEvent(StutterCause a_cause, int64_t a_start, int64_t a_end);
+
+	// Render thread only, returns UINT32_MAX when no query is available this frame
+	uint32_t BeginGPU(ScopeId a_id);
+	void EndGPU(uint32_t a_slot);
+
+	/**
+	 * Drains the thread rings and closes the statistics of the current frame.
+	 * Called once per frame from present.
+	 */
+	void EndFrame();
+
+	struct ScopeSummary
+	{
+		std::string name;
+		float average = 0.0f;
+		float p95 = 0.0f;
+		float max = 0.0f;
+		float last = 0.0f;
+		float calls = 0.0f;
+		bool hasGPU = false;
+		float gpuAverage = 0.0f;
+		float gpuP95 = 0.0f;
+		float gpuLast = 0.0f;
+	};
+
+	std::vector<ScopeSummary> GetSummaries();
+
+	/**
+	 * Milliseconds spent in a scope during the last completed frame, 0 if unknown.
+	 */
+	float GetLastFrameTime(ScopeId a_id);
+
+	/**
+	 * GPU milliseconds of a scope in the most recently resolved frame, 0 if unknown or the scope did not run in it.
+	 */
+	float GetLastGPUFrameTime(ScopeId a_id);
+
+	/**
+	 * Milliseconds between the last two calls to EndFrame, 0 before the second frame.
+	 */
+	float GetFrameTime() const { return frameTime; }
+
+	void DrawSettings();
+	void DrawOverlay();
+
+	bool ExportCSV(const std::string& a_path);
+	bool ExportJSON(const std::string& a_path);
+
+	struct Settings
+	{
+		bool ShowOverlay = false;
+		float StutterThreshold = 50.0f;
+	};
+
+	Settings settings;
+
+	void SaveSettings(json& o_json);
+	void LoadSettings(json& o_json);
+
+private:
+	Profiler();
+
+	struct Event
+	{
+		ScopeId id;
+		int64_t start;
+		int64_t end;
+	};
+
+	// Single producer (the owning thread), single consumer (EndFrame)
+	using ThreadRing = EventRing<Event, RingSize>;
+
+	struct Scope
+	{
+		std::string name;
+		std::array<float, HistoryFrames> history{};
+		std::array<uint32_t, HistoryFrames> callHistory{};
+		std::array<float, HistoryFrames> gpuHistory{};  // NaN where the scope has no timestamps: not issued, disjoint or never resolved
+		int64_t frameTicks = 0;
+		uint32_t frameCalls = 0;
+		bool hasGPU = false;
+	};
+
+	struct StutterEvent
+	{
+		StutterCause cause = StutterCause::Count;
+		uint32_t frameThread = false;
+		int64_t ticks = 0;
+	};
+
+	struct Stutter
+	{
+		uint64_t frame = 0;
+		float frameTime = 0.0f;
+		std::array<float, (size_t)StutterCause::Count> causeTime{};
+		std::array<uint32_t, (size_t)StutterCause::Count> causeCount{};
+		float backgroundTime = 0.0f;
+	};
+
+	ThreadRing* GetThreadRing();
+
+	void DrainJournal();
+	void DrawStutters(uint32_t a_count);
+
+	void AdvanceGPUFrame();
+
+	std::mutex ringsMutex;
+	std::vector<std::unique_ptr<ThreadRing>> rings;
+
+	std::mutex scopesMutex;
+	std::array<Scope, MaxScopes> scopes;
+	uint32_t scopeCount = 0;
+	ankerl::unordered_dense::map<std::string, ScopeId> scopeIds;
+
+	uint32_t historyIndex = 0;
+	uint32_t historyCount = 0;
+	uint32_t droppedEvents = 0;
+	double ticksToMs = 0.0;
+	int64_t lastFrameEnd = 0;
+	float frameTime = 0.0f;
+
+	std::unique_ptr<GPUTimer> gpuTimer;  // created with the first frame that has a device
+
+	EventJournal<StutterEvent, JournalSize> journal;  // multiple producers, single consumer (EndFrame)
+	std::atomic<uint32_t> frameThreadId = 0;
+	Stutter pendingStutter;
+	std::array<Stutter, MaxStutters> stutters;
+	uint32_t stutterIndex = 0;
+	uint32_t stutterCount = 0;
+	uint64_t frameNumber = 0;
+};
+
+#define PROFILE_CPU_SCOPE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CPU_SCOPE_CONCAT(a, b) PROFILE_CPU_SCOPE_CONCAT_IMPL(a, b)
+#define PROFILE_GPU_SCOPE(a_name)                                                                                                            \
+	static const Profiler::ScopeId PROFILE_CPU_SCOPE_CONCAT(profilerGPUScopeId, __LINE__) = Profiler::GetSingleton()->RegisterScope(a_name); \
+	Profiler::GPUScope PROFILE_CPU_SCOPE_CONCAT(profilerGPUScope, __LINE__)(PROFILE_CPU_SCOPE_CONCAT(profilerGPUScopeId, __LINE__))
+#define PROFILE_CPU_SCOPE(a_name)                                                                                                         \
+	static const Profiler::ScopeId PROFILE_CPU_SCOPE_CONCAT(profilerScopeId, __LINE__) = Profiler::GetSingleton()->RegisterScope(a_name); \
+	Profiler::CPUScope PROFILE_CPU_SCOPE_CONCAT(profilerScope, __LINE__)(PROFILE_CPU_SCOPE_CONCAT(profilerScopeId, __LINE__))
@@ -9,6 +9,7 @@
 
 #include "Deferred.h"
 #include "Feature.h"
+#include "Profiler.h"
 #include "State.h"
 
 #include "Features/DynamicCubemaps.h"
@@ -1258,6 +1259,12 @@ namespace SIE
 			return type;
 		}
 
+		static HRESULT ReadDiskCache(const std::wstring& a_path, ID3DBlob** a_blob)
+		{
+			Profiler::StutterScope stutter(Profiler::StutterCause::DiskCacheLoad);
+			return D3DReadFileToBlob(a_path.c_str(), a_blob);
+		}
+
 		static ID3DBlob* CompileShader(ShaderClass shaderClass, const RE::BSShader& shader, uint32_t descriptor, bool useDiskCache)
 		{
 			// check hashmap
@@ -1266,7 +1273,7 @@ namespace SIE
 
 			if (shaderBlob) {
 				// already compiled before
-				logger::debug("Shader already compiled; using cache: {}", SShaderCache::GetShaderString(shaderClass, shader, descriptor));
+				LOG_DEBUG("Shader already compiled; using cache: {}", SShaderCache::GetShaderString(shaderClass, shader, descriptor));
 				cache.IncCacheHitTasks();
 				return shaderBlob;
 			}
@@ -1279,8 +1286,8 @@ namespace SIE
 				// check build time of cache
 				auto diskCacheTime = cache.UseFileWatcher() ? std::chrono::clock_cast<std::chrono::system_clock>(std::filesystem::last_write_time(diskPath)) : system_clock::now();
 				if (cache.ShaderModifiedSince(shader.fxpFilename, diskCacheTime)) {
-					logger::debug("Diskcached shader {} older than {}", SIE::SShaderCache::GetShaderString(shaderClass, shader, descriptor, true), std::format("{:%Y%m%d%H%M}", diskCacheTime));
-				} else if (FAILED(D3DReadFileToBlob(diskPath.c_str(), &shaderBlob))) {
+					LOG_DEBUG("Diskcached shader {} older than {}", SIE::SShaderCache::GetShaderString(shaderClass, shader, descriptor, true), std::format("{:%Y%m%d%H%M}", diskCacheTime));
+				} else if (FAILED(ReadDiskCache(diskPath, &shaderBlob))) {
 					logger::error("Failed to load {} shader {}::{:X}", magic_enum::enum_name(shaderClass), magic_enum::enum_name(type), descriptor);
 
 					if (shaderBlob != nullptr) {
@@ -1326,7 +1333,7 @@ namespace SIE
 				logger::error("Failed to compile {} shader {}::{:X}: {} does not exist", magic_enum::enum_name(shaderClass), magic_enum::enum_name(type), descriptor, pathString);
 				return nullptr;
 			}
-			logger::debug("Compiling {} {}:{}:{:X} to {}", pathString, magic_enum::enum_name(type), magic_enum::enum_name(shaderClass), descriptor, MergeDefinesString(defines));
+			LOG_DEBUG("Compiling {} {}:{}:{:X} to {}", pathString, magic_enum::enum_name(type), magic_enum::enum_name(shaderClass), descriptor, MergeDefinesString(defines));
 
 			// compile shaders
 			ID3DBlob* errorBlob = nullptr;
@@ -1706,6 +1713,7 @@ namespace SIE
 		if (IsAsync()) {
 			compilationSet.Add({ ShaderClass::Vertex, shader, descriptor });
 		} else {
+			Profiler::StutterScope stutter(Profiler::StutterCause::ShaderCompile);
 			return MakeAndAddVertexShader(shader, descriptor);
 		}
 
@@ -1752,6 +1760,7 @@ namespace SIE
 		if (IsAsync()) {
 			compilationSet.Add({ ShaderClass::Pixel, shader, descriptor });
 		} else {
+			Profiler::StutterScope stutter(Profiler::StutterCause::ShaderCompile);
 			return MakeAndAddPixelShader(shader, descriptor);
 		}
 
@@ -1794,6 +1803,7 @@ namespace SIE
 		if (IsAsync()) {
 			compilationSet.Add({ ShaderClass::Compute, shader, descriptor });
 		} else {
+			Profiler::StutterScope stutter(Profiler::StutterCause::ShaderCompile);
 			return MakeAndAddComputeShader(shader, descriptor);
 		}
 
@@ -1850,6 +1860,7 @@ namespace SIE
 			hlslToShaderMap.clear();
 		}
 		compilationSet.Clear();
+		generation++;
 		Deferred::GetSingleton()->ClearShaderCache();
 		for (auto* feature : Feature::GetFeatureList()) {
 			if (feature->loaded) {
@@ -1941,6 +1952,7 @@ namespace SIE
 		if (!entries.empty()) {
 			logger::debug("Marked {} entries for recompile due to change to {}", entries.size(), a_path);
 			compilationSet.Clear();
+			generation++;
 		}
 
 		return true;
@@ -1949,6 +1961,7 @@ namespace SIE
 	void ShaderCache::Clear(RE::BSShader::Type a_type)
 	{
 		logger::debug("Clearing cache for {}", magic_enum::enum_name(a_type));
+		generation++;
 		std::lock_guard lockGuardV(vertexShadersMutex);
 		{
 			for (auto& [id, shader] : vertexShaders[static_cast<size_t>(a_type)]) {
@@ -1977,9 +1990,8 @@ namespace SIE
 	bool ShaderCache::AddCompletedShader(ShaderClass shaderClass, const RE::BSShader& shader, uint32_t descriptor, ID3DBlob* a_blob)
 	{
 		auto key = SIE::SShaderCache::GetShaderString(shaderClass, shader, descriptor, true);
-		auto keyWithDescriptor = SIE::SShaderCache::GetShaderString(shaderClass, shader, descriptor, false);
 		auto status = a_blob ? ShaderCompilationTask::Status::Completed : ShaderCompilationTask::Status::Failed;
-		logger::debug("Adding {} shader to map: {}", magic_enum ::enum_name(status), keyWithDescriptor);
+		LOG_DEBUG("Adding {} shader to map: {}", magic_enum::enum_name(status), SIE::SShaderCache::GetShaderString(shaderClass, shader, descriptor, false));
 		{
 			std::unique_lock lockM{ mapMutex };
 			shaderMap.insert_or_assign(key, ShaderCacheResult{ a_blob, status, system_clock::now() });
@@ -2095,6 +2107,7 @@ namespace SIE
 	void ShaderCache::SetEnabled(bool value)
 	{
 		isEnabled = value;
+		generation++;
 	}
 
 	bool ShaderCache::IsAsync() const
@@ -2296,6 +2309,7 @@ namespace SIE
 					newShader->shader->Release();
 				}
 			} else {
+				generation++;
 				return vertexShaders[static_cast<size_t>(shader.shaderType.get())]
 				    .insert_or_assign(descriptor, std::move(newShader))
 				    .first->second.get();
@@ -2325,6 +2339,7 @@ namespace SIE
 					newShader->shader->Release();
 				}
 			} else {
+				generation++;
 				return pixelShaders[static_cast<size_t>(shader.shaderType.get())]
 				    .insert_or_assign(descriptor, std::move(newShader))
 				    .first->second.get();
@@ -2443,6 +2458,7 @@ namespace SIE
 				blockedKey = key;
 				blockedKeyIndex = (uint)targetIndex;
 				blockedIDs.clear();
+				generation++;
 				logger::debug("Blocking shader ({}/{}) {}", blockedKeyIndex + 1, shaderMap.size(), blockedKey);
 				return;
 			}
@@ -2454,6 +2470,7 @@ namespace SIE
 		blockedKey = "";
 		blockedKeyIndex = (uint)-1;
 		blockedIDs.clear();
+		generation++;
 		logger::debug("Stopped blocking shaders");
 	}
 
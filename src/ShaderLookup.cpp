@@ -0,0 +1,102 @@
+#include "ShaderLookup.h"
+
+namespace SIE::ShaderLookup
+{
+	struct Masks
+	{
+		uint32_t vertexClear = 0;
+		uint32_t pixelClear = 0;
+		uint32_t pixelDeferred = 0;
+	};
+
+	struct Tables
+	{
+		std::array<Masks, (size_t)Kind::Total> masks{};
+		std::array<bool, 64> clearLightingVertexTechnique{};
+		std::array<bool, 64> clearLightingPixelTechnique{};
+	};
+
+	static Tables BuildTables()
+	{
+		using LightingFlags = ShaderDescriptors::LightingShaderFlags;
+		using LightingTechniques = ShaderDescriptors::LightingShaderTechniques;
+
+		Tables tables;
+
+		auto& lighting = tables.masks[(size_t)Kind::Lighting];
+		lighting.vertexClear = (uint32_t)LightingFlags::AdditionalAlphaMask |
+		                       (uint32_t)LightingFlags::AmbientSpecular |
+		                       (uint32_t)LightingFlags::DoAlphaTest |
+		                       (uint32_t)LightingFlags::ShadowDir |
+		                       (uint32_t)LightingFlags::DefShadow |
+		                       (uint32_t)LightingFlags::CharacterLight |
+		                       (uint32_t)LightingFlags::RimLighting |
+		                       (uint32_t)LightingFlags::SoftLighting |
+		                       (uint32_t)LightingFlags::BackLighting |
+		                       (uint32_t)LightingFlags::Specular |
+		                       (uint32_t)LightingFlags::AnisoLighting |
+		                       (uint32_t)LightingFlags::BaseObjectIsSnow |
+		                       (uint32_t)LightingFlags::Snow |
+		                       (uint32_t)LightingFlags::TruePbr;
+		lighting.pixelClear = (uint32_t)LightingFlags::AmbientSpecular |
+		                      (uint32_t)LightingFlags::ShadowDir |
+		                      (uint32_t)LightingFlags::DefShadow |
+		                      (uint32_t)LightingFlags::CharacterLight |
+		                      (uint32_t)LightingFlags::BaseObjectIsSnow;
+		lighting.pixelDeferred = (uint32_t)LightingFlags::Deferred;
+
+		for (auto technique : { LightingTechniques::Glowmap, LightingTechniques::Parallax, LightingTechniques::Facegen, LightingTechniques::FacegenRGBTint,
+				 LightingTechniques::LODObjects, LightingTechniques::LODObjectHD, LightingTechniques::MultiIndexSparkle, LightingTechniques::Hair })
+			tables.clearLightingVertexTechnique[(uint32_t)technique] = true;
+		tables.clearLightingPixelTechnique[(uint32_t)LightingTechniques::Glowmap] = true;
+
+		auto& water = tables.masks[(size_t)Kind::Water];
+		water.vertexClear = water.pixelClear = (uint32_t)ShaderDescriptors::WaterShaderFlags::Reflections |
+		                                       (uint32_t)ShaderDescriptors::WaterShaderFlags::Cubemap |
+		                                       (uint32_t)ShaderDescriptors::WaterShaderFlags::Interior;
+
+		auto& effect = tables.masks[(size_t)Kind::Effect];
+		effect.vertexClear = effect.pixelClear = (uint32_t)ShaderDescriptors::EffectShaderFlags::GrayscaleToColor |
+		                                         (uint32_t)ShaderDescriptors::EffectShaderFlags::GrayscaleToAlpha |
+		                                         (uint32_t)ShaderDescriptors::EffectShaderFlags::IgnoreTexAlpha;
+		effect.pixelDeferred = (uint32_t)ShaderDescriptors::EffectShaderFlags::Deferred;
+
+		tables.masks[(size_t)Kind::DistantTree].pixelDeferred = (uint32_t)ShaderDescriptors::DistantTreeShaderFlags::Deferred;
+		tables.masks[(size_t)Kind::Sky].pixelDeferred = 256;
+
+		return tables;
+	}
+
+	void Canonicalize(Kind a_kind, uint32_t& a_vertexDescriptor, uint32_t& a_pixelDescriptor, bool a_improvedSnow, bool a_deferred)
+	{
+		static const auto tables = BuildTables();
+
+		const auto& masks = tables.masks[(size_t)a_kind];
+		a_vertexDescriptor &= ~masks.vertexClear;
+		a_pixelDescriptor &= ~masks.pixelClear;
+
+		if (a_kind == Kind::Lighting) {
+			using LightingFlags = ShaderDescriptors::LightingShaderFlags;
+
+			if (a_pixelDescriptor & (uint32_t)LightingFlags::AdditionalAlphaMask) {
+				a_pixelDescriptor |= (uint32_t)LightingFlags::DoAlphaTest;
+				a_pixelDescriptor &= ~(uint32_t)LightingFlags::AdditionalAlphaMask;
+			}
+
+			if (!a_improvedSnow)
+				a_pixelDescriptor &= ~((uint32_t)LightingFlags::Snow);
+
+			if (tables.clearLightingVertexTechnique[0x3F & (a_vertexDescriptor >> 24)])
+				a_vertexDescriptor &= ~(0x3F << 24);
+
+			if (tables.clearLightingPixelTechnique[0x3F & (a_pixelDescriptor >> 24)])
+				a_pixelDescriptor &= ~(0x3F << 24);
+		} else if (a_kind == Kind::Grass) {
+			if ((a_vertexDescriptor & 0xF) == static_cast<uint32_t>(ShaderDescriptors::GrassShaderTechniques::TruePbr))
+				a_vertexDescriptor &= ~0xF;
+		}
+
+		if (a_deferred)
+			a_pixelDescriptor |= masks.pixelDeferred;
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ShaderDescriptors.h"
+
+/**
+ * Canonical descriptors of the shader cache lookups, without the bits that do not change the compiled shader.
+ * The bits to clear are folded into per-kind tables once instead of being assembled on every draw.
+ */
+namespace SIE::ShaderLookup
+{
+	// Shader types with rules of their own, every other type is looked up as is
+	enum class Kind : uint8_t
+	{
+		Other,
+		Lighting,
+		Water,
+		Effect,
+		DistantTree,
+		Sky,
+		Grass,
+		Total
+	};
+
+	/**
+	 * Canonicalizes both descriptors of a lookup in place.
+	 * a_improvedSnow keeps the snow permutation of lighting shaders, a_deferred selects the deferred permutation.
+	 */
+	void Canonicalize(Kind a_kind, uint32_t& a_vertexDescriptor, uint32_t& a_pixelDescriptor, bool a_improvedSnow, bool a_deferred);
+}
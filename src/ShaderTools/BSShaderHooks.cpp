@@ -1,5 +1,7 @@
 #include "BSShaderHooks.h"
 
+#include "Utils/FileSystem.h"
+
 namespace BSShaderHooks
 {
 	void hk_LoadShaders(REX::BSShader* bsShader, std::uintptr_t)
@@ -16,7 +18,8 @@ namespace BSShaderHooks
 				std::size_t successCount = 0;
 				std::size_t failedCount = 0;
 
-				for (const auto& entry : std::filesystem::directory_iterator(shaderDir)) {
+				for (const auto& manifestEntry : Util::AssetManifest::GetSingleton()->List(shaderDir)) {
+					const std::filesystem::directory_entry entry{ shaderDir / manifestEntry.name };
 					if (entry.path().extension().generic_string() != ".hlsl"sv)
 						continue;
 
@@ -53,7 +56,8 @@ namespace BSShaderHooks
 			std::size_t successCount = 0;
 			std::size_t failedCount = 0;
 
-			for (const auto& entry : std::filesystem::directory_iterator(shaderDir)) {
+			for (const auto& manifestEntry : Util::AssetManifest::GetSingleton()->List(shaderDir)) {
+				const std::filesystem::directory_entry entry{ shaderDir / manifestEntry.name };
 				std::string fileStr = entry.path().filename().generic_string();
 
 				std::string techniqueIDStr;
@@ -7,6 +7,7 @@
 
 #include "Menu.h"
 #include "ShaderCache.h"
+#include "ShaderLookup.h"
 
 #include "Feature.h"
 #include "Util.h"
@@ -15,6 +16,8 @@
 #include "Features/TerrainBlending.h"
 #include "TruePBR.h"
 
+#include "FrameBudget.h"
+#include "Profiler.h"
 #include "Streamline.h"
 #include "Upscaling.h"
 
@@ -76,8 +79,12 @@ void State::Draw()
 					currentPixelDescriptor &= ~modifiedPixelDescriptor;
 
 					if (IsDeveloperMode()) {
-						BeginPerfEvent(std::format("Draw: CS {}::{:x}::{}", magic_enum::enum_name(currentShader->shaderType.get()), currentPixelDescriptor, currentShader->fxpFilename));
-						SetPerfMarker(std::format("Defines: {}", SIE::ShaderCache::GetDefinesString(*currentShader, currentPixelDescriptor)));
+						BeginPerfEvent(GetPerfEventKey(PerfEvent::Draw, type, currentPixelDescriptor, currentShader->fxpFilename), [&] {
+							return std::format("Draw: CS {}::{:x}::{}", magic_enum::enum_name(type), currentPixelDescriptor, currentShader->fxpFilename);
+						});
+						SetPerfMarker(GetPerfEventKey(PerfEvent::DrawDefines, currentShader, currentPixelDescriptor), [&] {
+							return std::format("Defines: {}", SIE::ShaderCache::GetDefinesString(*currentShader, currentPixelDescriptor));
+						});
 						EndPerfEvent();
 					}
 				}
@@ -274,6 +281,26 @@ void State::Load(ConfigMode a_configMode, bool a_allowReload)
 			logger::warn("Missing settings for Upscaling, using default.");
 		}
 
+		auto& frameBudgetJson = settings["Frame Budget"];
+		if (frameBudgetJson.is_object()) {
+			try {
+				FrameBudget::GetSingleton()->LoadSettings(frameBudgetJson);
+			} catch (...) {
+				logger::warn("Invalid settings for Frame Budget, using default.");
+				FrameBudget::GetSingleton()->settings = {};
+			}
+		}
+
+		auto& profilerJson = settings["Profiler"];
+		if (profilerJson.is_object()) {
+			try {
+				Profiler::GetSingleton()->LoadSettings(profilerJson);
+			} catch (...) {
+				logger::warn("Invalid settings for Profiler, using default.");
+				Profiler::GetSingleton()->settings = {};
+			}
+		}
+
 		for (auto* feature : Feature::GetFeatureList()) {
 			try {
 				const std::string featureName = feature->GetShortName();
@@ -312,6 +339,8 @@ void State::Load(ConfigMode a_configMode, bool a_allowReload)
 
 void State::Save(ConfigMode a_configMode)
 {
+	Profiler::StutterScope stutter(Profiler::StutterCause::SettingsSave);
+
 	const auto& shaderCache = SIE::ShaderCache::Instance();
 	std::string configPath = GetConfigPath(a_configMode);
 	std::ofstream o{ configPath };
@@ -354,6 +383,9 @@ void State::Save(ConfigMode a_configMode)
 	auto& upscalingJson = settings[upscaling->GetShortName()];
 	upscaling->SaveSettings(upscalingJson);
 
+	FrameBudget::GetSingleton()->SaveSettings(settings["Frame Budget"]);
+	Profiler::GetSingleton()->SaveSettings(settings["Profiler"]);
+
 	json originalShaders;
 	for (int classIndex = 0; classIndex < RE::BSShader::Type::Total - 1; ++classIndex) {
 		originalShaders[magic_enum::enum_name((RE::BSShader::Type)(classIndex + 1))] = enabledClasses[classIndex];
@@ -480,9 +512,7 @@ void State::SetupResources()
 	permutationCB = new ConstantBuffer(ConstantBufferDesc<PermutationCB>());
 	sharedDataCB = new ConstantBuffer(ConstantBufferDesc<SharedDataCB>());
 
-	auto [data, size] = GetFeatureBufferData();
-	featureDataCB = new ConstantBuffer(ConstantBufferDesc((uint32_t)size));
-	delete[] data;
+	featureDataCB = new ConstantBuffer(ConstantBufferDesc((uint32_t)GetFeatureBufferData().size()));
 
 	// Grab main texture to get resolution
 	// VR cannot use viewport->screenWidth/Height as it's the desktop preview window's resolution and not HMD
@@ -500,116 +530,40 @@ void State::SetupResources()
 	tracyCtx = TracyD3D11Context(device, context);
 }
 
+// Shader types with lookup rules of their own, Utility and ImageSpace are looked up as is
+static std::array<SIE::ShaderLookup::Kind, RE::BSShader::Type::Total> BuildShaderLookupKinds()
+{
+	using Kind = SIE::ShaderLookup::Kind;
+
+	std::array<Kind, RE::BSShader::Type::Total> kinds;
+	kinds.fill(Kind::Other);
+	kinds[RE::BSShader::Type::Lighting] = Kind::Lighting;
+	kinds[RE::BSShader::Type::Water] = Kind::Water;
+	kinds[RE::BSShader::Type::Effect] = Kind::Effect;
+	kinds[RE::BSShader::Type::DistantTree] = Kind::DistantTree;
+	kinds[RE::BSShader::Type::Sky] = Kind::Sky;
+	kinds[RE::BSShader::Type::Grass] = Kind::Grass;
+	return kinds;
+}
+
 void State::ModifyShaderLookup(const RE::BSShader& a_shader, uint& a_vertexDescriptor, uint& a_pixelDescriptor, bool a_forceDeferred)
 {
-	if (a_shader.shaderType.get() != RE::BSShader::Type::Utility && a_shader.shaderType.get() != RE::BSShader::Type::ImageSpace) {
-		switch (a_shader.shaderType.get()) {
-		case RE::BSShader::Type::Lighting:
-			{
-				a_vertexDescriptor &= ~((uint32_t)SIE::ShaderCache::LightingShaderFlags::AdditionalAlphaMask |
-										(uint32_t)SIE::ShaderCache::LightingShaderFlags::AmbientSpecular |
-										(uint32_t)SIE::ShaderCache::LightingShaderFlags::DoAlphaTest |
-										(uint32_t)SIE::ShaderCache::LightingShaderFlags::ShadowDir |
-										(uint32_t)SIE::ShaderCache::LightingShaderFlags::DefShadow |
-										(uint32_t)SIE::ShaderCache::LightingShaderFlags::CharacterLight |
-										(uint32_t)SIE::ShaderCache::LightingShaderFlags::RimLighting |
-										(uint32_t)SIE::ShaderCache::LightingShaderFlags::SoftLighting |
-										(uint32_t)SIE::ShaderCache::LightingShaderFlags::BackLighting |
-										(uint32_t)SIE::ShaderCache::LightingShaderFlags::Specular |
-										(uint32_t)SIE::ShaderCache::LightingShaderFlags::AnisoLighting |
-										(uint32_t)SIE::ShaderCache::LightingShaderFlags::BaseObjectIsSnow |
-										(uint32_t)SIE::ShaderCache::LightingShaderFlags::Snow |
-										(uint32_t)SIE::ShaderCache::LightingShaderFlags::TruePbr);
-
-				a_pixelDescriptor &= ~((uint32_t)SIE::ShaderCache::LightingShaderFlags::AmbientSpecular |
-									   (uint32_t)SIE::ShaderCache::LightingShaderFlags::ShadowDir |
-									   (uint32_t)SIE::ShaderCache::LightingShaderFlags::DefShadow |
-									   (uint32_t)SIE::ShaderCache::LightingShaderFlags::CharacterLight |
-									   (uint32_t)SIE::ShaderCache::LightingShaderFlags::BaseObjectIsSnow);
-				if (a_pixelDescriptor & (uint32_t)SIE::ShaderCache::LightingShaderFlags::AdditionalAlphaMask) {
-					a_pixelDescriptor |= (uint32_t)SIE::ShaderCache::LightingShaderFlags::DoAlphaTest;
-					a_pixelDescriptor &= ~(uint32_t)SIE::ShaderCache::LightingShaderFlags::AdditionalAlphaMask;
-				}
+	static const auto kinds = BuildShaderLookupKinds();
+	static auto enableImprovedSnow = RE::GetINISetting("bEnableImprovedSnow:Display");
+	static bool vr = REL::Module::IsVR();
 
-				static auto enableImprovedSnow = RE::GetINISetting("bEnableImprovedSnow:Display");
-				static bool vr = REL::Module::IsVR();
-
-				if (vr || !enableImprovedSnow->GetBool())
-					a_pixelDescriptor &= ~((uint32_t)SIE::ShaderCache::LightingShaderFlags::Snow);
-
-				if (Deferred::GetSingleton()->deferredPass || a_forceDeferred)
-					a_pixelDescriptor |= (uint32_t)SIE::ShaderCache::LightingShaderFlags::Deferred;
-
-				{
-					uint32_t technique = 0x3F & (a_vertexDescriptor >> 24);
-					if (technique == (uint32_t)SIE::ShaderCache::LightingShaderTechniques::Glowmap ||
-						technique == (uint32_t)SIE::ShaderCache::LightingShaderTechniques::Parallax ||
-						technique == (uint32_t)SIE::ShaderCache::LightingShaderTechniques::Facegen ||
-						technique == (uint32_t)SIE::ShaderCache::LightingShaderTechniques::FacegenRGBTint ||
-						technique == (uint32_t)SIE::ShaderCache::LightingShaderTechniques::LODObjects ||
-						technique == (uint32_t)SIE::ShaderCache::LightingShaderTechniques::LODObjectHD ||
-						technique == (uint32_t)SIE::ShaderCache::LightingShaderTechniques::MultiIndexSparkle ||
-						technique == (uint32_t)SIE::ShaderCache::LightingShaderTechniques::Hair)
-						a_vertexDescriptor &= ~(0x3F << 24);
-				}
+	auto type = a_shader.shaderType.get();
+	if (type >= RE::BSShader::Type::Total || kinds[type] == SIE::ShaderLookup::Kind::Other)
+		return;
 
-				{
-					uint32_t technique = 0x3F & (a_pixelDescriptor >> 24);
-					if (technique == (uint32_t)SIE::ShaderCache::LightingShaderTechniques::Glowmap)
-						a_pixelDescriptor &= ~(0x3F << 24);
-				}
-			}
-			break;
-		case RE::BSShader::Type::Water:
-			{
-				auto flags = ~((uint32_t)SIE::ShaderCache::WaterShaderFlags::Reflections |
-							   (uint32_t)SIE::ShaderCache::WaterShaderFlags::Cubemap |
-							   (uint32_t)SIE::ShaderCache::WaterShaderFlags::Interior);
-				a_vertexDescriptor &= flags;
-				a_pixelDescriptor &= flags;
-			}
-			break;
-		case RE::BSShader::Type::Effect:
-			{
-				auto flags = ~((uint32_t)SIE::ShaderCache::EffectShaderFlags::GrayscaleToColor |
-							   (uint32_t)SIE::ShaderCache::EffectShaderFlags::GrayscaleToAlpha |
-							   (uint32_t)SIE::ShaderCache::EffectShaderFlags::IgnoreTexAlpha);
-				a_vertexDescriptor &= flags;
-				a_pixelDescriptor &= flags;
-
-				if (Deferred::GetSingleton()->deferredPass || a_forceDeferred)
-					a_pixelDescriptor |= (uint32_t)SIE::ShaderCache::EffectShaderFlags::Deferred;
-			}
-			break;
-		case RE::BSShader::Type::DistantTree:
-			{
-				if (Deferred::GetSingleton()->deferredPass || a_forceDeferred)
-					a_pixelDescriptor |= (uint32_t)SIE::ShaderCache::DistantTreeShaderFlags::Deferred;
-			}
-			break;
-		case RE::BSShader::Type::Sky:
-			{
-				if (Deferred::GetSingleton()->deferredPass || a_forceDeferred)
-					a_pixelDescriptor |= 256;
-			}
-			break;
-		case RE::BSShader::Type::Grass:
-			{
-				auto technique = a_vertexDescriptor & 0xF;
-				auto flags = a_vertexDescriptor & ~0xF;
-				if (technique == static_cast<uint32_t>(SIE::ShaderCache::GrassShaderTechniques::TruePbr)) {
-					technique = 0;
-				}
-				a_vertexDescriptor = flags | technique;
-			}
-			break;
-		}
-	}
+	SIE::ShaderLookup::Canonicalize(kinds[type], a_vertexDescriptor, a_pixelDescriptor,
+		!vr && enableImprovedSnow->GetBool(), Deferred::GetSingleton()->deferredPass || a_forceDeferred);
 }
 
 void State::BeginPerfEvent(std::string_view title)
 {
-	pPerf->BeginEvent(std::wstring(title.begin(), title.end()).c_str());
+	perfScratch.assign(title.begin(), title.end());
+	pPerf->BeginEvent(perfScratch.c_str());
 }
 
 void State::EndPerfEvent()
@@ -619,7 +573,8 @@ void State::EndPerfEvent()
 
 void State::SetPerfMarker(std::string_view title)
 {
-	pPerf->SetMarker(std::wstring(title.begin(), title.end()).c_str());
+	perfScratch.assign(title.begin(), title.end());
+	pPerf->SetMarker(perfScratch.c_str());
 }
 
 void State::SetAdapterDescription(const std::wstring& description)
@@ -661,12 +616,8 @@ void State::UpdateSharedData()
 		data.FrameCount = viewport->frameCount * (bTAA || State::GetSingleton()->upscalerLoaded);
 		data.FrameCountAlwaysActive = viewport->frameCount;
 
-		for (int i = -2; i <= 2; i++) {
-			for (int k = -2; k <= 2; k++) {
-				int waterTile = (i + 2) + ((k + 2) * 5);
-				data.WaterData[waterTile] = Util::TryGetWaterData((float)i * 4096.0f, (float)k * 4096.0f);
-			}
-		}
+		static_assert(ARRAYSIZE(data.WaterData) == Util::WaterCache::Size * Util::WaterCache::Size);
+		Util::WaterCache::GetSingleton()->Update(data.WaterData);
 
 		if (auto sky = RE::Sky::GetSingleton())
 			data.InInterior = sky->mode.get() != RE::Sky::Mode::kFull;
@@ -681,12 +632,9 @@ void State::UpdateSharedData()
 		sharedDataCB->Update(data);
 	}
 
-	{
-		auto [data, size] = GetFeatureBufferData();
-
-		featureDataCB->Update(data, size);
-
-		delete[] data;
+	if (UpdateFeatureBufferData()) {
+		auto data = GetFeatureBufferData();
+		featureDataCB->Update(data.data(), data.size());
 	}
 
 	const auto& depth = RE::BSGraphics::Renderer::GetSingleton()->GetDepthStencilData().depthStencils[RE::RENDER_TARGETS_DEPTHSTENCIL::kPOST_ZPREPASS_COPY];
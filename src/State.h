@@ -103,6 +103,58 @@ public:
 	void EndPerfEvent();
 	void SetPerfMarker(std::string_view title);
 
+	enum class PerfEvent : uint64_t
+	{
+		Draw,
+		DrawDefines,
+		SetupGeometry,
+		ImagespaceRender,
+		ImagespaceDispatch,
+		FinishAccumulatingDispatch,
+		RenderCubemap,
+		RenderBatches,
+		AccumulatorRenderBatches,
+		RenderPersistentPassList
+	};
+
+	// The event and the values its title is formatted from, unused values are zero
+	using PerfEventKey = std::array<uint64_t, 5>;
+
+	struct PerfEventKeyHash
+	{
+		using is_avalanching = void;
+
+		uint64_t operator()(const PerfEventKey& a_key) const noexcept
+		{
+			return ankerl::unordered_dense::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char*>(a_key.data()), sizeof(PerfEventKey)));
+		}
+	};
+
+	template <class... Args>
+	static PerfEventKey GetPerfEventKey(PerfEvent a_event, Args... a_args)
+	{
+		static_assert(sizeof...(Args) < std::tuple_size_v<PerfEventKey>, "Too many values for a perf event key");
+		return { (uint64_t)a_event, (uint64_t)a_args... };
+	}
+
+	/*
+	 * Perf annotations with a dynamic title, formatted once per key and then reused
+	 *
+	 * @param a_key Key from GetPerfEventKey identifying the title
+	 * @param a_title Callable returning the title, only invoked the first time a key is seen
+	 */
+	template <class F>
+	void BeginPerfEvent(const PerfEventKey& a_key, F&& a_title)
+	{
+		pPerf->BeginEvent(GetPerfString(a_key, a_title));
+	}
+
+	template <class F>
+	void SetPerfMarker(const PerfEventKey& a_key, F&& a_title)
+	{
+		pPerf->SetMarker(GetPerfString(a_key, a_title));
+	}
+
 	void SetAdapterDescription(const std::wstring& description);
 
 	bool extendedFrameAnnotations = false;
@@ -188,5 +240,23 @@ public:
 
 private:
 	std::shared_ptr<REX::W32::ID3DUserDefinedAnnotation> pPerf;
+
+	ankerl::unordered_dense::map<PerfEventKey, std::wstring, PerfEventKeyHash> perfStrings;
+	std::wstring perfScratch;
+
+	template <class F>
+	const wchar_t* GetPerfString(const PerfEventKey& a_key, F&& a_title)
+	{
+		auto it = perfStrings.find(a_key);
+		if (it == perfStrings.end()) {
+			// Geometry names make the key space open-ended, start over rather than grow forever
+			if (perfStrings.size() >= 65536)
+				perfStrings.clear();
+
+			const std::string title = a_title();
+			it = perfStrings.emplace(a_key, std::wstring(title.begin(), title.end())).first;
+		}
+		return it->second.c_str();
+	}
 	bool initialized = false;
 };
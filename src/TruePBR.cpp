@@ -44,7 +44,7 @@ namespace PNState
 	void ReadPBRRecordConfigs(const std::string& rootPath, std::function<void(const std::string&, const json&)> recordReader)
 	{
 		if (std::filesystem::exists(rootPath)) {
-			auto configs = clib_util::distribution::get_configs(rootPath, "", ".json");
+			auto configs = Util::AssetManifest::GetSingleton()->GetConfigs(rootPath, ".json");
 
 			if (configs.empty()) {
 				logger::warn("[TruePBR] no .json files were found within the {} folder, aborting...", rootPath);
@@ -532,22 +532,11 @@ struct ExtendedRendererState
 	static constexpr uint32_t NumPSTextures = 12;
 	static constexpr uint32_t FirstPSTexture = 80;
 
-	uint32_t PSResourceModifiedBits = 0;
-	std::array<ID3D11ShaderResourceView*, NumPSTextures> PSTexture;
+	Util::PSResourceRange<FirstPSTexture, NumPSTextures> PSTextures;
 
 	void SetPSTexture(size_t textureIndex, RE::BSGraphics::Texture* newTexture)
 	{
-		ID3D11ShaderResourceView* resourceView = newTexture ? newTexture->resourceView : nullptr;
-		//if (PSTexture[textureIndex] != resourceView)
-		{
-			PSTexture[textureIndex] = resourceView;
-			PSResourceModifiedBits |= (1 << textureIndex);
-		}
-	}
-
-	ExtendedRendererState()
-	{
-		std::fill(PSTexture.begin(), PSTexture.end(), nullptr);
+		PSTextures.Set((uint32_t)textureIndex, newTexture ? newTexture->resourceView : nullptr);
 	}
 } extendedRendererState;
 
@@ -1598,11 +1587,10 @@ void TruePBR::SetupDefaultPBRLandTextureSet()
 
 void TruePBR::SetShaderResouces()
 {
-	auto context = State::GetSingleton()->context;
-	for (uint32_t textureIndex = 0; textureIndex < ExtendedRendererState::NumPSTextures; ++textureIndex) {
-		if (extendedRendererState.PSResourceModifiedBits & (1 << textureIndex)) {
-			context->PSSetShaderResources(ExtendedRendererState::FirstPSTexture + textureIndex, 1, &extendedRendererState.PSTexture[textureIndex]);
-		}
-	}
-	extendedRendererState.PSResourceModifiedBits = 0;
+	// Rebind everything once per frame in case the slots were cleared outside of our tracking
+	static Util::FrameChecker frameChecker;
+	if (frameChecker.IsNewFrame())
+		extendedRendererState.PSTextures.Invalidate();
+
+	extendedRendererState.PSTextures.Flush(State::GetSingleton()->context);
 }
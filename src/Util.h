@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Utils/D3D.h"
+#include "Utils/FileSystem.h"
 #include "Utils/Format.h"
 #include "Utils/Game.h"
 #include "Utils/GameSetting.h"
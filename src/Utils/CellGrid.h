@@ -0,0 +1,64 @@
+#pragma once
+
+namespace Util
+{
+	/**
+	 * Per-cell data of the (2 * Radius + 1)^2 cells around the camera, kept in a toroidal grid so that crossing a
+	 * cell boundary only looks up the row or column of cells that scrolled in.
+	 * Space tells the cells of different worldspaces or interiors apart, every tile is looked up again when it changes.
+	 */
+	template <class T, class Space, int Radius>
+	class CellGrid
+	{
+	public:
+		static constexpr int Size = Radius * 2 + 1;
+
+		// Looks every tile up again on the next update, for when the cells themselves changed
+		void Invalidate() { invalidated = true; }
+
+		/**
+		 * Calls a_lookup(x, y) -> std::optional<T> for the cells not cached yet, then a_emit(index, const std::optional<T>&)
+		 * for every cell around a_cellX, a_cellY, row by row starting at the lowest x and y.
+		 */
+		template <class L, class E>
+		void Update(int a_cellX, int a_cellY, const Space& a_space, L&& a_lookup, E&& a_emit)
+		{
+			if (invalidated.exchange(false)) {
+				for (auto& tile : tiles)
+					tile.cached = false;
+			}
+
+			for (int k = -Radius; k <= Radius; k++) {
+				for (int i = -Radius; i <= Radius; i++) {
+					int x = a_cellX + i;
+					int y = a_cellY + k;
+
+					// Toroidal indexing, a tile only goes stale when the camera moves far enough for another cell to wrap onto it
+					auto& tile = tiles[((x % Size + Size) % Size) + ((y % Size + Size) % Size) * Size];
+					if (!tile.cached || tile.x != x || tile.y != y || !(tile.space == a_space)) {
+						tile.x = x;
+						tile.y = y;
+						tile.space = a_space;
+						tile.data = a_lookup(x, y);
+						tile.cached = true;
+					}
+
+					a_emit((i + Radius) + (k + Radius) * Size, tile.data);
+				}
+			}
+		}
+
+	private:
+		struct Tile
+		{
+			std::optional<T> data;
+			Space space{};
+			int x = 0;
+			int y = 0;
+			bool cached = false;
+		};
+
+		Tile tiles[Size * Size];
+		std::atomic<bool> invalidated = true;
+	};
+}
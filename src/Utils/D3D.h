@@ -8,5 +8,41 @@ namespace Util
 	std::string GetNameFromRTV(ID3D11RenderTargetView* a_rtv);
 	void SetResourceName(ID3D11DeviceChild* Resource, const char* Format, ...);
 
+	/**
+	 * Shadow copy of a contiguous range of pixel shader resource slots.
+	 * Set() only marks slots whose view actually changed, Flush() binds each run of dirty slots with a single call.
+	 * Invalidate() forces a full rebind, for when something outside may have touched the slots.
+	 */
+	template <uint32_t FirstSlot, uint32_t NumSlots>
+	class PSResourceRange
+	{
+	public:
+		static_assert(NumSlots <= 32);
+
+		void Set(uint32_t a_index, ID3D11ShaderResourceView* a_view)
+		{
+			if (views[a_index] != a_view) {
+				views[a_index] = a_view;
+				dirtyBits |= 1u << a_index;
+			}
+		}
+
+		void Invalidate() { dirtyBits = NumSlots == 32 ? UINT32_MAX : (1u << NumSlots) - 1; }
+
+		void Flush(ID3D11DeviceContext* a_context)
+		{
+			while (dirtyBits) {
+				uint32_t first = std::countr_zero(dirtyBits);
+				uint32_t count = std::countr_one(dirtyBits >> first);
+				a_context->PSSetShaderResources(FirstSlot + first, count, &views[first]);
+				dirtyBits &= count == 32 ? 0 : ~(((1u << count) - 1) << first);
+			}
+		}
+
+	private:
+		std::array<ID3D11ShaderResourceView*, NumSlots> views{};
+		uint32_t dirtyBits = 0;
+	};
+
 	ID3D11DeviceChild* CompileShader(const wchar_t* FilePath, const std::vector<std::pair<const char*, const char*>>& Defines, const char* ProgramType, const char* Program = "main");
 }  // namespace Util
@@ -0,0 +1,231 @@
+#include "FileSystem.h"
+
+namespace Util
+{
+	static constexpr uint32_t ManifestVersion = 3;
+
+	std::string FixFilePath(const std::string& a_path)
+	{
+		std::string lowerFilePath = a_path;
+
+		// Replace all backslashes with forward slashes
+		std::replace(lowerFilePath.begin(), lowerFilePath.end(), '\\', '/');
+
+		// Remove consecutive forward slashes
+		std::string::iterator newEnd = std::unique(lowerFilePath.begin(), lowerFilePath.end(),
+			[](char a, char b) { return a == '/' && b == '/'; });
+		lowerFilePath.erase(newEnd, lowerFilePath.end());
+
+		// Convert all characters to lowercase
+		std::transform(lowerFilePath.begin(), lowerFilePath.end(), lowerFilePath.begin(),
+			[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		return lowerFilePath;
+	}
+
+	void AssetManifest::Configure(std::filesystem::path a_path, std::string a_pluginVersion, bool a_reuseListings)
+	{
+		std::lock_guard lock(mutex);
+		path = std::move(a_path);
+		pluginVersion = std::move(a_pluginVersion);
+		reuseListings = a_reuseListings;
+		if (!reuseListings)
+			logger::info("Asset manifest: virtual file system detected, directories are enumerated on every start");
+	}
+
+	std::vector<AssetManifest::Entry> AssetManifest::List(const std::filesystem::path& a_dir)
+	{
+		std::lock_guard lock(mutex);
+		Load();
+
+		std::error_code ec;
+		auto writeTime = std::filesystem::last_write_time(a_dir, ec);
+		if (ec)
+			return {};
+
+		auto& directory = directories[FixFilePath(a_dir.string())];
+		int64_t time = writeTime.time_since_epoch().count();
+		if (reuseListings && directory.writeTime == time) {
+			hits++;
+			return directory.entries;
+		}
+
+		misses++;
+		dirty = true;
+		directory.writeTime = time;
+		Enumerate(a_dir, directory);
+		return directory.entries;
+	}
+
+	void AssetManifest::Enumerate(const std::filesystem::path& a_dir, Directory& a_directory)
+	{
+		std::error_code ec;
+		a_directory.enumerated = true;
+		a_directory.entries.clear();
+		for (const auto& dirEntry : std::filesystem::directory_iterator(a_dir, ec)) {
+			Entry entry{ dirEntry.path().filename().string(), dirEntry.is_directory(ec) };
+			if (!entry.isDirectory)
+				entry.size = dirEntry.file_size(ec);
+			entry.writeTime = dirEntry.last_write_time(ec).time_since_epoch().count();
+			a_directory.entries.push_back(std::move(entry));
+		}
+		std::ranges::sort(a_directory.entries, {}, &Entry::name);
+	}
+
+	std::vector<std::string> AssetManifest::GetConfigs(const std::filesystem::path& a_dir, std::string_view a_extension)
+	{
+		std::vector<std::string> configs;
+		for (const auto& entry : List(a_dir)) {
+			if (!entry.isDirectory && std::filesystem::path(entry.name).extension() == a_extension)
+				configs.push_back((a_dir / entry.name).string());
+		}
+		std::ranges::sort(configs);
+		return configs;
+	}
+
+	void AssetManifest::Load()
+	{
+		if (loaded)
+			return;
+		loaded = true;
+
+		if (!reuseListings)
+			return;
+
+		std::ifstream i{ path };
+		if (!i.is_open())
+			return;
+
+		try {
+			json manifest;
+			i >> manifest;
+			if (manifest["Version"] != ManifestVersion || manifest["PluginVersion"] != pluginVersion)
+				return;
+
+			loadOrderHash = manifest["LoadOrderHash"].get<uint64_t>();
+
+			for (auto& [key, value] : manifest["Directories"].items()) {
+				Directory directory;
+				directory.writeTime = value["WriteTime"].get<int64_t>();
+				for (auto& item : value["Entries"]) {
+					directory.entries.push_back({ item[0].get<std::string>(), item[1].get<bool>(), item[2].get<uint64_t>(), item[3].get<int64_t>() });
+				}
+				directories.insert_or_assign(key, std::move(directory));
+			}
+		} catch (const std::exception& e) {
+			logger::warn("Failed to read asset manifest, rebuilding it: {}", e.what());
+			directories.clear();
+			loadOrderHash = 0;
+		}
+	}
+
+	void AssetManifest::Clear()
+	{
+		std::lock_guard lock(mutex);
+		directories.clear();
+		dirty = false;
+
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+		logger::info("Asset manifest cleared, it will be rebuilt on the next start");
+	}
+
+	void AssetManifest::Save(uint64_t a_loadOrderHash)
+	{
+		std::lock_guard lock(mutex);
+		logger::info("Asset manifest: {} directories reused, {} enumerated", hits, misses);
+
+		if (!reuseListings)
+			return;
+
+		// The load order is only known once data is loaded, after most listings were read
+		if (a_loadOrderHash != loadOrderHash) {
+			for (auto& [key, directory] : directories) {
+				if (directory.enumerated)
+					continue;
+				auto entries = std::move(directory.entries);
+				Enumerate(key, directory);
+				if (directory.entries != entries)
+					logger::warn("Asset manifest: {} changed with the load order, restart the game to pick up its files", key);
+			}
+			loadOrderHash = a_loadOrderHash;
+			dirty = true;
+		}
+
+		if (!dirty)
+			return;
+
+		json manifest;
+		manifest["Version"] = ManifestVersion;
+		manifest["PluginVersion"] = pluginVersion;
+		manifest["LoadOrderHash"] = loadOrderHash;
+		json& directoriesJson = manifest["Directories"];
+		for (const auto& [key, directory] : directories) {
+			json& directoryJson = directoriesJson[key];
+			directoryJson["WriteTime"] = directory.writeTime;
+			directoryJson["Entries"] = json::array();
+			for (const auto& entry : directory.entries)
+				directoryJson["Entries"].push_back({ entry.name, entry.isDirectory, entry.size, entry.writeTime });
+		}
+
+		std::ofstream o{ path };
+		if (!o.is_open()) {
+			logger::warn("Failed to write asset manifest {}", path.string());
+			return;
+		}
+		o << manifest.dump();
+		dirty = false;
+	}
+
+	void TrimCacheDirectory(const std::filesystem::path& a_dir, uint64_t a_maxSize)
+	{
+		struct CacheEntry
+		{
+			std::filesystem::path path;
+			std::filesystem::file_time_type writeTime;
+			uint64_t size;
+		};
+
+		std::error_code ec;
+		std::vector<CacheEntry> entries;
+		uint64_t totalSize = 0;
+		for (const auto& entry : std::filesystem::directory_iterator(a_dir, ec)) {
+			CacheEntry cacheEntry{ entry.path(), entry.last_write_time(ec), 0 };
+			if (entry.is_directory(ec)) {
+				// Entries spread over several files are only as old as their newest file, and never evicted partially
+				cacheEntry.writeTime = {};
+				for (const auto& file : std::filesystem::recursive_directory_iterator(entry.path(), ec)) {
+					if (!file.is_regular_file(ec))
+						continue;
+					cacheEntry.writeTime = std::max(cacheEntry.writeTime, file.last_write_time(ec));
+					cacheEntry.size += file.file_size(ec);
+				}
+			} else if (entry.is_regular_file(ec)) {
+				cacheEntry.size = entry.file_size(ec);
+			}
+			entries.push_back(cacheEntry);
+			totalSize += cacheEntry.size;
+		}
+
+		std::sort(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b) { return a.writeTime < b.writeTime; });
+		for (const auto& entry : entries) {
+			if (totalSize <= a_maxSize)
+				break;
+			if (std::filesystem::remove_all(entry.path, ec) != static_cast<std::uintmax_t>(-1)) {
+				totalSize -= entry.size;
+				logger::debug("Evicted cache entry {}", entry.path.string());
+			}
+		}
+	}
+
+	void RemoveStaleCacheDirectories(const std::filesystem::path& a_dir, const std::filesystem::path& a_keep)
+	{
+		std::error_code ec;
+		for (const auto& entry : std::filesystem::directory_iterator(a_dir, ec)) {
+			if (!entry.is_directory(ec) || entry.path().filename() == a_keep)
+				continue;
+			if (std::filesystem::remove_all(entry.path(), ec) != static_cast<std::uintmax_t>(-1))
+				logger::info("Removed stale cache {}", entry.path().string());
+		}
+	}
+}  // namespace Util
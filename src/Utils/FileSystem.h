@@ -0,0 +1,100 @@
+#pragma once
+
+namespace Util
+{
+	/**
+	 * @brief Normalizes a file path by replacing backslashes with forward slashes, 
+	 *        removing redundant slashes, and converting all characters to lowercase.
+	 * 
+	 * This function ensures that the file path uses consistent forward slashes
+	 * (`/`), eliminates consecutive slashes (`//`), and converts all characters 
+	 * in the path to lowercase for case-insensitive comparisons.
+	 * 
+	 * @param a_path The original file path to be normalized.
+	 * @return A normalized file path as a lowercase string with single forward slashes.
+	 */
+	std::string FixFilePath(const std::string& a_path);
+
+	/**
+	 * Cached listings of the directories scanned at startup.
+	 * Listings are stored on disk with the last write time of their directory and reused while it is unchanged,
+	 * so only directories where files were added, removed or renamed are enumerated again.
+	 * The manifest is discarded when the plugin version changes. Virtual file systems do not update directory write times:
+	 * listings are never reused while one is loaded, and once data is loaded a changed load order enumerates every reused
+	 * directory again for the next start.
+	 */
+	class AssetManifest
+	{
+	public:
+		static AssetManifest* GetSingleton()
+		{
+			static AssetManifest singleton;
+			return &singleton;
+		}
+
+		struct Entry
+		{
+			std::string name;
+			bool isDirectory = false;
+			uint64_t size = 0;       // 0 for directories
+			int64_t writeTime = 0;   // std::filesystem::file_time_type ticks
+
+			bool operator==(const Entry&) const = default;
+		};
+
+		/**
+		 * Sets where the manifest is stored, call before the first listing.
+		 * Until then, or with a_reuseListings false, every directory is enumerated and nothing is saved.
+		 */
+		void Configure(std::filesystem::path a_path, std::string a_pluginVersion, bool a_reuseListings);
+
+		// Non-recursive listing of a directory, empty if it does not exist
+		std::vector<Entry> List(const std::filesystem::path& a_dir);
+
+		// Sorted paths of the files in a directory with the given extension, same as clib_util::distribution::get_configs without a prefix
+		std::vector<std::string> GetConfigs(const std::filesystem::path& a_dir, std::string_view a_extension);
+
+		// Revalidates reused listings if the load order changed and writes the manifest if any directory was enumerated, call once data is loaded
+		void Save(uint64_t a_loadOrderHash);
+
+		// Deletes the manifest, for mod managers whose virtual file system does not update directory write times
+		void Clear();
+
+		uint32_t GetReused() const { return hits; }
+		uint32_t GetEnumerated() const { return misses; }
+
+	private:
+		struct Directory
+		{
+			int64_t writeTime = 0;
+			std::vector<Entry> entries;
+			bool enumerated = false;  // listed from disk this session
+		};
+
+		static void Enumerate(const std::filesystem::path& a_dir, Directory& a_directory);
+		void Load();
+
+		std::mutex mutex;
+		std::filesystem::path path;
+		std::string pluginVersion;
+		bool reuseListings = false;
+		std::map<std::string, Directory> directories;
+		uint64_t loadOrderHash = 0;
+		bool loaded = false;
+		bool dirty = false;
+		uint32_t hits = 0;
+		uint32_t misses = 0;
+	};
+
+	/**
+	 * Deletes the least recently written entries of a directory until it is no larger than a_maxSize bytes.
+	 * An entry is a file or a directory directly inside a_dir; a directory is aged by its newest file and removed as a whole.
+	 * Readers of a cache are expected to touch the write time of what they use.
+	 */
+	void TrimCacheDirectory(const std::filesystem::path& a_dir, uint64_t a_maxSize);
+
+	/**
+	 * Deletes every subdirectory of a cache directory except a_keep, such as the caches of a previous load order.
+	 */
+	void RemoveStaleCacheDirectories(const std::filesystem::path& a_dir, const std::filesystem::path& a_keep);
+}  // namespace Util
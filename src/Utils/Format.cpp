@@ -44,25 +44,6 @@ namespace Util
 		return result;
 	}
 
-	std::string FixFilePath(const std::string& a_path)
-	{
-		std::string lowerFilePath = a_path;
-
-		// Replace all backslashes with forward slashes
-		std::replace(lowerFilePath.begin(), lowerFilePath.end(), '\\', '/');
-
-		// Remove consecutive forward slashes
-		std::string::iterator newEnd = std::unique(lowerFilePath.begin(), lowerFilePath.end(),
-			[](char a, char b) { return a == '/' && b == '/'; });
-		lowerFilePath.erase(newEnd, lowerFilePath.end());
-
-		// Convert all characters to lowercase
-		std::transform(lowerFilePath.begin(), lowerFilePath.end(), lowerFilePath.begin(),
-			[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-
-		return lowerFilePath;
-	}
-
 	std::string WStringToString(const std::wstring& wideString)
 	{
 		std::string result;
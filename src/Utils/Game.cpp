@@ -28,6 +28,53 @@ namespace Util
 		Dest.m[2][3] = Source.translate.z;
 	}
 
+	// Water color before the weather multiplier in xyz, water height in w
+	static float4 GetCellWaterData(RE::TESObjectCELL* a_cell)
+	{
+		float4 data = float4(1.0f, 1.0f, 1.0f, -FLT_MAX);
+
+		RE::TESWaterForm* water = nullptr;
+		if (auto extraCellWaterType = a_cell->extraList.GetByType<RE::ExtraCellWaterType>())
+			water = extraCellWaterType->water;
+
+		if (!water) {
+			if (auto worldSpace = RE::TES::GetSingleton()->GetRuntimeData2().worldSpace)
+				water = worldSpace->worldWater;
+		}
+
+		if (water) {
+			data = { float(water->data.deepWaterColor.red) + float(water->data.shallowWaterColor.red),
+				float(water->data.deepWaterColor.green) + float(water->data.shallowWaterColor.green),
+				float(water->data.deepWaterColor.blue) + float(water->data.shallowWaterColor.blue) };
+
+			data.x /= 255.0f;
+			data.y /= 255.0f;
+			data.z /= 255.0f;
+
+			data.x *= 0.5;
+			data.y *= 0.5;
+			data.z *= 0.5;
+		}
+
+		data.w = a_cell->GetExteriorWaterHeight();
+
+		return data;
+	}
+
+	static float4 ApplyWaterMultiplier(float4 a_data, float a_positionZ)
+	{
+		if (auto sky = RE::Sky::GetSingleton()) {
+			const auto& color = sky->skyColor[RE::TESWeather::ColorTypes::kWaterMultiplier];
+			a_data.x *= color.red;
+			a_data.y *= color.green;
+			a_data.z *= color.blue;
+		}
+
+		a_data.w -= a_positionZ;
+
+		return a_data;
+	}
+
 	float4 TryGetWaterData(float offsetX, float offsetY)
 	{
 		if (RE::BSGraphics::RendererShadowState::GetSingleton()) {
@@ -35,64 +82,69 @@ namespace Util
 				auto position = GetEyePosition(0);
 				position.x += offsetX;
 				position.y += offsetY;
-				if (auto cell = tes->GetCell(position)) {
-					float4 data = float4(1.0f, 1.0f, 1.0f, -FLT_MAX);
-
-					bool extraCellWater = false;
-
-					if (auto extraCellWaterType = cell->extraList.GetByType<RE::ExtraCellWaterType>()) {
-						if (auto water = extraCellWaterType->water) {
-							{
-								data = { float(water->data.deepWaterColor.red) + float(water->data.shallowWaterColor.red),
-									float(water->data.deepWaterColor.green) + float(water->data.shallowWaterColor.green),
-									float(water->data.deepWaterColor.blue) + float(water->data.shallowWaterColor.blue) };
-
-								data.x /= 255.0f;
-								data.y /= 255.0f;
-								data.z /= 255.0f;
-
-								data.x *= 0.5;
-								data.y *= 0.5;
-								data.z *= 0.5;
-								extraCellWater = true;
-							}
-						}
-					}
-
-					if (!extraCellWater) {
-						if (auto worldSpace = tes->GetRuntimeData2().worldSpace) {
-							if (auto water = worldSpace->worldWater) {
-								data = { float(water->data.deepWaterColor.red) + float(water->data.shallowWaterColor.red),
-									float(water->data.deepWaterColor.green) + float(water->data.shallowWaterColor.green),
-									float(water->data.deepWaterColor.blue) + float(water->data.shallowWaterColor.blue) };
-
-								data.x /= 255.0f;
-								data.y /= 255.0f;
-								data.z /= 255.0f;
-
-								data.x *= 0.5;
-								data.y *= 0.5;
-								data.z *= 0.5;
-							}
-						}
-					}
-
-					if (auto sky = RE::Sky::GetSingleton()) {
-						const auto& color = sky->skyColor[RE::TESWeather::ColorTypes::kWaterMultiplier];
-						data.x *= color.red;
-						data.y *= color.green;
-						data.z *= color.blue;
-					}
-
-					data.w = cell->GetExteriorWaterHeight() - position.z;
-
-					return data;
-				}
+				if (auto cell = tes->GetCell(position))
+					return ApplyWaterMultiplier(GetCellWaterData(cell), position.z);
 			}
 		}
 		return float4(1.0f, 1.0f, 1.0f, -FLT_MAX);
 	}
 
+	void WaterCache::Update(float4* o_waterData)
+	{
+		auto tes = RE::TES::GetSingleton();
+		if (!tes || !RE::BSGraphics::RendererShadowState::GetSingleton()) {
+			for (int i = 0; i < Size * Size; i++)
+				o_waterData[i] = float4(1.0f, 1.0f, 1.0f, -FLT_MAX);
+			return;
+		}
+
+		auto position = GetEyePosition(0);
+		WaterSpace space{ tes->GetRuntimeData2().worldSpace, tes->interiorCell };
+
+		grid.Update(
+			(int)std::floor(position.x / CellSize), (int)std::floor(position.y / CellSize), space,
+			[&](int a_x, int a_y) -> std::optional<float4> {
+				RE::NiPoint3 cellCenter = { ((float)a_x + 0.5f) * CellSize, ((float)a_y + 0.5f) * CellSize, position.z };
+				if (auto cell = tes->GetCell(cellCenter))
+					return GetCellWaterData(cell);
+				return std::nullopt;
+			},
+			[&](int a_index, const std::optional<float4>& a_data) {
+				o_waterData[a_index] = a_data ? ApplyWaterMultiplier(*a_data, position.z) : float4(1.0f, 1.0f, 1.0f, -FLT_MAX);
+			});
+	}
+
+	void ActorCellNotifier::DataLoaded()
+	{
+		if (auto player = RE::PlayerCharacter::GetSingleton())
+			player->AsBGSActorCellEventSource()->AddEventSink<RE::BGSActorCellEvent>(this);
+		else
+			logger::error("Player cell event source not found");
+	}
+
+	RE::BSEventNotifyControl ActorCellNotifier::ProcessEvent(const RE::BGSActorCellEvent*, RE::BSTEventSource<RE::BGSActorCellEvent>*)
+	{
+		for (const auto& listener : listeners)
+			listener();
+		return RE::BSEventNotifyControl::kContinue;
+	}
+
+	RE::BSEventNotifyControl WaterCache::ProcessEvent(const RE::TESCellFullyLoadedEvent*, RE::BSTEventSource<RE::TESCellFullyLoadedEvent>*)
+	{
+		Invalidate();
+		return RE::BSEventNotifyControl::kContinue;
+	}
+
+	void WaterCache::DataLoaded()
+	{
+		ActorCellNotifier::GetSingleton()->AddListener([this] { Invalidate(); });
+
+		if (auto scripts = RE::ScriptEventSourceHolder::GetSingleton())
+			scripts->AddEventSink<RE::TESCellFullyLoadedEvent>(this);
+		else
+			logger::error("Script event source not found");
+	}
+
 	RE::NiPoint3 GetAverageEyePosition()
 	{
 		auto shadowState = RE::BSGraphics::RendererShadowState::GetSingleton();
@@ -177,4 +229,23 @@ namespace Util
 		bool* bDynamicResolution = reinterpret_cast<bool*>(address);
 		return *bDynamicResolution;
 	}
+
+	uint64_t GetLoadOrderHash()
+	{
+		// FNV-1a over the plugin names, the load order does not change within a session
+		static uint64_t hash = [] {
+			uint64_t result = 14695981039346656037ull;
+			if (auto dataHandler = RE::TESDataHandler::GetSingleton()) {
+				for (auto file : dataHandler->files) {
+					if (!file)
+						continue;
+					for (char c : std::string_view(file->GetFilename()))
+						result = (result ^ (uint8_t)std::tolower(c)) * 1099511628211ull;
+					result = (result ^ '|') * 1099511628211ull;
+				}
+			}
+			return result;
+		}();
+		return hash;
+	}
 }  // namespace Util
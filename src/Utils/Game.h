@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include "CellGrid.h"
+
 /**
  @def GET_INSTANCE_MEMBER
  @brief Set variable in current namespace based on instance member from GetRuntimeData or GetVRRuntimeData.
@@ -20,6 +22,64 @@ namespace Util
 	void StoreTransform3x4NoScale(DirectX::XMFLOAT3X4& Dest, const RE::NiTransform& Source);
 
 	float4 TryGetWaterData(float offsetX, float offsetY);
+
+	/**
+	 * Single sink for the player's BGSActorCellEvent, calling every listener when the player enters or leaves a cell.
+	 * Listeners are added before DataLoaded registers the sink.
+	 */
+	class ActorCellNotifier : public RE::BSTEventSink<RE::BGSActorCellEvent>
+	{
+	public:
+		static ActorCellNotifier* GetSingleton()
+		{
+			static ActorCellNotifier singleton;
+			return &singleton;
+		}
+
+		void AddListener(std::function<void()> a_listener) { listeners.push_back(std::move(a_listener)); }
+		void DataLoaded();
+
+		virtual RE::BSEventNotifyControl ProcessEvent(const RE::BGSActorCellEvent* a_event, RE::BSTEventSource<RE::BGSActorCellEvent>* a_eventSource) override;
+
+	private:
+		std::vector<std::function<void()>> listeners;
+	};
+
+	/**
+	 * Water data of the cells around the camera, laid out as the WaterData grid of the shared data buffer.
+	 * Tiles are only looked up again when a new cell scrolls into the grid, or after the player changes cell or a cell finishes loading.
+	 */
+	class WaterCache : public RE::BSTEventSink<RE::TESCellFullyLoadedEvent>
+	{
+	public:
+		static constexpr int Radius = 2;
+		static constexpr int Size = Radius * 2 + 1;
+		static constexpr float CellSize = 4096.0f;
+
+		static WaterCache* GetSingleton()
+		{
+			static WaterCache singleton;
+			return &singleton;
+		}
+
+		void Update(float4* o_waterData);
+		void Invalidate() { grid.Invalidate(); }
+		void DataLoaded();
+
+		virtual RE::BSEventNotifyControl ProcessEvent(const RE::TESCellFullyLoadedEvent* a_event, RE::BSTEventSource<RE::TESCellFullyLoadedEvent>* a_eventSource) override;
+
+	private:
+		struct WaterSpace
+		{
+			RE::TESWorldSpace* worldSpace = nullptr;
+			RE::TESObjectCELL* interiorCell = nullptr;
+
+			bool operator==(const WaterSpace&) const = default;
+		};
+
+		// Water data of the cells before the weather multiplier, empty where there is no cell
+		CellGrid<float4, WaterSpace, Radius> grid;
+	};
 	float4 GetCameraData();
 	bool GetTemporal();
 	float GetVerticalFOVRad();
@@ -44,6 +104,11 @@ namespace Util
 	 */
 	bool IsDynamicResolution();
 
+	/**
+	 * Hash of the plugin names in load order, form ids from mods are only stable for the same value.
+	 */
+	uint64_t GetLoadOrderHash();
+
 	/**
 	 * Usage:
 	 * static FrameChecker frame_checker;
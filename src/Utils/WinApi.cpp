@@ -27,4 +27,9 @@ namespace Util
 
 		return std::nullopt;
 	}
+
+	bool IsVirtualFileSystemLoaded()
+	{
+		return GetModuleHandle(L"usvfs_x64.dll") != nullptr;
+	}
 }  // namespace Util
@@ -3,4 +3,7 @@
 namespace Util
 {
 	std::optional<REL::Version> GetDllVersion(const std::wstring& dllPath);
+
+	// Whether a mod manager's virtual file system (Mod Organizer 2's usvfs) is hooked into the process, it does not update directory write times
+	bool IsVirtualFileSystemLoaded();
 }  // namespace Util
@@ -17,6 +17,18 @@ std::list<std::string> errors;
 
 bool Load();
 
+static constexpr size_t LogQueueSize = 4096;
+
+static LPTOP_LEVEL_EXCEPTION_FILTER previousExceptionFilter = nullptr;
+static std::terminate_handler previousTerminateHandler = nullptr;
+
+static LONG WINAPI FlushLogOnCrash(EXCEPTION_POINTERS* a_exception)
+{
+	if (auto defaultSink = AsyncRingSink::GetDefault())
+		defaultSink->FlushNow();
+	return previousExceptionFilter ? previousExceptionFilter(a_exception) : EXCEPTION_CONTINUE_SEARCH;
+}
+
 void InitializeLog([[maybe_unused]] spdlog::level::level_enum a_level = spdlog::level::info)
 {
 #ifndef NDEBUG
@@ -37,12 +49,27 @@ void InitializeLog([[maybe_unused]] spdlog::level::level_enum a_level = spdlog::
 	const auto level = a_level;
 #endif
 
-	auto log = std::make_shared<spdlog::logger>("global log"s, std::move(sink));
+	// Writes happen on a worker, warnings and above are never dropped and criticals are written right away
+	auto asyncSink = std::make_shared<AsyncRingSink>(std::move(sink), LogQueueSize);
+
+	auto log = std::make_shared<spdlog::logger>("global log"s, asyncSink);
 	log->set_level(level);
 	log->flush_on(spdlog::level::info);
 
 	spdlog::set_default_logger(std::move(log));
 	spdlog::set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%l] [%t] [%s:%#] %v");
+
+	AsyncRingSink::SetDefault(asyncSink);
+
+	// Whatever is still queued is written before a crash handler or the terminate handler ends the process
+	previousExceptionFilter = SetUnhandledExceptionFilter(FlushLogOnCrash);
+	previousTerminateHandler = std::set_terminate([] {
+		if (auto defaultSink = AsyncRingSink::GetDefault())
+			defaultSink->FlushNow();
+		if (previousTerminateHandler)
+			previousTerminateHandler();
+		std::abort();
+	});
 }
 
 extern "C" DLLEXPORT bool SKSEAPI SKSEPlugin_Load(const SKSE::LoadInterface* a_skse)
@@ -131,11 +158,14 @@ void MessageHandler(SKSE::MessagingInterface::Message* message)
 				}
 
 				TruePBR::GetSingleton()->DataLoaded();
+				Util::WaterCache::GetSingleton()->DataLoaded();
 				for (auto* feature : Feature::GetFeatureList()) {
 					if (feature->loaded) {
 						feature->DataLoaded();
 					}
 				}
+				Util::ActorCellNotifier::GetSingleton()->DataLoaded();
+				Util::AssetManifest::GetSingleton()->Save(Util::GetLoadOrderHash());
 			}
 
 			break;
@@ -167,6 +197,8 @@ bool Load()
 	auto log = spdlog::default_logger();
 	log->set_level(state->GetLogLevel());
 
+	Util::AssetManifest::GetSingleton()->Configure(state->folderPath + "\\AssetManifest.json", Plugin::VERSION.string(), !Util::IsVirtualFileSystemLoaded());
+
 	const std::array dlls = {
 		L"Data/SKSE/Plugins/ShaderTools.dll",
 		L"Data/SKSE/Plugins/SSEShaderTools.dll"
@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+
+#include "Utils/FileSystem.h"
+
+namespace
+{
+	// Fresh directory under the system temp directory, removed after the test
+	class AssetManifestTest : public testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			// Lower case, the manifest keys directories by their normalized path
+			std::string name = testing::UnitTest::GetInstance()->current_test_info()->name();
+			std::ranges::transform(name, name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+			root = std::filesystem::temp_directory_path() / ("assetmanifest." + name);
+			std::filesystem::remove_all(root);
+			std::filesystem::create_directories(root / "data" / "configs");
+			manifestPath = root / "AssetManifest.json";
+		}
+
+		void TearDown() override
+		{
+			std::error_code ec;
+			std::filesystem::remove_all(root, ec);
+		}
+
+		void WriteFile(const std::filesystem::path& a_path, std::string_view a_contents)
+		{
+			std::ofstream o{ a_path, std::ios::binary };
+			o << a_contents;
+		}
+
+		// Changes files while keeping the directory's write time, like a virtual file system does
+		template <class F>
+		void ChangeBehindDirectory(const std::filesystem::path& a_dir, F&& a_change)
+		{
+			auto writeTime = std::filesystem::last_write_time(a_dir);
+			a_change();
+			std::filesystem::last_write_time(a_dir, writeTime);
+		}
+
+		std::unique_ptr<Util::AssetManifest> Open(std::string a_pluginVersion = "1.0.0", bool a_reuseListings = true)
+		{
+			auto manifest = std::make_unique<Util::AssetManifest>();
+			manifest->Configure(manifestPath, std::move(a_pluginVersion), a_reuseListings);
+			return manifest;
+		}
+
+		std::filesystem::path Configs() const { return root / "data" / "configs"; }
+
+		std::filesystem::path root;
+		std::filesystem::path manifestPath;
+	};
+}
+
+TEST_F(AssetManifestTest, ListsEntriesWithSizeAndWriteTime)
+{
+	WriteFile(Configs() / "b.json", "12345");
+	WriteFile(Configs() / "a.json", "1");
+	std::filesystem::create_directory(Configs() / "Sub");
+
+	auto manifest = Open();
+	auto entries = manifest->List(Configs());
+	ASSERT_EQ(entries.size(), 3u);
+	EXPECT_EQ(entries[0].name, "Sub");
+	EXPECT_TRUE(entries[0].isDirectory);
+	EXPECT_EQ(entries[1].name, "a.json");
+	EXPECT_EQ(entries[1].size, 1u);
+	EXPECT_EQ(entries[2].name, "b.json");
+	EXPECT_EQ(entries[2].size, 5u);
+	EXPECT_EQ(entries[2].writeTime, std::filesystem::last_write_time(Configs() / "b.json").time_since_epoch().count());
+
+	EXPECT_TRUE(manifest->List(root / "Missing").empty());
+}
+
+TEST_F(AssetManifestTest, ReusesUnchangedDirectoriesOnTheNextStart)
+{
+	WriteFile(Configs() / "a.json", "1");
+	auto first = Open();
+	auto entries = first->List(Configs());
+	first->Save(42);
+	EXPECT_EQ(first->GetEnumerated(), 1u);
+	ASSERT_TRUE(std::filesystem::exists(manifestPath));
+
+	auto second = Open();
+	EXPECT_EQ(second->List(Configs()), entries);
+	EXPECT_EQ(second->GetReused(), 1u);
+	EXPECT_EQ(second->GetEnumerated(), 0u);
+}
+
+TEST_F(AssetManifestTest, EnumeratesDirectoriesWhoseWriteTimeChanged)
+{
+	WriteFile(Configs() / "a.json", "1");
+	auto first = Open();
+	first->List(Configs());
+	first->Save(42);
+
+	WriteFile(Configs() / "b.json", "2");
+	std::filesystem::last_write_time(Configs(), std::filesystem::last_write_time(Configs()) + 1s);
+
+	auto second = Open();
+	EXPECT_EQ(second->List(Configs()).size(), 2u);
+	EXPECT_EQ(second->GetEnumerated(), 1u);
+}
+
+TEST_F(AssetManifestTest, DiscardsManifestOfAnotherPluginVersion)
+{
+	WriteFile(Configs() / "a.json", "1");
+	auto first = Open("1.0.0");
+	first->List(Configs());
+	first->Save(42);
+
+	auto second = Open("1.1.0");
+	second->List(Configs());
+	EXPECT_EQ(second->GetReused(), 0u);
+	EXPECT_EQ(second->GetEnumerated(), 1u);
+}
+
+// A mod manager's virtual file system changes what a directory contains without touching its write time
+TEST_F(AssetManifestTest, NeverReusesListingsUnderAVirtualFileSystem)
+{
+	WriteFile(Configs() / "a.json", "1");
+	auto first = Open();
+	first->List(Configs());
+	first->Save(42);
+
+	ChangeBehindDirectory(Configs(), [&] { WriteFile(Configs() / "b.json", "2"); });
+
+	auto second = Open("1.0.0", false);
+	EXPECT_EQ(second->List(Configs()).size(), 2u);
+	EXPECT_EQ(second->GetReused(), 0u);
+
+	// Nothing is written that a later start without the virtual file system could trust
+	auto writeTime = std::filesystem::last_write_time(manifestPath);
+	second->Save(43);
+	EXPECT_EQ(std::filesystem::last_write_time(manifestPath), writeTime);
+}
+
+TEST_F(AssetManifestTest, RevalidatesReusedListingsWhenTheLoadOrderChanged)
+{
+	WriteFile(Configs() / "a.json", "1");
+	auto first = Open();
+	first->List(Configs());
+	first->Save(42);
+
+	// Same name, new contents, the directory write time stays the same
+	ChangeBehindDirectory(Configs(), [&] { WriteFile(Configs() / "a.json", "123"); });
+
+	auto second = Open();
+	EXPECT_EQ(second->List(Configs())[0].size, 1u);  // stale for this session
+	second->Save(43);
+
+	auto third = Open();
+	auto entries = third->List(Configs());
+	EXPECT_EQ(third->GetReused(), 1u);
+	ASSERT_EQ(entries.size(), 1u);
+	EXPECT_EQ(entries[0].size, 3u);
+}
+
+TEST_F(AssetManifestTest, ClearDeletesTheManifest)
+{
+	auto manifest = Open();
+	manifest->List(Configs());
+	manifest->Save(42);
+	ASSERT_TRUE(std::filesystem::exists(manifestPath));
+
+	manifest->Clear();
+	EXPECT_FALSE(std::filesystem::exists(manifestPath));
+}
+
+TEST_F(AssetManifestTest, GetConfigsFiltersAndSorts)
+{
+	WriteFile(Configs() / "b.json", "");
+	WriteFile(Configs() / "a.json", "");
+	WriteFile(Configs() / "c.ini", "");
+	std::filesystem::create_directory(Configs() / "d.json");
+
+	auto manifest = Open();
+	EXPECT_EQ(manifest->GetConfigs(Configs(), ".json"), (std::vector<std::string>{ (Configs() / "a.json").string(), (Configs() / "b.json").string() }));
+}
@@ -0,0 +1,273 @@
+#include <gtest/gtest.h>
+
+#include <condition_variable>
+
+#include "AsyncLog.h"
+
+namespace
+{
+	struct Line
+	{
+		spdlog::level::level_enum level;
+		std::string payload;
+	};
+
+	// Records what reaches the file, can be held to simulate a slow disk
+	class TestSink : public spdlog::sinks::sink
+	{
+	public:
+		void log(const spdlog::details::log_msg& a_msg) override
+		{
+			std::unique_lock lock(mutex);
+			writing = true;
+			changed.notify_all();
+			while (!changed.wait_for(lock, 10ms, [&] { return !held; })) {}
+			lines.push_back({ a_msg.level, std::string(a_msg.payload.data(), a_msg.payload.size()) });
+			writing = false;
+		}
+
+		void flush() override
+		{
+			std::lock_guard lock(mutex);
+			flushes++;
+		}
+
+		void set_pattern(const std::string&) override {}
+		void set_formatter(std::unique_ptr<spdlog::formatter>) override {}
+
+		void Hold()
+		{
+			std::lock_guard lock(mutex);
+			held = true;
+		}
+
+		void Release()
+		{
+			{
+				std::lock_guard lock(mutex);
+				held = false;
+			}
+			changed.notify_all();
+		}
+
+		void WaitUntilWriting()
+		{
+			std::unique_lock lock(mutex);
+			while (!changed.wait_for(lock, 10ms, [&] { return writing; })) {}
+		}
+
+		std::vector<Line> GetLines()
+		{
+			std::lock_guard lock(mutex);
+			return lines;
+		}
+
+		uint32_t GetFlushes()
+		{
+			std::lock_guard lock(mutex);
+			return flushes;
+		}
+
+	private:
+		std::mutex mutex;
+		std::condition_variable changed;
+		bool held = false;
+		bool writing = false;
+		std::vector<Line> lines;
+		uint32_t flushes = 0;
+	};
+
+	spdlog::details::log_msg Message(spdlog::level::level_enum a_level, std::string_view a_payload)
+	{
+		return spdlog::details::log_msg("test", a_level, a_payload);
+	}
+
+	// Stalls the worker inside the target on a first message so the ring can be filled deterministically
+	void StallWorker(TestSink& a_target, AsyncRingSink& a_sink)
+	{
+		a_target.Hold();
+		a_sink.log(Message(spdlog::level::info, "stalled"));
+		a_target.WaitUntilWriting();
+	}
+
+	std::vector<std::string> Payloads(const std::vector<Line>& a_lines)
+	{
+		std::vector<std::string> payloads;
+		for (const auto& line : a_lines)
+			payloads.push_back(line.payload);
+		return payloads;
+	}
+
+	// Installs a logger writing through a_sink as the default logger and a_sink as the DeferredLog sink
+	struct DefaultLoggerScope
+	{
+		DefaultLoggerScope(std::shared_ptr<spdlog::sinks::sink> a_sink, spdlog::level::level_enum a_level, std::shared_ptr<AsyncRingSink> a_deferredSink)
+		{
+			auto log = std::make_shared<spdlog::logger>("test", std::move(a_sink));
+			log->set_level(a_level);
+			spdlog::set_default_logger(std::move(log));
+			AsyncRingSink::SetDefault(std::move(a_deferredSink));
+		}
+
+		~DefaultLoggerScope()
+		{
+			AsyncRingSink::SetDefault(nullptr);
+			spdlog::set_default_logger(previous);
+		}
+
+		std::shared_ptr<spdlog::logger> previous = spdlog::default_logger();
+	};
+}
+
+TEST(AsyncLog, WritesInOrderOnTheWorker)
+{
+	auto target = std::make_shared<TestSink>();
+	{
+		AsyncRingSink sink(target, 128);
+		for (uint32_t i = 0; i < 100; i++)
+			sink.log(Message(spdlog::level::info, std::to_string(i)));
+		sink.FlushNow();
+		EXPECT_EQ(sink.GetDropped(), 0u);
+	}
+
+	auto lines = target->GetLines();
+	ASSERT_EQ(lines.size(), 100u);
+	for (uint32_t i = 0; i < lines.size(); i++)
+		EXPECT_EQ(lines[i].payload, std::to_string(i));
+}
+
+TEST(AsyncLog, DropsAndReportsLowLevelsWhenFull)
+{
+	auto target = std::make_shared<TestSink>();
+	AsyncRingSink sink(target, 4);
+	StallWorker(*target, sink);
+
+	for (uint32_t i = 0; i < 10; i++)
+		sink.log(Message(i % 2 ? spdlog::level::debug : spdlog::level::info, std::to_string(i)));
+	EXPECT_EQ(sink.GetDropped(), 6u);
+
+	target->Release();
+	sink.FlushNow();
+
+	auto lines = target->GetLines();
+	EXPECT_EQ(Payloads(lines), (std::vector<std::string>{ "stalled", "0", "1", "2", "3", "6 log messages dropped while the log queue was full" }));
+	EXPECT_EQ(lines.back().level, spdlog::level::warn);
+}
+
+TEST(AsyncLog, NeverDropsWarningsWhenFull)
+{
+	auto target = std::make_shared<TestSink>();
+	AsyncRingSink sink(target, 2);
+	StallWorker(*target, sink);
+
+	sink.log(Message(spdlog::level::info, "queued 0"));
+	sink.log(Message(spdlog::level::info, "queued 1"));
+
+	// The ring is full, the warnings are written by their callers once the target is free, after the queued messages
+	std::thread producer([&] {
+		sink.log(Message(spdlog::level::warn, "warn"));
+		sink.log(Message(spdlog::level::err, "error"));
+	});
+	target->Release();
+	producer.join();
+	sink.FlushNow();
+
+	EXPECT_EQ(sink.GetDropped(), 0u);
+	EXPECT_EQ(Payloads(target->GetLines()), (std::vector<std::string>{ "stalled", "queued 0", "queued 1", "warn", "error" }));
+}
+
+TEST(AsyncLog, WritesCriticalSynchronously)
+{
+	auto target = std::make_shared<TestSink>();
+	AsyncRingSink sink(target, 16);
+
+	sink.log(Message(spdlog::level::info, "before"));
+	sink.log(Message(spdlog::level::critical, "critical"));
+
+	// Written and flushed before log returned, with what was queued ahead of it
+	EXPECT_EQ(Payloads(target->GetLines()), (std::vector<std::string>{ "before", "critical" }));
+	EXPECT_GE(target->GetFlushes(), 1u);
+}
+
+TEST(AsyncLog, DestructorWritesWhatIsQueued)
+{
+	auto target = std::make_shared<TestSink>();
+	{
+		AsyncRingSink sink(target, 1024);
+		for (uint32_t i = 0; i < 1000; i++)
+			sink.log(Message(spdlog::level::debug, std::to_string(i)));
+	}
+	EXPECT_EQ(target->GetLines().size(), 1000u);
+}
+
+TEST(AsyncLog, FlushNowGivesUpOnAStuckWorker)
+{
+	auto target = std::make_shared<TestSink>();
+	AsyncRingSink sink(target, 16);
+	StallWorker(*target, sink);
+	sink.log(Message(spdlog::level::info, "queued"));
+
+	auto start = std::chrono::steady_clock::now();
+	sink.FlushNow(std::chrono::milliseconds(20));
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+
+	target->Release();
+	sink.FlushNow();
+	EXPECT_EQ(Payloads(target->GetLines()), (std::vector<std::string>{ "stalled", "queued" }));
+}
+
+TEST(AsyncLog, DeferredMessagesCopyTheirArguments)
+{
+	auto target = std::make_shared<TestSink>();
+	auto sink = std::make_shared<AsyncRingSink>(target, 16);
+	DefaultLoggerScope scope(sink, spdlog::level::trace, sink);
+	StallWorker(*target, *sink);
+
+	{
+		std::string name = "Skylighting";
+		char buffer[] = "probes";
+		DeferredLog::debug("{} updated {} {}", name, std::string_view(buffer), 42);
+		LOG_TRACE("{} {}", std::string("temporary"), 1.5f);
+		name = "overwritten";
+		buffer[0] = 'X';
+	}
+
+	target->Release();
+	sink->FlushNow();
+
+	auto lines = target->GetLines();
+	ASSERT_EQ(lines.size(), 3u);
+	EXPECT_EQ(lines[1].payload, "Skylighting updated probes 42");
+	EXPECT_EQ(lines[1].level, spdlog::level::debug);
+	EXPECT_EQ(lines[2].payload, "temporary 1.5");
+	EXPECT_EQ(lines[2].level, spdlog::level::trace);
+}
+
+TEST(AsyncLog, FilteredMessagesDoNotEvaluateArguments)
+{
+	auto target = std::make_shared<TestSink>();
+	auto sink = std::make_shared<AsyncRingSink>(target, 16);
+	DefaultLoggerScope scope(sink, spdlog::level::info, sink);
+
+	uint32_t evaluated = 0;
+	auto argument = [&] { return ++evaluated; };
+	LOG_DEBUG("{}", argument());
+	LOG_TRACE("{}", argument());
+	sink->FlushNow();
+
+	EXPECT_EQ(evaluated, 0u);
+	EXPECT_TRUE(target->GetLines().empty());
+}
+
+TEST(AsyncLog, DeferredMessagesFallBackWithoutSink)
+{
+	auto target = std::make_shared<TestSink>();
+	DefaultLoggerScope scope(target, spdlog::level::trace, nullptr);
+
+	DeferredLog::info("{} + {}", 1, "2");
+
+	auto lines = target->GetLines();
+	ASSERT_EQ(lines.size(), 1u);
+	EXPECT_EQ(lines[0].payload, "1 + 2");
+	EXPECT_EQ(lines[0].level, spdlog::level::info);
+}
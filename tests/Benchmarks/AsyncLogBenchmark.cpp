@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+
+#include <spdlog/sinks/null_sink.h>
+
+#include "AsyncLog.h"
+
+namespace
+{
+	// Default logger writing through an AsyncRingSink into a null sink, so only the calling thread's cost is measured
+	struct LoggerScope
+	{
+		explicit LoggerScope(spdlog::level::level_enum a_level)
+		{
+			sink = std::make_shared<AsyncRingSink>(std::make_shared<spdlog::sinks::null_sink_mt>(), 4096);
+			auto log = std::make_shared<spdlog::logger>("benchmark", sink);
+			log->set_level(a_level);
+			spdlog::set_default_logger(std::move(log));
+			AsyncRingSink::SetDefault(sink);
+		}
+
+		~LoggerScope()
+		{
+			AsyncRingSink::SetDefault(nullptr);
+			spdlog::set_default_logger(previous);
+			sink->FlushNow();
+		}
+
+		std::shared_ptr<spdlog::logger> previous = spdlog::default_logger();
+		std::shared_ptr<AsyncRingSink> sink;
+	};
+
+	std::string Name()
+	{
+		return "Skylighting::UpdateProbes";
+	}
+}
+
+// Level below the logger's, the arguments are not evaluated
+static void BM_LogDisabled(benchmark::State& state)
+{
+	LoggerScope scope(spdlog::level::info);
+	uint32_t i = 0;
+	for (auto _ : state)
+		LOG_DEBUG("{} took {} ms for {} probes", Name(), 1.25f, i++);
+	benchmark::DoNotOptimize(i);
+}
+BENCHMARK(BM_LogDisabled);
+
+// Logger enabled, the sink filters the level out after the arguments were captured
+static void BM_LogEnabledButFiltered(benchmark::State& state)
+{
+	LoggerScope scope(spdlog::level::trace);
+	scope.sink->set_level(spdlog::level::info);
+	uint32_t i = 0;
+	for (auto _ : state)
+		LOG_DEBUG("{} took {} ms for {} probes", Name(), 1.25f, i++);
+	state.counters["dropped"] = (double)scope.sink->GetDropped();
+}
+BENCHMARK(BM_LogEnabledButFiltered);
+
+// Written, formatted on the worker
+static void BM_LogEnabledDeferred(benchmark::State& state)
+{
+	LoggerScope scope(spdlog::level::trace);
+	uint32_t i = 0;
+	for (auto _ : state)
+		LOG_DEBUG("{} took {} ms for {} probes", Name(), 1.25f, i++);
+	state.counters["dropped"] = (double)scope.sink->GetDropped();
+}
+BENCHMARK(BM_LogEnabledDeferred);
+
+// Written, formatted on the calling thread
+static void BM_LogEnabledFormatted(benchmark::State& state)
+{
+	LoggerScope scope(spdlog::level::trace);
+	uint32_t i = 0;
+	for (auto _ : state)
+		logger::debug("{} took {} ms for {} probes", Name(), 1.25f, i++);
+	state.counters["dropped"] = (double)scope.sink->GetDropped();
+}
+BENCHMARK(BM_LogEnabledFormatted);
+
+// Warnings are never dropped, a full ring makes the caller write synchronously
+static void BM_LogWarning(benchmark::State& state)
+{
+	LoggerScope scope(spdlog::level::trace);
+	uint32_t i = 0;
+	for (auto _ : state)
+		logger::warn("{} took {} ms for {} probes", Name(), 1.25f, i++);
+}
+BENCHMARK(BM_LogWarning);
@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+
+#include "Utils/CellGrid.h"
+
+namespace
+{
+	using Grid = Util::CellGrid<float, int, 2>;
+
+	// A hash lookup per cell, cheaper than the game's so the difference is a lower bound
+	struct Cells
+	{
+		Cells()
+		{
+			for (int y = -64; y < 64; y++)
+				for (int x = -64; x < 64; x++)
+					heights[Key(x, y)] = (float)(x + y);
+		}
+
+		static int64_t Key(int a_x, int a_y) { return ((int64_t)a_x << 32) | (uint32_t)a_y; }
+
+		std::optional<float> operator()(int a_x, int a_y) const
+		{
+			if (auto it = heights.find(Key(a_x, a_y)); it != heights.end())
+				return it->second;
+			return std::nullopt;
+		}
+
+		std::unordered_map<int64_t, float> heights;
+	};
+
+	// Camera crossing a cell boundary every a_framesPerCell frames
+	int CameraCell(int64_t a_frame, int64_t a_framesPerCell)
+	{
+		return (int)((a_frame / a_framesPerCell) % 64) - 32;
+	}
+}
+
+// Every cell looked up every frame, as before the cache
+static void BM_WaterLookupEveryFrame(benchmark::State& state)
+{
+	Cells cells;
+	float data[Grid::Size * Grid::Size];
+	int64_t frame = 0;
+	for (auto _ : state) {
+		int cameraX = CameraCell(frame++, state.range(0));
+		for (int k = -2; k <= 2; k++)
+			for (int i = -2; i <= 2; i++)
+				data[(i + 2) + (k + 2) * Grid::Size] = cells(cameraX + i, k).value_or(-std::numeric_limits<float>::max());
+		benchmark::DoNotOptimize(data);
+	}
+}
+BENCHMARK(BM_WaterLookupEveryFrame)->Arg(1)->Arg(60);
+
+static void BM_WaterCellGrid(benchmark::State& state)
+{
+	Cells cells;
+	Grid grid;
+	float data[Grid::Size * Grid::Size];
+	int64_t frame = 0;
+	for (auto _ : state) {
+		grid.Update(CameraCell(frame++, state.range(0)), 0, 0, cells, [&](int a_index, const std::optional<float>& a_data) {
+			data[a_index] = a_data.value_or(-std::numeric_limits<float>::max());
+		});
+		benchmark::DoNotOptimize(data);
+	}
+}
+BENCHMARK(BM_WaterCellGrid)->Arg(1)->Arg(60);
@@ -0,0 +1,37 @@
+#include <benchmark/benchmark.h>
+
+#include "ClusterReferencePresets.h"
+
+using namespace ClusterReferencePresets;
+
+// Stages of the reference pipeline on the synthetic presets, the GPU work each of them stands for scales the same way
+static void BM_ClusterReferenceGather(benchmark::State& state)
+{
+	auto snapshot = MakeSnapshot(Presets[state.range(0)]);
+	state.SetLabel(Presets[state.range(0)].name);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(ClusterReference::GatherLights(snapshot));
+}
+BENCHMARK(BM_ClusterReferenceGather)->DenseRange(0, std::size(Presets) - 1)->Unit(benchmark::kMicrosecond);
+
+static void BM_ClusterReferenceBuild(benchmark::State& state)
+{
+	auto snapshot = MakeSnapshot(Presets[state.range(0)]);
+	state.SetLabel(Presets[state.range(0)].name);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(ClusterReference::BuildClusters(snapshot.building, snapshot.clusterSize, snapshot.eyeCount));
+}
+BENCHMARK(BM_ClusterReferenceBuild)->DenseRange(0, std::size(Presets) - 1)->Unit(benchmark::kMicrosecond);
+
+static void BM_ClusterReferenceCull(benchmark::State& state)
+{
+	auto snapshot = MakeSnapshot(Presets[state.range(0)]);
+	state.SetLabel(Presets[state.range(0)].name);
+	auto lights = ClusterReference::GatherLights(snapshot);
+	auto clusters = ClusterReference::BuildClusters(snapshot.building, snapshot.clusterSize, snapshot.eyeCount);
+	auto transformed = ClusterReference::TransformLights(lights.data(), (uint32_t)lights.size(), snapshot.transform);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(ClusterReference::CullLights(clusters, transformed.data(), (uint32_t)transformed.size(), snapshot.maxClusterLights, snapshot.eyeCount));
+	state.counters["Lights"] = (double)lights.size();
+}
+BENCHMARK(BM_ClusterReferenceCull)->DenseRange(0, std::size(Presets) - 1)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,47 @@
+#include <benchmark/benchmark.h>
+
+#include "EventJournal.h"
+#include "EventRing.h"
+
+namespace
+{
+	struct ScopeEvent
+	{
+		uint32_t id;
+		int64_t start;
+		int64_t end;
+	};
+
+	int64_t Now()
+	{
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+	}
+}
+
+// Recording side of Profiler::CPUScope, the ring is drained once per 1024 scopes like once per frame
+static void BM_ProfilerScope(benchmark::State& state)
+{
+	auto ring = std::make_unique<EventRing<ScopeEvent, 4096>>();
+	uint32_t i = 0;
+	for (auto _ : state) {
+		int64_t start = Now();
+		ring->Push({ i, start, Now() });
+		if (++i % 1024 == 0)
+			ring->Drain([](const ScopeEvent&) {});
+	}
+}
+BENCHMARK(BM_ProfilerScope);
+
+// Profiler::StutterScope posting to the journal
+static void BM_StutterEvent(benchmark::State& state)
+{
+	auto journal = std::make_unique<EventJournal<ScopeEvent, 1024>>();
+	uint32_t i = 0;
+	for (auto _ : state) {
+		int64_t start = Now();
+		journal->Post({ i, start, Now() });
+		if (++i % 256 == 0)
+			journal->Drain([](const ScopeEvent&) {});
+	}
+}
+BENCHMARK(BM_StutterEvent);
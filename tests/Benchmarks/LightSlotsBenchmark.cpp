@@ -0,0 +1,48 @@
+#include <benchmark/benchmark.h>
+
+#include "Features/LightLimitFIx/LightSlots.h"
+
+namespace
+{
+	struct alignas(16) BenchmarkLight
+	{
+		float color[3];
+		float radius;
+		float position[4][4];
+		uint32_t roomFlags[4];
+		uint32_t lightFlags;
+		uint32_t shadowMaskIndex;
+		float pad0[2];
+	};
+}
+
+// Bytes uploaded per frame for a scene of lights where a share of them moves or flickers every frame
+static void BM_LightSlotsUpload(benchmark::State& state)
+{
+	const auto lightCount = (uint32_t)state.range(0);
+	const auto changedPercent = (uint32_t)state.range(1);
+
+	LightSlots<uintptr_t, BenchmarkLight> slots;
+	slots.Reset(1024);
+
+	size_t bytes = 0;
+	uint32_t frame = 0;
+	for (auto _ : state) {
+		slots.NextFrame();
+		for (uint32_t i = 0; i < lightCount; i++) {
+			auto slot = slots.Acquire(i + 1);
+			BenchmarkLight light{};
+			light.radius = 100.0f;
+			if ((i * 37 + frame) % 100 < changedPercent)
+				light.color[0] = (float)frame;
+			slots.Write(slot, light);
+		}
+		slots.ReleaseUnused();
+		bytes += slots.Upload(slots.Count(), [](uint32_t a_begin, uint32_t a_end) { benchmark::DoNotOptimize(a_end - a_begin); });
+		frame++;
+	}
+
+	state.counters["BytesPerFrame"] = benchmark::Counter((double)bytes / (double)state.iterations());
+	state.counters["FullBytes"] = (double)(sizeof(BenchmarkLight) * lightCount);
+}
+BENCHMARK(BM_LightSlotsUpload)->ArgsProduct({ { 64, 256, 1024 }, { 0, 5, 25, 100 } });
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include "Utils/FileSystem.h"
+
+namespace
+{
+	class CacheDirectoryTest : public testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			root = std::filesystem::temp_directory_path() / (std::string("CacheDirectory.") + testing::UnitTest::GetInstance()->current_test_info()->name());
+			std::filesystem::remove_all(root);
+			std::filesystem::create_directories(root);
+		}
+
+		void TearDown() override
+		{
+			std::error_code ec;
+			std::filesystem::remove_all(root, ec);
+		}
+
+		// Writes a_size bytes and backdates the file by a_age, readers of a cache touch what they use
+		void WriteFile(const std::filesystem::path& a_path, size_t a_size, std::chrono::hours a_age)
+		{
+			std::filesystem::create_directories(a_path.parent_path());
+			{
+				std::ofstream o{ a_path, std::ios::binary };
+				o << std::string(a_size, 'x');
+			}
+			std::filesystem::last_write_time(a_path, now - a_age);
+		}
+
+		std::vector<std::string> Remaining() const
+		{
+			std::vector<std::string> names;
+			for (const auto& entry : std::filesystem::directory_iterator(root))
+				names.push_back(entry.path().filename().string());
+			std::ranges::sort(names);
+			return names;
+		}
+
+		std::filesystem::path root;
+		std::filesystem::file_time_type now = std::filesystem::file_time_type::clock::now();
+	};
+}
+
+TEST_F(CacheDirectoryTest, EvictsLeastRecentlyWrittenFirst)
+{
+	WriteFile(root / "a.bin", 100, 1h);
+	WriteFile(root / "b.bin", 100, 3h);
+	WriteFile(root / "c.bin", 100, 2h);
+	WriteFile(root / "d.bin", 100, 4h);
+
+	Util::TrimCacheDirectory(root, 250);
+	EXPECT_EQ(Remaining(), (std::vector<std::string>{ "a.bin", "c.bin" }));
+}
+
+TEST_F(CacheDirectoryTest, KeepsEverythingUnderTheLimit)
+{
+	WriteFile(root / "a.bin", 100, 1h);
+	WriteFile(root / "b.bin", 100, 2h);
+
+	Util::TrimCacheDirectory(root, 200);
+	EXPECT_EQ(Remaining(), (std::vector<std::string>{ "a.bin", "b.bin" }));
+}
+
+// A directory entry is as recent as its newest file, and removed as a whole
+TEST_F(CacheDirectoryTest, AgesDirectoriesByTheirNewestFile)
+{
+	WriteFile(root / "Cell" / "old.bin", 100, 10h);
+	WriteFile(root / "Cell" / "Nested" / "new.bin", 100, 1h);
+	WriteFile(root / "single.bin", 100, 2h);
+
+	Util::TrimCacheDirectory(root, 250);
+	EXPECT_EQ(Remaining(), (std::vector<std::string>{ "Cell" }));
+	EXPECT_TRUE(std::filesystem::exists(root / "Cell" / "old.bin"));
+
+	Util::TrimCacheDirectory(root, 100);
+	EXPECT_TRUE(Remaining().empty());
+}
+
+TEST_F(CacheDirectoryTest, MissingDirectoryIsIgnored)
+{
+	Util::TrimCacheDirectory(root / "Missing", 0);
+	Util::RemoveStaleCacheDirectories(root / "Missing", "Current");
+	EXPECT_FALSE(std::filesystem::exists(root / "Missing"));
+}
+
+TEST_F(CacheDirectoryTest, RemovesStaleDirectoriesOnly)
+{
+	WriteFile(root / "0123456789ABCDEF" / "a.bin", 10, 1h);
+	WriteFile(root / "FEDCBA9876543210" / "b.bin", 10, 1h);
+	WriteFile(root / "loose.bin", 10, 1h);
+
+	Util::RemoveStaleCacheDirectories(root, "FEDCBA9876543210");
+	EXPECT_EQ(Remaining(), (std::vector<std::string>{ "FEDCBA9876543210", "loose.bin" }));
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include "Utils/CellGrid.h"
+
+namespace
+{
+	using Grid = Util::CellGrid<int, int, 2>;
+
+	// Stands in for the game's cell lookup, cells exist where the map has an entry
+	struct MockCells
+	{
+		std::optional<int> operator()(int a_x, int a_y)
+		{
+			lookups.push_back({ a_x, a_y });
+			if (auto it = cells.find({ a_x, a_y }); it != cells.end())
+				return it->second;
+			return std::nullopt;
+		}
+
+		std::map<std::pair<int, int>, int> cells;
+		std::vector<std::pair<int, int>> lookups;
+	};
+
+	std::vector<std::optional<int>> Update(Grid& a_grid, MockCells& a_cells, int a_x, int a_y, int a_space = 0)
+	{
+		std::vector<std::optional<int>> data(Grid::Size * Grid::Size);
+		a_grid.Update(a_x, a_y, a_space, std::ref(a_cells), [&](int a_index, const std::optional<int>& a_data) { data[a_index] = a_data; });
+		return data;
+	}
+
+	// Every cell of the map holds its own coordinates
+	MockCells MakeCells(int a_extent)
+	{
+		MockCells cells;
+		for (int y = -a_extent; y <= a_extent; y++)
+			for (int x = -a_extent; x <= a_extent; x++)
+				cells.cells[{ x, y }] = x * 1000 + y;
+		return cells;
+	}
+}
+
+TEST(CellGridTest, EmitsTheCellsAroundTheCameraRowByRow)
+{
+	Grid grid;
+	auto cells = MakeCells(10);
+
+	auto data = Update(grid, cells, 3, -1);
+	for (int k = 0; k < Grid::Size; k++)
+		for (int i = 0; i < Grid::Size; i++)
+			EXPECT_EQ(data[i + k * Grid::Size], (3 + i - 2) * 1000 + (-1 + k - 2));
+	EXPECT_EQ(cells.lookups.size(), 25u);
+}
+
+TEST(CellGridTest, StandingStillLooksNothingUp)
+{
+	Grid grid;
+	auto cells = MakeCells(10);
+
+	auto first = Update(grid, cells, 0, 0);
+	cells.lookups.clear();
+	EXPECT_EQ(Update(grid, cells, 0, 0), first);
+	EXPECT_TRUE(cells.lookups.empty());
+}
+
+TEST(CellGridTest, CrossingACellLooksUpOnlyTheCellsThatScrolledIn)
+{
+	Grid grid;
+	auto cells = MakeCells(10);
+
+	Update(grid, cells, 0, 0);
+	cells.lookups.clear();
+	Update(grid, cells, 1, 0);
+	ASSERT_EQ(cells.lookups.size(), 5u);
+	for (const auto& [x, y] : cells.lookups)
+		EXPECT_EQ(x, 3);
+
+	cells.lookups.clear();
+	auto data = Update(grid, cells, 2, -1);
+	EXPECT_EQ(cells.lookups.size(), 9u);  // a column and a row, sharing their corner
+	EXPECT_EQ(data[0], 0 * 1000 - 3);
+
+	// Moving further than the grid replaces every tile
+	cells.lookups.clear();
+	Update(grid, cells, -6, -1);
+	EXPECT_EQ(cells.lookups.size(), 25u);
+}
+
+TEST(CellGridTest, MissingCellsAreCachedAsEmpty)
+{
+	Grid grid;
+	auto cells = MakeCells(1);
+
+	auto data = Update(grid, cells, 0, 0);
+	EXPECT_EQ(std::ranges::count(data, std::optional<int>{}), 16);
+	EXPECT_EQ(data[12], 0);
+
+	cells.lookups.clear();
+	Update(grid, cells, 0, 0);
+	EXPECT_TRUE(cells.lookups.empty());
+}
+
+TEST(CellGridTest, InvalidateLooksEveryCellUpAgain)
+{
+	Grid grid;
+	auto cells = MakeCells(10);
+
+	Update(grid, cells, 0, 0);
+	cells.cells[{ 1, 1 }] = -1;  // attached again with other data
+	grid.Invalidate();
+
+	cells.lookups.clear();
+	auto data = Update(grid, cells, 0, 0);
+	EXPECT_EQ(cells.lookups.size(), 25u);
+	EXPECT_EQ(data[3 + 3 * Grid::Size], -1);
+}
+
+// The same coordinates in another worldspace or interior are other cells
+TEST(CellGridTest, ChangingSpaceLooksEveryCellUpAgain)
+{
+	Grid grid;
+	auto cells = MakeCells(10);
+
+	Update(grid, cells, 0, 0, 1);
+	cells.lookups.clear();
+	Update(grid, cells, 0, 0, 2);
+	EXPECT_EQ(cells.lookups.size(), 25u);
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include "Features/LightLimitFIx/ClusterGrid.h"
+
+namespace
+{
+	constexpr uint Width = 1920;
+	constexpr uint Height = 1080;
+
+	// Runs a full statistics window, returning whether the grid changed at its end
+	bool RunWindow(ClusterGridController& a_controller, uint a_lightCount, ClusterStatistics a_statistics)
+	{
+		bool changed = false;
+		for (uint frame = 0; frame < ClusterGridController::StatisticsWindow; frame++) {
+			a_controller.AddStatistics(a_statistics);
+			bool frameChanged = a_controller.Update(a_lightCount, Width, Height);
+			EXPECT_TRUE(!frameChanged || frame == ClusterGridController::StatisticsWindow - 1);
+			changed |= frameChanged;
+		}
+		return changed;
+	}
+}
+
+TEST(ClusterGrid, FitsTheScreen)
+{
+	ClusterGridController controller;
+	auto size = controller.Fit(Width, Height);
+
+	EXPECT_EQ(size, (std::array<uint, 3>{ 30, 17, 32 }));
+	EXPECT_EQ(controller.Get().lightIndexListSize, 30u * 17 * 32 * controller.Get().maxClusterLights);
+}
+
+TEST(ClusterGrid, GrowsAtTheEndOfAWindow)
+{
+	ClusterGridController controller;
+	controller.Fit(Width, Height);
+
+	EXPECT_TRUE(RunWindow(controller, 600, { 1000, 10, 300, 0 }));
+	EXPECT_EQ(controller.Get().depthSlices, 64u);
+	EXPECT_EQ(controller.Get().maxClusterLights, 512u);
+	EXPECT_EQ(controller.Get().tileSize, 64u);
+}
+
+TEST(ClusterGrid, SmallerTilesWhenTheLargestCapacityOverflows)
+{
+	ClusterGridController controller;
+	controller.Fit(Width, Height);
+
+	EXPECT_TRUE(RunWindow(controller, 1000, { 1000, 10, 700, 0 }));
+	EXPECT_EQ(controller.Get().tileSize, 32u);
+	EXPECT_EQ(controller.Get().maxClusterLights, 512u);
+}
+
+TEST(ClusterGrid, ShrinksAfterSeveralWindows)
+{
+	ClusterGridController controller;
+	controller.Fit(Width, Height);
+	RunWindow(controller, 600, { 1000, 10, 300, 0 });
+
+	for (uint window = 1; window < ClusterGridController::ShrinkWindows; window++)
+		EXPECT_FALSE(RunWindow(controller, 10, { 100, 0, 4, 0 }));
+	EXPECT_EQ(controller.Get().depthSlices, 64u);
+
+	EXPECT_TRUE(RunWindow(controller, 10, { 100, 0, 4, 0 }));
+	EXPECT_EQ(controller.Get().depthSlices, 16u);
+	EXPECT_EQ(controller.Get().maxClusterLights, ClusterGridController::MinClusterLights);
+
+	uint clusterCount = 30 * 17 * 16;
+	EXPECT_EQ(controller.Get().lightIndexListSize, clusterCount * ClusterGridController::MinClusterLights);
+}
+
+TEST(ClusterGrid, GrowthResetsTheShrinkCount)
+{
+	ClusterGridController controller;
+	controller.Fit(Width, Height);
+	RunWindow(controller, 600, { 1000, 10, 300, 0 });
+
+	for (uint window = 1; window < ClusterGridController::ShrinkWindows; window++)
+		RunWindow(controller, 10, { 100, 0, 4, 0 });
+	// A window that wants the current grid again starts the count over
+	RunWindow(controller, 600, { 1000, 0, 300, 0 });
+	EXPECT_FALSE(RunWindow(controller, 10, { 100, 0, 4, 0 }));
+	EXPECT_EQ(controller.Get().depthSlices, 64u);
+}
+
+TEST(ClusterGrid, IndexListGrowsWhenItOverflows)
+{
+	ClusterGridController controller;
+	controller.Fit(Width, Height);
+	RunWindow(controller, 100, { 100, 0, 16, 0 });
+	for (uint window = 1; window < ClusterGridController::ShrinkWindows; window++)
+		RunWindow(controller, 100, { 100, 0, 16, 0 });
+
+	uint listSize = controller.Get().lightIndexListSize;
+	EXPECT_TRUE(RunWindow(controller, 100, { listSize + 1, 0, 16, 0 }));
+	EXPECT_GT(controller.Get().lightIndexListSize, listSize);
+}
+
+TEST(ClusterGrid, PeaksWithinAWindowCount)
+{
+	ClusterGridController controller;
+	controller.Fit(Width, Height);
+
+	bool changed = false;
+	for (uint frame = 0; frame < ClusterGridController::StatisticsWindow; frame++) {
+		// A single frame with many lights is enough to grow
+		controller.AddStatistics({ 100, 0, frame == 10 ? 400u : 4u, 0 });
+		changed |= controller.Update(frame == 10 ? 600 : 10, Width, Height);
+	}
+	EXPECT_TRUE(changed);
+	EXPECT_EQ(controller.Get().depthSlices, 64u);
+	EXPECT_EQ(controller.Get().maxClusterLights, 512u);
+}
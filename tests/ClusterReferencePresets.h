@@ -0,0 +1,188 @@
+#pragma once
+
+#include "Features/LightLimitFIx/ClusterReference.h"
+
+// Synthetic frames for the cluster reference, deterministic on every platform so their outputs can be kept as golden files
+namespace ClusterReferencePresets
+{
+	// Small LCG, the standard distributions are not guaranteed to give the same numbers on every standard library
+	class Random
+	{
+	public:
+		explicit Random(uint32_t a_seed) :
+			state(a_seed) {}
+
+		float Next()
+		{
+			state = state * 1664525u + 1013904223u;
+			return (float)(state >> 8) / (float)(1u << 24);
+		}
+
+		float Next(float a_min, float a_max) { return a_min + (a_max - a_min) * Next(); }
+
+	private:
+		uint32_t state;
+	};
+
+	// Inverse of a left-handed perspective projection, as built from projMatrixUnjittered
+	inline ClusterReference::Float4x4 InverseProjection(float a_fovY, float a_aspect, float a_near, float a_far)
+	{
+		float yScale = 1.0f / std::tan(a_fovY * 0.5f);
+		float xScale = yScale / a_aspect;
+
+		ClusterReference::Float4x4 m{};
+		m.m[0][0] = 1.0f / xScale;
+		m.m[1][1] = 1.0f / yScale;
+		m.m[2][3] = -(a_far - a_near) / (a_near * a_far);
+		m.m[3][2] = 1.0f;
+		m.m[3][3] = 1.0f / a_near;
+		return m;
+	}
+
+	inline ClusterReference::Float4x4 Identity()
+	{
+		ClusterReference::Float4x4 m{};
+		for (int i = 0; i < 4; i++)
+			m.m[i][i] = 1.0f;
+		return m;
+	}
+
+	struct Preset
+	{
+		const char* name;
+		uint32_t sceneLights;
+		uint32_t particleSystems;
+		uint32_t particlesPerSystem;
+		uint32_t billboards;
+		int32_t eyeCount;
+		uint32_t clusterSize[3];
+		uint32_t maxClusterLights;
+	};
+
+	inline constexpr Preset Presets[] = {
+		{ "Interior", 32, 0, 0, 0, 1, { 30, 17, 32 }, 128 },
+		{ "Town", 600, 0, 0, 4, 1, { 30, 17, 32 }, 256 },
+		{ "Particles", 64, 24, 64, 16, 1, { 30, 17, 32 }, 128 },
+		{ "VR", 128, 8, 32, 4, 2, { 32, 32, 32 }, 128 },
+	};
+
+	inline constexpr uint32_t MaxLights = 1024;
+	inline constexpr float LightsNear = 1.0f;
+	inline constexpr float LightsFar = 16384.0f;
+
+	inline ClusterReference::Snapshot MakeSnapshot(const Preset& a_preset, uint32_t a_seed = 1)
+	{
+		using namespace ClusterReference;
+
+		Random random{ a_seed };
+		Snapshot snapshot;
+		std::copy_n(a_preset.clusterSize, 3, snapshot.clusterSize);
+		std::copy_n(a_preset.clusterSize, 3, snapshot.building.ClusterSize);
+		snapshot.maxClusterLights = a_preset.maxClusterLights;
+		snapshot.eyeCount = a_preset.eyeCount;
+		snapshot.maxLights = MaxLights;
+
+		Float3 camera = { 1000.0f, -2000.0f, 500.0f };
+		snapshot.particleOrigin = camera;
+		snapshot.particleSettings = { 4096.0f * 4096.0f, 6144.0f * 6144.0f, true, 0 };
+
+		snapshot.building.LightsNear = LightsNear;
+		snapshot.building.LightsFar = LightsFar;
+		float eyeOffset = a_preset.eyeCount == 2 ? 3.2f : 0.0f;
+		for (int eyeIndex = 0; eyeIndex < 2; eyeIndex++) {
+			snapshot.building.InvProjMatrix[eyeIndex] = InverseProjection(1.3f, 16.0f / 9.0f, LightsNear, LightsFar);
+			snapshot.transform.ViewMatrix[eyeIndex] = Identity();
+			float offset = eyeIndex == 0 ? -eyeOffset : eyeOffset;
+			snapshot.transform.EyePosition[eyeIndex] = { camera.x + offset, camera.y, camera.z, 0.0f };
+		}
+
+		// Scene lights in front of the camera, a quarter of them limited to some rooms
+		for (uint32_t i = 0; i < a_preset.sceneLights; i++) {
+			Light light{};
+			float depth = random.Next(10.0f, 6000.0f);
+			light.positionWS[0] = {
+				camera.x + random.Next(-1.0f, 1.0f) * depth,
+				camera.y + random.Next(-0.6f, 0.6f) * depth,
+				camera.z + depth,
+				0.0f
+			};
+			light.radius = random.Next(50.0f, 800.0f);
+			light.color = { random.Next(), random.Next(), random.Next() };
+			if (i % 4 == 0) {
+				light.lightFlags = LightFlags::PortalStrict;
+				light.roomFlags[0] = 1u << (i % 8);
+			}
+			snapshot.lights.push_back(light);
+		}
+
+		// Particle systems emit clumps of particles, which mostly merge, and a few outliers which do not
+		for (uint32_t system = 0; system < a_preset.particleSystems; system++) {
+			float depth = random.Next(50.0f, 7000.0f);
+			Float3 center = { random.Next(-0.8f, 0.8f) * depth, random.Next(-0.4f, 0.4f) * depth, depth };
+			float size = random.Next(4.0f, 24.0f);
+			for (uint32_t p = 0; p < a_preset.particlesPerSystem; p++) {
+				float spread = p % 8 == 7 ? 200.0f : 8.0f;
+				ParticleMerger::Particle particle{};
+				particle.position[0] = center.x + random.Next(-spread, spread);
+				particle.position[1] = center.y + random.Next(-spread, spread);
+				particle.position[2] = center.z + random.Next(-spread, spread);
+				particle.radius = size * random.Next(0.8f, 1.2f);
+				particle.lightRadius = particle.radius * 4.0f;
+				particle.color[0] = random.Next(0.0f, 0.2f);
+				particle.color[1] = random.Next(0.0f, 0.1f);
+				particle.color[2] = random.Next(0.0f, 0.05f);
+				snapshot.particles.push_back(particle);
+			}
+		}
+
+		for (uint32_t i = 0; i < a_preset.billboards; i++) {
+			float depth = random.Next(50.0f, 3000.0f);
+			ParticleMerger::Particle particle{};
+			particle.position[0] = random.Next(-0.5f, 0.5f) * depth;
+			particle.position[1] = random.Next(-0.3f, 0.3f) * depth;
+			particle.position[2] = depth;
+			particle.lightRadius = random.Next(100.0f, 400.0f);
+			particle.color[0] = particle.color[1] = particle.color[2] = random.Next(0.2f, 1.0f);
+			particle.single = true;
+			snapshot.particles.push_back(particle);
+		}
+
+		return snapshot;
+	}
+
+	// Outputs compared against the golden files: light counts and the lights shaded at a grid of pixels
+	inline json Summarize(const ClusterReference::Snapshot& a_snapshot, const ClusterReference::Result& a_result)
+	{
+		constexpr uint32_t SamplesX = 8;
+		constexpr uint32_t SamplesY = 6;
+		constexpr float SampleDepths[] = { 100.0f, 1000.0f, 5000.0f };
+
+		uint32_t maxClusterLightCount = 0;
+		for (const auto& grid : a_result.clusterLights.lightGrid)
+			maxClusterLightCount = std::max(maxClusterLightCount, grid.lightCount);
+
+		json summary;
+		summary["gatheredLights"] = a_result.lights.size();
+		summary["particleLights"] = a_result.lights.size() - a_snapshot.lights.size();
+		summary["clusters"] = a_result.clusters.size();
+		summary["lightIndices"] = a_result.clusterLights.lightIndexList.size();
+		summary["maxClusterLightCount"] = maxClusterLightCount;
+
+		for (int roomIndex : { -1, 3 }) {
+			auto& depths = summary[roomIndex < 0 ? "pixelLights" : "pixelLightsRoom3"];
+			for (float depth : SampleDepths) {
+				std::string row;
+				for (uint32_t y = 0; y < SamplesY; y++) {
+					for (uint32_t x = 0; x < SamplesX; x++) {
+						float u = (x + 0.5f) / SamplesX;
+						float v = (y + 0.5f) / SamplesY;
+						row += std::to_string(ClusterReference::CountPixelLights(a_snapshot, a_result, u, v, depth, roomIndex));
+						row += x + 1 < SamplesX ? " " : (y + 1 < SamplesY ? " | " : "");
+					}
+				}
+				depths[std::to_string((int)depth)] = row;
+			}
+		}
+		return summary;
+	}
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include "ClusterReferencePresets.h"
+
+namespace
+{
+	using namespace ClusterReferencePresets;
+
+	std::filesystem::path GoldenPath(const Preset& a_preset)
+	{
+		return std::filesystem::path(TEST_DATA_DIR) / "ClusterReference" / (std::string(a_preset.name) + ".json");
+	}
+
+	class ClusterReferencePreset : public testing::TestWithParam<Preset>
+	{};
+
+	std::string PresetName(const testing::TestParamInfo<Preset>& a_info)
+	{
+		return a_info.param.name;
+	}
+}
+
+// Set UPDATE_GOLDEN=1 to rewrite the golden files after an intended change to the pipeline
+TEST_P(ClusterReferencePreset, MatchesGolden)
+{
+	auto snapshot = MakeSnapshot(GetParam());
+	auto summary = Summarize(snapshot, ClusterReference::Run(snapshot));
+
+	auto path = GoldenPath(GetParam());
+	if (std::getenv("UPDATE_GOLDEN")) {
+		std::filesystem::create_directories(path.parent_path());
+		std::ofstream{ path } << summary.dump(1, '\t') << "\n";
+		GTEST_SKIP() << "Updated " << path.string();
+	}
+
+	std::ifstream file{ path };
+	ASSERT_TRUE(file.is_open()) << path.string() << " is missing, run with UPDATE_GOLDEN=1";
+	json golden = json::parse(file);
+	for (const auto& [key, value] : golden.items())
+		EXPECT_EQ(summary[key], value) << key;
+}
+
+TEST_P(ClusterReferencePreset, SnapshotRoundTrip)
+{
+	auto snapshot = MakeSnapshot(GetParam());
+	auto path = std::filesystem::temp_directory_path() / (std::string("ClusterReference") + GetParam().name + ".bin");
+	ASSERT_TRUE(ClusterReference::SaveSnapshot(path, snapshot));
+
+	ClusterReference::Snapshot loaded;
+	ASSERT_TRUE(ClusterReference::LoadSnapshot(path, loaded));
+	std::filesystem::remove(path);
+
+	ASSERT_EQ(loaded.lights.size(), snapshot.lights.size());
+	ASSERT_EQ(loaded.particles.size(), snapshot.particles.size());
+	EXPECT_EQ(std::memcmp(loaded.lights.data(), snapshot.lights.data(), sizeof(ClusterReference::Light) * snapshot.lights.size()), 0);
+	EXPECT_EQ(Summarize(loaded, ClusterReference::Run(loaded)), Summarize(snapshot, ClusterReference::Run(snapshot)));
+}
+
+// Every light a cluster lists must reach it, and every light reaching it must be listed while there is room
+TEST_P(ClusterReferencePreset, ClustersListIntersectingLights)
+{
+	auto snapshot = MakeSnapshot(GetParam());
+	auto result = ClusterReference::Run(snapshot);
+	const auto& grid = result.clusterLights.lightGrid;
+
+	ASSERT_EQ(grid.size(), (size_t)snapshot.clusterSize[0] * snapshot.clusterSize[1] * snapshot.clusterSize[2]);
+	uint32_t offset = 0;
+	for (const auto& cluster : grid) {
+		EXPECT_EQ(cluster.offset, offset);
+		EXPECT_LE(cluster.lightCount, snapshot.maxClusterLights);
+		offset += cluster.lightCount;
+		for (uint32_t i = 1; i < cluster.lightCount; i++)
+			EXPECT_LT(result.clusterLights.lightIndexList[cluster.offset + i - 1], result.clusterLights.lightIndexList[cluster.offset + i]);
+	}
+	EXPECT_EQ(offset, result.clusterLights.lightIndexList.size());
+}
+
+INSTANTIATE_TEST_SUITE_P(Presets, ClusterReferencePreset, testing::ValuesIn(Presets), PresetName);
+
+TEST(ClusterReference, GatherCapsParticleLights)
+{
+	auto snapshot = MakeSnapshot(Presets[2]);
+	snapshot.maxLights = (uint32_t)snapshot.lights.size() + 5;
+
+	auto lights = ClusterReference::GatherLights(snapshot);
+	ASSERT_EQ(lights.size(), snapshot.maxLights);
+	EXPECT_EQ(std::memcmp(lights.data(), snapshot.lights.data(), sizeof(ClusterReference::Light) * snapshot.lights.size()), 0);
+	for (size_t i = snapshot.lights.size(); i < lights.size(); i++)
+		EXPECT_EQ(lights[i].lightFlags, ClusterReference::LightFlags::Simple);
+}
+
+TEST(ClusterReference, ParticleLightsAreInWorldSpace)
+{
+	auto snapshot = MakeSnapshot(Presets[0]);
+	snapshot.particles.push_back({ { 10.0f, 20.0f, 30.0f }, 8.0f, { 1.0f, 1.0f, 1.0f }, 64.0f, true, {} });
+
+	auto lights = ClusterReference::GatherLights(snapshot);
+	ASSERT_EQ(lights.size(), snapshot.lights.size() + 1);
+	const auto& light = lights.back();
+	EXPECT_FLOAT_EQ(light.positionWS[0].x, snapshot.particleOrigin.x + 10.0f);
+	EXPECT_FLOAT_EQ(light.positionWS[0].y, snapshot.particleOrigin.y + 20.0f);
+	EXPECT_FLOAT_EQ(light.positionWS[0].z, snapshot.particleOrigin.z + 30.0f);
+	EXPECT_FLOAT_EQ(light.radius, 64.0f);
+}
+
+TEST(ClusterReference, PixelOutsideTheFarPlaneHasNoLights)
+{
+	auto snapshot = MakeSnapshot(Presets[1]);
+	auto result = ClusterReference::Run(snapshot);
+	EXPECT_GT(ClusterReference::CountPixelLights(snapshot, result, 0.5f, 0.5f, 1000.0f), 0u);
+	EXPECT_EQ(ClusterReference::CountPixelLights(snapshot, result, 0.5f, 0.5f, LightsFar * 2.0f), 0u);
+}
+
+TEST(ClusterReference, LoadRejectsForeignFiles)
+{
+	auto path = std::filesystem::temp_directory_path() / "ClusterReferenceForeign.bin";
+	std::ofstream{ path, std::ios::binary } << "not a snapshot";
+
+	ClusterReference::Snapshot snapshot;
+	EXPECT_FALSE(ClusterReference::LoadSnapshot(path, snapshot));
+	EXPECT_FALSE(ClusterReference::LoadSnapshot(path.string() + ".missing", snapshot));
+	std::filesystem::remove(path);
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include "EventJournal.h"
+
+namespace
+{
+	// check is derived from the other fields so a torn copy is detectable
+	struct TestEvent
+	{
+		uint32_t producer = 0;
+		uint32_t index = 0;
+		uint64_t check = 0;
+	};
+
+	TestEvent MakeEvent(uint32_t a_producer, uint32_t a_index)
+	{
+		return { a_producer, a_index, ((uint64_t)a_producer << 32 | a_index) * 0x9E3779B97F4A7C15ull };
+	}
+
+	bool IsIntact(const TestEvent& a_event)
+	{
+		return a_event.check == MakeEvent(a_event.producer, a_event.index).check;
+	}
+}
+
+TEST(EventJournal, DrainsInPostingOrder)
+{
+	EventJournal<TestEvent, 8> journal;
+	for (uint32_t i = 0; i < 5; i++)
+		journal.Post(MakeEvent(0, i));
+
+	std::vector<uint32_t> indices;
+	EXPECT_EQ(journal.Drain([&](const TestEvent& a_event) { indices.push_back(a_event.index); }), 0u);
+	EXPECT_EQ(indices, (std::vector<uint32_t>{ 0, 1, 2, 3, 4 }));
+
+	indices.clear();
+	EXPECT_EQ(journal.Drain([&](const TestEvent& a_event) { indices.push_back(a_event.index); }), 0u);
+	EXPECT_TRUE(indices.empty());
+}
+
+TEST(EventJournal, CountsOverwrittenEventsAsDropped)
+{
+	EventJournal<TestEvent, 8> journal;
+	for (uint32_t i = 0; i < 20; i++)
+		journal.Post(MakeEvent(0, i));
+
+	std::vector<uint32_t> indices;
+	EXPECT_EQ(journal.Drain([&](const TestEvent& a_event) { indices.push_back(a_event.index); }), 12u);
+	EXPECT_EQ(indices, (std::vector<uint32_t>{ 12, 13, 14, 15, 16, 17, 18, 19 }));
+
+	// The journal keeps working after the producers lapped it
+	journal.Post(MakeEvent(0, 20));
+	indices.clear();
+	EXPECT_EQ(journal.Drain([&](const TestEvent& a_event) { indices.push_back(a_event.index); }), 0u);
+	EXPECT_EQ(indices, (std::vector<uint32_t>{ 20 }));
+}
+
+// Producers lap a small journal while it is drained, every event must be either consumed intact or counted as dropped
+TEST(EventJournal, ConcurrentProducersNeverTearEvents)
+{
+	constexpr uint32_t Producers = 4;
+	constexpr uint32_t EventsPerProducer = 50000;
+
+	EventJournal<TestEvent, 16> journal;
+	std::atomic<bool> done = false;
+	std::vector<std::thread> producers;
+	for (uint32_t producer = 0; producer < Producers; producer++) {
+		producers.emplace_back([&journal, producer] {
+			for (uint32_t i = 0; i < EventsPerProducer; i++)
+				journal.Post(MakeEvent(producer, i));
+		});
+	}
+
+	uint64_t consumed = 0, dropped = 0, torn = 0;
+	std::array<int64_t, Producers> lastIndex;
+	lastIndex.fill(-1);
+	uint64_t reordered = 0;
+	auto consume = [&](const TestEvent& a_event) {
+		if (!IsIntact(a_event) || a_event.producer >= Producers) {
+			torn++;
+			return;
+		}
+		if ((int64_t)a_event.index <= lastIndex[a_event.producer])
+			reordered++;
+		lastIndex[a_event.producer] = a_event.index;
+		consumed++;
+	};
+
+	std::thread consumer([&] {
+		while (!done.load())
+			dropped += journal.Drain(consume);
+	});
+
+	for (auto& thread : producers)
+		thread.join();
+	done = true;
+	consumer.join();
+	dropped += journal.Drain(consume);
+
+	EXPECT_EQ(torn, 0u);
+	EXPECT_EQ(reordered, 0u);
+	EXPECT_EQ(consumed + dropped, (uint64_t)Producers * EventsPerProducer);
+}
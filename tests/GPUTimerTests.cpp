@@ -0,0 +1,252 @@
+#include <gtest/gtest.h>
+
+#include "GPUTimer.h"
+
+namespace
+{
+	// Fake GPU: a frame's queries become readable a_latency Advance calls after the frame ended
+	struct MockGPU
+	{
+		uint32_t latency = 1;
+		bool failCreate = false;
+		uint64_t frequency = 1000000;  // ticks per second, 1000 ticks per millisecond
+		uint64_t now = 0;              // GPU clock written by timestamps
+		uint64_t tick = 0;             // advanced once per frame by the test
+		std::vector<uint32_t> disjointFrames;  // frames (counted from the first EndDisjoint) reported as disjoint
+
+		struct Frame
+		{
+			bool ended = false;
+			uint64_t endedAt = 0;
+			bool disjoint = false;
+			std::vector<uint64_t> timestamps;
+		};
+		std::vector<Frame> frames;
+		uint32_t endedFrames = 0;
+		uint32_t readsInFlight = 0;
+	};
+
+	class MockGPUQueries : public GPUQueries
+	{
+	public:
+		explicit MockGPUQueries(std::shared_ptr<MockGPU> a_gpu) :
+			gpu(std::move(a_gpu)) {}
+
+		bool Create(uint32_t a_frames, uint32_t a_timestamps) override
+		{
+			if (gpu->failCreate)
+				return false;
+			gpu->frames.assign(a_frames, {});
+			for (auto& frame : gpu->frames)
+				frame.timestamps.assign(a_timestamps, 0);
+			return true;
+		}
+
+		void BeginDisjoint(uint32_t a_frame) override { gpu->frames[a_frame].ended = false; }
+
+		void EndDisjoint(uint32_t a_frame) override
+		{
+			auto& frame = gpu->frames[a_frame];
+			frame.ended = true;
+			frame.endedAt = gpu->tick;
+			frame.disjoint = std::ranges::find(gpu->disjointFrames, gpu->endedFrames) != gpu->disjointFrames.end();
+			gpu->endedFrames++;
+		}
+
+		void Timestamp(uint32_t a_frame, uint32_t a_index) override { gpu->frames[a_frame].timestamps[a_index] = gpu->now; }
+
+		bool GetDisjoint(uint32_t a_frame, uint64_t& o_frequency, bool& o_disjoint) override
+		{
+			if (!IsDone(a_frame))
+				return false;
+			o_frequency = gpu->frequency;
+			o_disjoint = gpu->frames[a_frame].disjoint;
+			return true;
+		}
+
+		bool GetTimestamp(uint32_t a_frame, uint32_t a_index, uint64_t& o_ticks) override
+		{
+			if (!IsDone(a_frame))
+				return false;
+			o_ticks = gpu->frames[a_frame].timestamps[a_index];
+			return true;
+		}
+
+	private:
+		bool IsDone(uint32_t a_frame)
+		{
+			const auto& frame = gpu->frames[a_frame];
+			bool done = frame.ended && gpu->tick >= frame.endedAt + gpu->latency;
+			gpu->readsInFlight += !done;
+			return done;
+		}
+
+		std::shared_ptr<MockGPU> gpu;
+	};
+
+	struct Recorded
+	{
+		uint32_t id;
+		uint32_t historyIndex;
+		float time;
+		uint64_t tick;
+	};
+
+	// Drives a GPUTimer the way Profiler::EndFrame does, with a NaN initialized history per scope
+	struct Harness
+	{
+		explicit Harness(uint32_t a_latency)
+		{
+			gpu->latency = a_latency;
+		}
+
+		std::shared_ptr<MockGPU> gpu = std::make_shared<MockGPU>();
+		GPUTimer timer{ std::make_unique<MockGPUQueries>(gpu) };
+		std::vector<Recorded> recorded;
+		std::array<std::array<float, 64>, 4> history = [] {
+			std::array<std::array<float, 64>, 4> history;
+			for (auto& scope : history)
+				scope.fill(GPUTimer::Unrecorded);
+			return history;
+		}();
+		uint32_t historyIndex = 0;
+
+		void Scope(uint32_t a_id, uint64_t a_ticks)
+		{
+			uint32_t slot = timer.Begin(a_id);
+			gpu->now += a_ticks;
+			timer.End(slot);
+		}
+
+		void EndFrame()
+		{
+			gpu->tick++;
+			historyIndex++;
+			timer.Advance(historyIndex, [&](uint32_t a_id, uint32_t a_historyIndex, float a_time) {
+				recorded.push_back({ a_id, a_historyIndex, a_time, gpu->tick });
+				GPUTimer::Accumulate(history[a_id][a_historyIndex], a_time);
+			});
+		}
+	};
+}
+
+TEST(GPUTimer, ResolvesFramesAfterTheGPUFinishedThem)
+{
+	Harness harness{ 2 };
+	harness.EndFrame();  // opens the first frame
+
+	harness.Scope(1, 2500);
+	harness.EndFrame();
+	EXPECT_TRUE(harness.recorded.empty());
+	harness.EndFrame();
+	EXPECT_TRUE(harness.recorded.empty());
+	harness.EndFrame();
+
+	ASSERT_EQ(harness.recorded.size(), 1u);
+	EXPECT_EQ(harness.recorded[0].id, 1u);
+	EXPECT_EQ(harness.recorded[0].historyIndex, 1u);
+	EXPECT_FLOAT_EQ(harness.recorded[0].time, 2.5f);
+	EXPECT_EQ(harness.timer.GetLastHistoryIndex(), 1u);
+	EXPECT_GT(harness.gpu->readsInFlight, 0u);
+}
+
+TEST(GPUTimer, KeepsFrameLatencyFramesInFlight)
+{
+	Harness harness{ GPUTimer::FrameLatency - 1 };
+	harness.EndFrame();
+
+	for (uint32_t frame = 0; frame < 32; frame++) {
+		harness.Scope(0, 1000);
+		harness.EndFrame();
+	}
+
+	// Every frame is resolved FrameLatency - 1 frames later, none is skipped
+	EXPECT_EQ(harness.timer.GetFramesSkipped(), 0u);
+	ASSERT_EQ(harness.recorded.size(), 32u - (GPUTimer::FrameLatency - 1));
+	for (uint32_t i = 0; i < harness.recorded.size(); i++) {
+		EXPECT_EQ(harness.recorded[i].historyIndex, i + 1);
+		EXPECT_EQ(harness.recorded[i].tick, i + 1 + GPUTimer::FrameLatency);
+		EXPECT_FLOAT_EQ(harness.recorded[i].time, 1.0f);
+	}
+}
+
+TEST(GPUTimer, SkipsFramesInsteadOfWaiting)
+{
+	Harness harness{ GPUTimer::FrameLatency + 2 };
+	harness.EndFrame();
+
+	for (uint32_t frame = 0; frame < GPUTimer::FrameLatency; frame++) {
+		harness.Scope(0, 1000);
+		harness.EndFrame();
+	}
+
+	// Every query set is in flight, the frame is not timed
+	EXPECT_EQ(harness.timer.Begin(0), GPUTimer::InvalidSlot);
+	harness.timer.End(GPUTimer::InvalidSlot);
+	EXPECT_EQ(harness.timer.GetFramesSkipped(), 1u);
+
+	for (uint32_t frame = 0; frame < 8; frame++)
+		harness.EndFrame();
+	EXPECT_EQ(harness.recorded.size(), GPUTimer::FrameLatency);
+	EXPECT_TRUE(std::isnan(harness.history[0][GPUTimer::FrameLatency + 1]));
+}
+
+TEST(GPUTimer, DropsDisjointFrames)
+{
+	Harness harness{ 1 };
+	harness.gpu->disjointFrames = { 1 };
+	harness.EndFrame();
+
+	for (uint32_t frame = 0; frame < 3; frame++) {
+		harness.Scope(2, 1000);
+		harness.EndFrame();
+	}
+	harness.EndFrame();
+
+	ASSERT_EQ(harness.recorded.size(), 2u);
+	EXPECT_EQ(harness.recorded[0].historyIndex, 1u);
+	EXPECT_EQ(harness.recorded[1].historyIndex, 3u);
+	EXPECT_FALSE(std::isnan(harness.history[2][1]));
+	EXPECT_TRUE(std::isnan(harness.history[2][2]));
+	EXPECT_FALSE(std::isnan(harness.history[2][3]));
+}
+
+TEST(GPUTimer, AccumulatesRepeatedScopesFromUnrecorded)
+{
+	Harness harness{ 1 };
+	harness.EndFrame();
+
+	harness.Scope(3, 1000);
+	harness.Scope(3, 500);
+	harness.Scope(1, 250);
+	harness.EndFrame();
+	harness.EndFrame();
+
+	EXPECT_FLOAT_EQ(harness.history[3][1], 1.5f);
+	EXPECT_FLOAT_EQ(harness.history[1][1], 0.25f);
+	// Scopes that did not run stay unrecorded rather than reading as 0 ms
+	EXPECT_TRUE(std::isnan(harness.history[0][1]));
+	EXPECT_TRUE(std::isnan(harness.history[3][2]));
+}
+
+TEST(GPUTimer, LimitsScopesPerFrame)
+{
+	Harness harness{ 1 };
+	harness.EndFrame();
+
+	for (uint32_t i = 0; i < GPUTimer::MaxScopesPerFrame; i++)
+		EXPECT_NE(harness.timer.Begin(0), GPUTimer::InvalidSlot);
+	EXPECT_EQ(harness.timer.Begin(0), GPUTimer::InvalidSlot);
+}
+
+TEST(GPUTimer, DisabledWhenQueriesCannotBeCreated)
+{
+	Harness harness{ 1 };
+	harness.gpu->failCreate = true;
+	harness.EndFrame();
+
+	EXPECT_TRUE(harness.timer.IsFailed());
+	EXPECT_EQ(harness.timer.Begin(0), GPUTimer::InvalidSlot);
+	harness.EndFrame();
+	EXPECT_TRUE(harness.recorded.empty());
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include "Features/LightLimitFIx/LightSlots.h"
+
+namespace
+{
+	struct TestLight
+	{
+		float radius = 0.0f;
+		uint32_t id = 0;
+	};
+
+	using Slots = LightSlots<uintptr_t, TestLight>;
+
+	std::vector<std::pair<uint32_t, uint32_t>> Upload(Slots& a_slots, uint32_t a_count)
+	{
+		std::vector<std::pair<uint32_t, uint32_t>> ranges;
+		a_slots.Upload(a_count, [&](uint32_t a_begin, uint32_t a_end) { ranges.emplace_back(a_begin, a_end); });
+		return ranges;
+	}
+}
+
+TEST(LightSlots, KeepsSlotWhileSeen)
+{
+	Slots slots;
+	slots.Reset(8);
+
+	bool isNew = false;
+	EXPECT_EQ(slots.Acquire(1, &isNew), 0u);
+	EXPECT_TRUE(isNew);
+	EXPECT_EQ(slots.Acquire(2, &isNew), 1u);
+	slots.ReleaseUnused();
+
+	slots.NextFrame();
+	EXPECT_EQ(slots.Acquire(2, &isNew), 1u);
+	EXPECT_FALSE(isNew);
+	EXPECT_EQ(slots.Acquire(1, &isNew), 0u);
+	EXPECT_FALSE(isNew);
+	slots.ReleaseUnused();
+	EXPECT_EQ(slots.Count(), 2u);
+}
+
+TEST(LightSlots, FillsHolesWithTheLastSlot)
+{
+	Slots slots;
+	slots.Reset(8);
+
+	for (uintptr_t key = 1; key <= 4; key++)
+		slots.Write(slots.Acquire(key), { 1.0f, (uint32_t)key });
+	slots.ReleaseUnused();
+	slots.Upload(slots.Count(), [](uint32_t, uint32_t) {});
+
+	slots.NextFrame();
+	slots.Acquire(1);
+	slots.Acquire(3);
+	slots.Acquire(4);
+
+	std::vector<std::pair<uint32_t, uint32_t>> moves;
+	slots.ReleaseUnused([&](uint32_t a_from, uint32_t a_to) { moves.emplace_back(a_from, a_to); });
+
+	// The slots stay packed, so no empty slot is left for the culling to skip
+	EXPECT_EQ(slots.Count(), 3u);
+	ASSERT_EQ(moves.size(), 1u);
+	EXPECT_EQ(moves[0], std::make_pair(3u, 1u));
+	EXPECT_EQ(slots.Owner(1), 4u);
+	EXPECT_EQ(slots.Staging(1)->id, 4u);
+	EXPECT_TRUE(slots.IsDirty(1));
+
+	slots.NextFrame();
+	EXPECT_EQ(slots.Acquire(4), 1u);
+	EXPECT_EQ(slots.Acquire(1), 0u);
+	EXPECT_EQ(slots.Acquire(3), 2u);
+	EXPECT_EQ(slots.Acquire(5), 3u);
+}
+
+TEST(LightSlots, ReleasesRunsOfSlots)
+{
+	Slots slots;
+	slots.Reset(8);
+
+	for (uintptr_t key = 1; key <= 6; key++)
+		slots.Write(slots.Acquire(key), { 1.0f, (uint32_t)key });
+	slots.ReleaseUnused();
+
+	// The moved slots are released too when their lights are gone
+	slots.NextFrame();
+	slots.Acquire(2);
+	slots.Acquire(4);
+	slots.ReleaseUnused();
+
+	ASSERT_EQ(slots.Count(), 2u);
+	std::vector<uintptr_t> owners = { slots.Owner(0), slots.Owner(1) };
+	std::sort(owners.begin(), owners.end());
+	EXPECT_EQ(owners, (std::vector<uintptr_t>{ 2, 4 }));
+	for (uint32_t slot = 0; slot < 2; slot++)
+		EXPECT_EQ(slots.Staging(slot)->id, slots.Owner(slot));
+
+	slots.NextFrame();
+	slots.ReleaseUnused();
+	EXPECT_EQ(slots.Count(), 0u);
+}
+
+TEST(LightSlots, FailsWhenFull)
+{
+	Slots slots;
+	slots.Reset(2);
+
+	slots.Acquire(1);
+	slots.Acquire(2);
+	EXPECT_EQ(slots.Acquire(3), Slots::InvalidSlot);
+}
+
+TEST(LightSlots, UnchangedWritesStayClean)
+{
+	Slots slots;
+	slots.Reset(4);
+
+	slots.Write(0, { 1.0f, 1 });
+	EXPECT_TRUE(slots.IsDirty(0));
+	Upload(slots, 4);
+	EXPECT_FALSE(slots.IsDirty(0));
+
+	slots.Write(0, { 1.0f, 1 });
+	EXPECT_FALSE(slots.IsDirty(0));
+	EXPECT_TRUE(Upload(slots, 4).empty());
+}
+
+TEST(LightSlots, FirstUploadIsFull)
+{
+	Slots slots;
+	slots.Reset(16);
+
+	auto ranges = Upload(slots, 10);
+	ASSERT_EQ(ranges.size(), 1u);
+	EXPECT_EQ(ranges[0], std::make_pair(0u, 10u));
+}
+
+TEST(LightSlots, CoalescesNearbyDirtySlots)
+{
+	Slots slots;
+	slots.Reset(64);
+	Upload(slots, 64);
+
+	// Slots 2 and 6 are within the merge gap, 20 is not
+	slots.Write(2, { 1.0f, 2 });
+	slots.Write(6, { 1.0f, 6 });
+	slots.Write(20, { 1.0f, 20 });
+
+	size_t bytes = 0;
+	std::vector<std::pair<uint32_t, uint32_t>> ranges;
+	bytes = slots.Upload(64, [&](uint32_t a_begin, uint32_t a_end) { ranges.emplace_back(a_begin, a_end); });
+
+	ASSERT_EQ(ranges.size(), 2u);
+	EXPECT_EQ(ranges[0], std::make_pair(2u, 7u));
+	EXPECT_EQ(ranges[1], std::make_pair(20u, 21u));
+	EXPECT_EQ(bytes, sizeof(TestLight) * 6);
+}
+
+TEST(LightSlots, UploadsEverythingAboveRatio)
+{
+	Slots slots;
+	slots.Reset(8);
+	Upload(slots, 8);
+
+	for (uint32_t slot = 0; slot < 8; slot += 2)
+		slots.Write(slot, { 1.0f, slot });
+	slots.Write(1, { 1.0f, 1 });
+
+	auto ranges = Upload(slots, 8);
+	ASSERT_EQ(ranges.size(), 1u);
+	EXPECT_EQ(ranges[0], std::make_pair(0u, 8u));
+}
+
+TEST(LightSlots, IgnoresSlotsPastCount)
+{
+	Slots slots;
+	slots.Reset(16);
+	Upload(slots, 16);
+
+	slots.Write(12, { 1.0f, 12 });
+	EXPECT_TRUE(Upload(slots, 8).empty());
+	EXPECT_TRUE(slots.IsDirty(12));
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "Features/Skylighting/OcclusionCache.h"
+
+namespace
+{
+	uint64_t MakeProbe(float a_dc, float a_x, float a_y, float a_z)
+	{
+		float sh[4] = { a_dc, a_x, a_y, a_z };
+		uint64_t probe = 0;
+		for (uint i = 0; i < 4; i++)
+			probe |= (uint64_t)OcclusionCache::FloatToHalf(sh[i]) << (16 * i);
+		return probe;
+	}
+
+	float Coefficient(uint64_t a_probe, uint a_index)
+	{
+		return OcclusionCache::HalfToFloat((uint16_t)(a_probe >> (16 * a_index)));
+	}
+
+	// Probes a non-negative visibility can produce, the DC term up to the unit probe and the linear terms within +-sqrt(3) of it
+	std::vector<uint64_t> RandomProbes(size_t a_count, uint32_t a_seed)
+	{
+		std::mt19937 rng{ a_seed };
+		std::uniform_real_distribution<float> dc{ 0.f, OcclusionCache::UnitProbeDC };
+		std::uniform_real_distribution<float> linear{ -1.f, 1.f };
+
+		std::vector<uint64_t> probes;
+		for (size_t i = 0; i < a_count; i++) {
+			float sh0 = dc(rng);
+			float scale = sh0 * std::numbers::sqrt3_v<float>;
+			probes.push_back(MakeProbe(sh0, linear(rng) * scale, linear(rng) * scale, linear(rng) * scale));
+		}
+		return probes;
+	}
+}
+
+TEST(OcclusionCacheTest, HalfConversionRoundTripsEveryHalf)
+{
+	for (uint32_t half = 0; half <= 0xFFFF; half++) {
+		bool nan = (half & 0x7C00) == 0x7C00 && (half & 0x3FF);
+		if (nan)
+			continue;
+		ASSERT_EQ(OcclusionCache::FloatToHalf(OcclusionCache::HalfToFloat((uint16_t)half)), half) << half;
+	}
+}
+
+TEST(OcclusionCacheTest, HalfConversionRoundsToNearestEven)
+{
+	EXPECT_EQ(OcclusionCache::FloatToHalf(1.f), 0x3C00);
+	EXPECT_EQ(OcclusionCache::FloatToHalf(-2.f), 0xC000);
+	EXPECT_EQ(OcclusionCache::FloatToHalf(1.f + std::ldexp(1.f, -11)), 0x3C00);
+	EXPECT_EQ(OcclusionCache::FloatToHalf(1.f + 3 * std::ldexp(1.f, -11)), 0x3C02);
+	EXPECT_EQ(OcclusionCache::FloatToHalf(65504.f), 0x7BFF);
+	EXPECT_EQ(OcclusionCache::FloatToHalf(65520.f), 0x7C00);
+	EXPECT_EQ(OcclusionCache::FloatToHalf(std::ldexp(1.f, -24)), 0x0001);
+	EXPECT_EQ(OcclusionCache::FloatToHalf(std::ldexp(1.f, -25)), 0x0000);
+	EXPECT_EQ(OcclusionCache::FloatToHalf(std::ldexp(3.f, -26)), 0x0001);
+	EXPECT_EQ(OcclusionCache::FloatToHalf(std::ldexp(1023.5f, -24)), 0x0400);
+}
+
+TEST(OcclusionCacheTest, UnitProbeRoundTripsExactly)
+{
+	uint64_t unitProbe = OcclusionCache::GetUnitProbe();
+	EXPECT_EQ(OcclusionCache::DecodeProbe(OcclusionCache::EncodeProbe(unitProbe)), unitProbe);
+	EXPECT_EQ(OcclusionCache::DecodeProbe(OcclusionCache::EncodeProbe(0)), 0u);
+}
+
+TEST(OcclusionCacheTest, QuantisationErrorIsBounded)
+{
+	const float sqrt3 = std::numbers::sqrt3_v<float>;
+	// Half a step of the DC term, and half a step of the linear terms plus what the DC error carries into them,
+	// each with the precision of a half on top
+	const float dcBound = OcclusionCache::UnitProbeDC / 510.f + 2e-3f;
+
+	for (uint64_t probe : RandomProbes(10000, 1)) {
+		uint64_t decoded = OcclusionCache::DecodeProbe(OcclusionCache::EncodeProbe(probe));
+		float sh0 = Coefficient(probe, 0);
+		ASSERT_NEAR(Coefficient(decoded, 0), sh0, dcBound);
+		for (uint i = 1; i < 4; i++)
+			ASSERT_NEAR(Coefficient(decoded, i), Coefficient(probe, i), sqrt3 * (dcBound + sh0 / 254.f) + 2e-3f) << i;
+	}
+}
+
+TEST(OcclusionCacheTest, ClampsProbesOutsideTheVisibleRange)
+{
+	float dc = OcclusionCache::UnitProbeDC;
+
+	uint32_t brighter = OcclusionCache::EncodeProbe(MakeProbe(2.f * dc, 4.f * dc, -4.f * dc, 0.f));
+	EXPECT_EQ(brighter & 0xFF, 255u);
+	EXPECT_EQ((brighter >> 8) & 0xFF, 255u);
+	EXPECT_EQ((brighter >> 16) & 0xFF, 1u);
+	EXPECT_EQ((brighter >> 24) & 0xFF, 128u);
+
+	// Without a DC term the linear terms have nothing to be relative to
+	uint32_t dark = OcclusionCache::EncodeProbe(MakeProbe(-1.f, 1.f, 1.f, 1.f));
+	EXPECT_EQ(dark, 0x80808000u);
+}
+
+TEST(OcclusionCacheTest, RunsRoundTripTheVolume)
+{
+	const uint64_t unitProbe = OcclusionCache::GetUnitProbe();
+
+	// Unaccumulated probes, open sky, occluded probes and a change of count in between
+	std::vector<uint8_t> accumFrames = { 0, 0, 0, 255, 255, 255, 255, 255, 255, 255, 40, 40, 0 };
+	std::vector<uint64_t> probes = RandomProbes(accumFrames.size(), 2);
+	probes[0] = MakeProbe(1.f, 0.f, 0.f, 0.f);  // whatever the array held is replaced by the unit probe
+	probes[3] = probes[4] = unitProbe;
+	probes[5] = MakeProbe(1.f, 0.5f, 0.f, 0.f);
+
+	std::vector<OcclusionCache::Run> runs;
+	std::vector<uint32_t> storedProbes;
+	OcclusionCache::Encode(accumFrames, probes, runs, storedProbes);
+
+	ASSERT_EQ(runs.size(), 5u);
+	EXPECT_EQ(runs[0].length, 3u);
+	EXPECT_FALSE(runs[0].stored);
+	EXPECT_EQ(runs[1].length, 2u);
+	EXPECT_FALSE(runs[1].stored);
+	EXPECT_EQ(runs[2].length, 5u);
+	EXPECT_TRUE(runs[2].stored);
+	EXPECT_EQ(runs[2].accumFrames, 255u);
+	EXPECT_EQ(runs[3].length, 2u);
+	EXPECT_EQ(runs[3].accumFrames, 40u);
+	EXPECT_EQ(runs[4].length, 1u);
+	EXPECT_EQ(storedProbes.size(), 7u);
+
+	std::vector<uint8_t> decodedFrames;
+	std::vector<uint64_t> decodedProbes;
+	ASSERT_TRUE(OcclusionCache::Decode(runs, storedProbes, accumFrames.size(), decodedFrames, decodedProbes));
+	EXPECT_EQ(decodedFrames, accumFrames);
+	ASSERT_EQ(decodedProbes.size(), probes.size());
+	for (size_t i = 0; i < probes.size(); i++) {
+		uint64_t expected = accumFrames[i] ? OcclusionCache::DecodeProbe(OcclusionCache::EncodeProbe(probes[i])) : unitProbe;
+		EXPECT_EQ(decodedProbes[i], expected) << i;
+	}
+}
+
+TEST(OcclusionCacheTest, DecodeRejectsRunsThatDoNotAddUp)
+{
+	std::vector<uint8_t> accumFrames;
+	std::vector<uint64_t> probes;
+	std::vector<OcclusionCache::Run> runs = { { 2, 10, 1 }, { 2, 0, 0 } };
+	std::vector<uint32_t> storedProbes = { 0x808080FF, 0x808080FF };
+
+	EXPECT_TRUE(OcclusionCache::Decode(runs, storedProbes, 4, accumFrames, probes));
+	EXPECT_FALSE(OcclusionCache::Decode(runs, storedProbes, 3, accumFrames, probes));  // more probes than the volume
+	EXPECT_FALSE(OcclusionCache::Decode(runs, storedProbes, 5, accumFrames, probes));  // fewer probes than the volume
+	EXPECT_FALSE(OcclusionCache::Decode(runs, std::vector<uint32_t>{ 0x808080FF }, 4, accumFrames, probes));
+	EXPECT_FALSE(OcclusionCache::Decode(runs, std::vector<uint32_t>(3, 0x808080FF), 4, accumFrames, probes));
+}
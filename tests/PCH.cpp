@@ -0,0 +1 @@
+#include "PCH.h"
@@ -0,0 +1,52 @@
+#pragma once
+
+// Stand-in for include/PCH.h, the plugin sources built here only use the standard library, json and the logger
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+using namespace std::literals;
+
+namespace logger
+{
+	using spdlog::critical;
+	using spdlog::debug;
+	using spdlog::error;
+	using spdlog::info;
+	using spdlog::trace;
+	using spdlog::warn;
+}
+
+#include "AsyncLog.h"
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+using uint = uint32_t;
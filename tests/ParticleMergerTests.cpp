@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include "Features/LightLimitFIx/ParticleMerger.h"
+
+namespace
+{
+	ParticleMerger::Particle MakeParticle(float a_x, float a_radius, float a_color = 1.0f)
+	{
+		ParticleMerger::Particle particle{};
+		particle.position[0] = a_x;
+		particle.position[2] = 100.0f;
+		particle.radius = a_radius;
+		particle.lightRadius = a_radius;
+		particle.color[0] = particle.color[1] = particle.color[2] = a_color;
+		return particle;
+	}
+
+	std::vector<ParticleMerger::Light> Merge(const ParticleMerger::Settings& a_settings, const std::vector<ParticleMerger::Particle>& a_particles)
+	{
+		std::vector<ParticleMerger::Light> lights;
+		auto emit = [&](const ParticleMerger::Light& a_light) { lights.push_back(a_light); };
+
+		ParticleMerger merger{ a_settings };
+		for (const auto& particle : a_particles)
+			merger.Add(particle, emit);
+		merger.Flush(emit);
+		return lights;
+	}
+}
+
+TEST(ParticleMerger, MergesCloseParticles)
+{
+	auto lights = Merge({}, { MakeParticle(0.0f, 10.0f), MakeParticle(4.0f, 10.0f), MakeParticle(8.0f, 12.0f) });
+
+	ASSERT_EQ(lights.size(), 1u);
+	EXPECT_FLOAT_EQ(lights[0].position[0], 4.0f);
+	EXPECT_FLOAT_EQ(lights[0].radius, (10.0f + 10.0f + 12.0f) / 3.0f);
+	EXPECT_FLOAT_EQ(lights[0].color[0], 3.0f);
+}
+
+TEST(ParticleMerger, StartsANewLightPastTheMergeDistance)
+{
+	auto lights = Merge({}, { MakeParticle(0.0f, 10.0f), MakeParticle(ParticleMerger::MergeDistance + 1.0f, 10.0f), MakeParticle(0.0f, 10.0f) });
+	EXPECT_EQ(lights.size(), 3u);
+
+	// Radius and position differences add up, the particle radius is compared against the averaged light radius
+	lights = Merge({}, { MakeParticle(0.0f, 10.0f), MakeParticle(ParticleMerger::MergeDistance * 0.5f, 10.0f + ParticleMerger::MergeDistance * 0.5f + 1.0f) });
+	EXPECT_EQ(lights.size(), 2u);
+}
+
+TEST(ParticleMerger, DisabledMergingKeepsEveryParticle)
+{
+	ParticleMerger::Settings settings{};
+	settings.merge = false;
+	auto lights = Merge(settings, { MakeParticle(0.0f, 10.0f), MakeParticle(0.0f, 10.0f) });
+	EXPECT_EQ(lights.size(), 2u);
+}
+
+TEST(ParticleMerger, SingleParticlesNeverMerge)
+{
+	auto single = MakeParticle(0.0f, 10.0f);
+	single.single = true;
+
+	auto lights = Merge({}, { MakeParticle(0.0f, 10.0f), single, MakeParticle(0.0f, 10.0f) });
+
+	// The billboard is emitted right away without ending the running light
+	ASSERT_EQ(lights.size(), 2u);
+	EXPECT_FLOAT_EQ(lights[0].color[0], 1.0f);
+	EXPECT_FLOAT_EQ(lights[1].color[0], 2.0f);
+}
+
+TEST(ParticleMerger, FadesWithDistance)
+{
+	ParticleMerger::Settings settings{};
+	settings.fadeStart = 1000.0f * 1000.0f;
+	settings.fadeEnd = 2000.0f * 2000.0f;
+
+	auto near = MakeParticle(0.0f, 10.0f);
+	auto middle = MakeParticle(0.0f, 10.0f);
+	middle.position[2] = std::sqrt(1500.0f * 1500.0f + 10.0f * 10.0f);
+	auto far = MakeParticle(0.0f, 10.0f);
+	far.position[2] = 3000.0f;
+	for (auto* particle : { &near, &middle, &far })
+		particle->single = true;
+
+	auto lights = Merge(settings, { near, middle, far });
+
+	ASSERT_EQ(lights.size(), 2u);
+	EXPECT_FLOAT_EQ(lights[0].color[0], 1.0f);
+	float expected = 1.0f - (1500.0f * 1500.0f - settings.fadeStart) / (settings.fadeEnd - settings.fadeStart);
+	EXPECT_NEAR(lights[1].color[0], expected, 1e-3f);
+}
+
+TEST(ParticleMerger, DropsDarkOrTinyLights)
+{
+	auto dark = MakeParticle(0.0f, 10.0f, 0.0f);
+	auto tiny = MakeParticle(100.0f, 0.0f);
+	EXPECT_TRUE(Merge({}, { dark, tiny }).empty());
+}
@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "ShaderLookup.h"
+
+namespace
+{
+	using Kind = SIE::ShaderLookup::Kind;
+	using LightingFlags = SIE::ShaderDescriptors::LightingShaderFlags;
+	using LightingTechniques = SIE::ShaderDescriptors::LightingShaderTechniques;
+	using WaterFlags = SIE::ShaderDescriptors::WaterShaderFlags;
+	using EffectFlags = SIE::ShaderDescriptors::EffectShaderFlags;
+
+	// State::ModifyShaderLookup before the lookup tables, with the shader type, snow setting and deferred pass passed in
+	void ReferenceModifyShaderLookup(Kind a_kind, uint32_t& a_vertexDescriptor, uint32_t& a_pixelDescriptor, bool a_improvedSnow, bool a_deferred)
+	{
+		switch (a_kind) {
+		case Kind::Lighting:
+			{
+				a_vertexDescriptor &= ~((uint32_t)LightingFlags::AdditionalAlphaMask |
+										(uint32_t)LightingFlags::AmbientSpecular |
+										(uint32_t)LightingFlags::DoAlphaTest |
+										(uint32_t)LightingFlags::ShadowDir |
+										(uint32_t)LightingFlags::DefShadow |
+										(uint32_t)LightingFlags::CharacterLight |
+										(uint32_t)LightingFlags::RimLighting |
+										(uint32_t)LightingFlags::SoftLighting |
+										(uint32_t)LightingFlags::BackLighting |
+										(uint32_t)LightingFlags::Specular |
+										(uint32_t)LightingFlags::AnisoLighting |
+										(uint32_t)LightingFlags::BaseObjectIsSnow |
+										(uint32_t)LightingFlags::Snow |
+										(uint32_t)LightingFlags::TruePbr);
+
+				a_pixelDescriptor &= ~((uint32_t)LightingFlags::AmbientSpecular |
+									   (uint32_t)LightingFlags::ShadowDir |
+									   (uint32_t)LightingFlags::DefShadow |
+									   (uint32_t)LightingFlags::CharacterLight |
+									   (uint32_t)LightingFlags::BaseObjectIsSnow);
+				if (a_pixelDescriptor & (uint32_t)LightingFlags::AdditionalAlphaMask) {
+					a_pixelDescriptor |= (uint32_t)LightingFlags::DoAlphaTest;
+					a_pixelDescriptor &= ~(uint32_t)LightingFlags::AdditionalAlphaMask;
+				}
+
+				if (!a_improvedSnow)
+					a_pixelDescriptor &= ~((uint32_t)LightingFlags::Snow);
+
+				if (a_deferred)
+					a_pixelDescriptor |= (uint32_t)LightingFlags::Deferred;
+
+				{
+					uint32_t technique = 0x3F & (a_vertexDescriptor >> 24);
+					if (technique == (uint32_t)LightingTechniques::Glowmap ||
+						technique == (uint32_t)LightingTechniques::Parallax ||
+						technique == (uint32_t)LightingTechniques::Facegen ||
+						technique == (uint32_t)LightingTechniques::FacegenRGBTint ||
+						technique == (uint32_t)LightingTechniques::LODObjects ||
+						technique == (uint32_t)LightingTechniques::LODObjectHD ||
+						technique == (uint32_t)LightingTechniques::MultiIndexSparkle ||
+						technique == (uint32_t)LightingTechniques::Hair)
+						a_vertexDescriptor &= ~(0x3F << 24);
+				}
+
+				{
+					uint32_t technique = 0x3F & (a_pixelDescriptor >> 24);
+					if (technique == (uint32_t)LightingTechniques::Glowmap)
+						a_pixelDescriptor &= ~(0x3F << 24);
+				}
+			}
+			break;
+		case Kind::Water:
+			{
+				auto flags = ~((uint32_t)WaterFlags::Reflections |
+							   (uint32_t)WaterFlags::Cubemap |
+							   (uint32_t)WaterFlags::Interior);
+				a_vertexDescriptor &= flags;
+				a_pixelDescriptor &= flags;
+			}
+			break;
+		case Kind::Effect:
+			{
+				auto flags = ~((uint32_t)EffectFlags::GrayscaleToColor |
+							   (uint32_t)EffectFlags::GrayscaleToAlpha |
+							   (uint32_t)EffectFlags::IgnoreTexAlpha);
+				a_vertexDescriptor &= flags;
+				a_pixelDescriptor &= flags;
+
+				if (a_deferred)
+					a_pixelDescriptor |= (uint32_t)EffectFlags::Deferred;
+			}
+			break;
+		case Kind::DistantTree:
+			{
+				if (a_deferred)
+					a_pixelDescriptor |= (uint32_t)SIE::ShaderDescriptors::DistantTreeShaderFlags::Deferred;
+			}
+			break;
+		case Kind::Sky:
+			{
+				if (a_deferred)
+					a_pixelDescriptor |= 256;
+			}
+			break;
+		case Kind::Grass:
+			{
+				auto technique = a_vertexDescriptor & 0xF;
+				auto flags = a_vertexDescriptor & ~0xF;
+				if (technique == static_cast<uint32_t>(SIE::ShaderDescriptors::GrassShaderTechniques::TruePbr)) {
+					technique = 0;
+				}
+				a_vertexDescriptor = flags | technique;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	// Every bit either version reads or writes for a kind, the other bits only pass through
+	uint32_t RuleBits(Kind a_kind)
+	{
+		constexpr uint32_t techniqueBits = 0x3Fu << 24;
+		if (a_kind == Kind::Lighting) {
+			return techniqueBits | (uint32_t)LightingFlags::TruePbr | (uint32_t)LightingFlags::Deferred |
+			       (uint32_t)LightingFlags::Specular | (uint32_t)LightingFlags::SoftLighting | (uint32_t)LightingFlags::RimLighting |
+			       (uint32_t)LightingFlags::BackLighting | (uint32_t)LightingFlags::ShadowDir | (uint32_t)LightingFlags::DefShadow |
+			       (uint32_t)LightingFlags::AnisoLighting | (uint32_t)LightingFlags::AmbientSpecular | (uint32_t)LightingFlags::BaseObjectIsSnow |
+			       (uint32_t)LightingFlags::DoAlphaTest | (uint32_t)LightingFlags::Snow | (uint32_t)LightingFlags::CharacterLight |
+			       (uint32_t)LightingFlags::AdditionalAlphaMask;
+		}
+		// Grass technique, water and effect flags, the deferred flags of the other kinds
+		return techniqueBits | 0xF | (uint32_t)WaterFlags::Reflections | (uint32_t)WaterFlags::Interior | (uint32_t)WaterFlags::Cubemap |
+		       (uint32_t)EffectFlags::GrayscaleToColor | (uint32_t)EffectFlags::GrayscaleToAlpha | (uint32_t)EffectFlags::IgnoreTexAlpha;
+	}
+
+	std::string KindName(const testing::TestParamInfo<Kind>& a_info)
+	{
+		constexpr const char* names[] = { "Other", "Lighting", "Water", "Effect", "DistantTree", "Sky", "Grass" };
+		return names[(size_t)a_info.param];
+	}
+
+	class ShaderLookupTest : public testing::TestWithParam<Kind>
+	{};
+}
+
+// Every combination of the rule bits, over backgrounds of the remaining bits, with and without snow and the deferred pass
+TEST_P(ShaderLookupTest, MatchesModifyShaderLookupForEveryDescriptor)
+{
+	Kind kind = GetParam();
+	uint32_t ruleBits = RuleBits(kind);
+
+	std::mt19937 rng{ 1 };
+	std::vector<uint32_t> backgrounds = { 0, ~0u, (uint32_t)rng(), (uint32_t)rng() };
+	for (auto& background : backgrounds)
+		background &= ~ruleBits;
+
+	for (uint32_t background : backgrounds) {
+		uint32_t bits = 0;
+		do {
+			uint32_t descriptor = background | bits;
+			for (int improvedSnow = 0; improvedSnow < 2; improvedSnow++) {
+				for (int deferred = 0; deferred < 2; deferred++) {
+					uint32_t vertexDescriptor = descriptor, pixelDescriptor = descriptor;
+					SIE::ShaderLookup::Canonicalize(kind, vertexDescriptor, pixelDescriptor, improvedSnow, deferred);
+
+					uint32_t expectedVertexDescriptor = descriptor, expectedPixelDescriptor = descriptor;
+					ReferenceModifyShaderLookup(kind, expectedVertexDescriptor, expectedPixelDescriptor, improvedSnow, deferred);
+
+					if (vertexDescriptor != expectedVertexDescriptor || pixelDescriptor != expectedPixelDescriptor)
+						FAIL() << std::hex << "descriptor " << descriptor << " snow " << improvedSnow << " deferred " << deferred << ": vertex "
+							   << vertexDescriptor << " != " << expectedVertexDescriptor << ", pixel " << pixelDescriptor << " != " << expectedPixelDescriptor;
+				}
+			}
+			bits = (bits - ruleBits) & ruleBits;
+		} while (bits);
+	}
+}
+
+INSTANTIATE_TEST_SUITE_P(
+	Kinds,
+	ShaderLookupTest,
+	testing::Values(Kind::Other, Kind::Lighting, Kind::Water, Kind::Effect, Kind::DistantTree, Kind::Sky, Kind::Grass),
+	KindName);
+
+// The canonical descriptors are what the cache is keyed by, draws differing in stripped bits share one entry
+TEST(ShaderLookupTest, CanonicalizesIdempotently)
+{
+	std::mt19937 rng{ 2 };
+	for (Kind kind : { Kind::Lighting, Kind::Water, Kind::Effect, Kind::Grass }) {
+		for (int i = 0; i < 10000; i++) {
+			uint32_t vertexDescriptor = (uint32_t)rng(), pixelDescriptor = (uint32_t)rng();
+			SIE::ShaderLookup::Canonicalize(kind, vertexDescriptor, pixelDescriptor, true, false);
+			uint32_t canonicalVertex = vertexDescriptor, canonicalPixel = pixelDescriptor;
+			SIE::ShaderLookup::Canonicalize(kind, vertexDescriptor, pixelDescriptor, true, false);
+			ASSERT_EQ(vertexDescriptor, canonicalVertex);
+			ASSERT_EQ(pixelDescriptor, canonicalPixel);
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include "Features/LightLimitFIx/StrictLightPool.h"
+
+namespace
+{
+	struct TestLight
+	{
+		float radius = 0.0f;
+		uint32_t id = 0;
+	};
+
+	// Every set collides, so reuse must come from comparing the lights
+	struct CollidingHash
+	{
+		size_t operator()(std::string_view) const { return 0; }
+	};
+
+	struct Uploads
+	{
+		std::vector<std::pair<uint32_t, uint32_t>> ranges;
+
+		auto operator()()
+		{
+			return [this](uint32_t a_offset, const TestLight*, uint32_t a_count) { ranges.emplace_back(a_offset, a_count); };
+		}
+	};
+}
+
+TEST(StrictLightPool, ReusesIdenticalSets)
+{
+	StrictLightPool<TestLight> pool;
+	pool.Reset(64);
+	Uploads uploads;
+
+	TestLight a[2] = { { 1.0f, 1 }, { 1.0f, 2 } };
+	TestLight b[3] = { { 1.0f, 3 }, { 1.0f, 4 }, { 1.0f, 5 } };
+
+	EXPECT_EQ(pool.Allocate(a, 2, uploads()), 0u);
+	EXPECT_EQ(pool.Allocate(b, 3, uploads()), 2u);
+	EXPECT_EQ(pool.Allocate(a, 2, uploads()), 0u);
+	EXPECT_EQ(pool.Allocate(b, 3, uploads()), 2u);
+
+	EXPECT_EQ(uploads.ranges.size(), 2u);
+	EXPECT_EQ(pool.Size(), 5u);
+	EXPECT_EQ(pool.ConsumeUploads(), 2u);
+	EXPECT_EQ(pool.ConsumeUploads(), 0u);
+}
+
+TEST(StrictLightPool, SubsetIsNotReused)
+{
+	StrictLightPool<TestLight> pool;
+	pool.Reset(64);
+	Uploads uploads;
+
+	TestLight a[2] = { { 1.0f, 1 }, { 1.0f, 2 } };
+	pool.Allocate(a, 2, uploads());
+	EXPECT_EQ(pool.Allocate(a, 1, uploads()), 2u);
+	EXPECT_EQ(uploads.ranges.size(), 2u);
+}
+
+TEST(StrictLightPool, ComparesOnHashCollision)
+{
+	StrictLightPool<TestLight, CollidingHash> pool;
+	pool.Reset(64);
+	Uploads uploads;
+
+	TestLight a[1] = { { 1.0f, 1 } };
+	TestLight b[1] = { { 1.0f, 2 } };
+
+	EXPECT_EQ(pool.Allocate(a, 1, uploads()), 0u);
+	EXPECT_EQ(pool.Allocate(b, 1, uploads()), 1u);
+	// b replaced a in the map, a is appended again rather than aliased to b
+	EXPECT_EQ(pool.Allocate(a, 1, uploads()), 2u);
+	EXPECT_EQ(pool.Allocate(a, 1, uploads()), 2u);
+	EXPECT_EQ(uploads.ranges.size(), 3u);
+}
+
+TEST(StrictLightPool, WrapsWhenFull)
+{
+	StrictLightPool<TestLight> pool;
+	pool.Reset(4);
+	Uploads uploads;
+
+	TestLight a[3] = { { 1.0f, 1 }, { 1.0f, 2 }, { 1.0f, 3 } };
+	TestLight b[2] = { { 1.0f, 4 }, { 1.0f, 5 } };
+
+	EXPECT_EQ(pool.Allocate(a, 3, uploads()), 0u);
+	EXPECT_EQ(pool.Allocate(b, 2, uploads()), 0u);
+	EXPECT_EQ(pool.Size(), 2u);
+
+	// Sets written before the wrap are gone
+	EXPECT_EQ(pool.Allocate(a, 3, uploads()), 0u);
+	ASSERT_EQ(uploads.ranges.size(), 3u);
+	EXPECT_EQ(uploads.ranges[1], std::make_pair(0u, 2u));
+}
+
+TEST(StrictLightPool, UploadsTheLightsGiven)
+{
+	StrictLightPool<TestLight> pool;
+	pool.Reset(16);
+
+	TestLight a[2] = { { 1.0f, 7 }, { 2.0f, 8 } };
+	std::vector<TestLight> written;
+	pool.Allocate(a, 2, [&](uint32_t, const TestLight* a_lights, uint32_t a_count) { written.assign(a_lights, a_lights + a_count); });
+
+	ASSERT_EQ(written.size(), 2u);
+	EXPECT_EQ(written[1].id, 8u);
+	EXPECT_EQ(written[1].radius, 2.0f);
+}
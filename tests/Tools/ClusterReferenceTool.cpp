@@ -0,0 +1,51 @@
+#include "ClusterReferencePresets.h"
+
+// Replays a Snapshot.bin saved by the "Validate Clusters" button of Light Limit Fix:
+//   ClusterReferenceTool <Snapshot.bin> [--golden <out.json>] [--check <golden.json>]
+// prints the light counts and stage timings, and writes or compares the same summary the preset golden tests use.
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		std::fprintf(stderr, "Usage: %s <Snapshot.bin> [--golden <out.json>] [--check <golden.json>]\n", argv[0]);
+		return 2;
+	}
+
+	ClusterReference::Snapshot snapshot;
+	if (!ClusterReference::LoadSnapshot(argv[1], snapshot)) {
+		std::fprintf(stderr, "Failed to load %s\n", argv[1]);
+		return 1;
+	}
+
+	using Clock = std::chrono::high_resolution_clock;
+	auto milliseconds = [](Clock::time_point a_begin, Clock::time_point a_end) { return std::chrono::duration<double, std::milli>(a_end - a_begin).count(); };
+
+	auto start = Clock::now();
+	auto worldLights = ClusterReference::GatherLights(snapshot);
+	auto gatherEnd = Clock::now();
+	ClusterReference::Result result;
+	result.clusters = ClusterReference::BuildClusters(snapshot.building, snapshot.clusterSize, snapshot.eyeCount);
+	auto buildEnd = Clock::now();
+	result.lights = ClusterReference::TransformLights(worldLights.data(), (uint32_t)worldLights.size(), snapshot.transform);
+	result.clusterLights = ClusterReference::CullLights(result.clusters, result.lights.data(), (uint32_t)result.lights.size(), snapshot.maxClusterLights, snapshot.eyeCount);
+	auto cullEnd = Clock::now();
+
+	auto summary = ClusterReferencePresets::Summarize(snapshot, result);
+	std::printf("%s\n", summary.dump(1, '\t').c_str());
+	std::printf("Scene lights %zu, particles %zu, clusters %u x %u x %u, eyes %d\n",
+		snapshot.lights.size(), snapshot.particles.size(), snapshot.clusterSize[0], snapshot.clusterSize[1], snapshot.clusterSize[2], snapshot.eyeCount);
+	std::printf("Gather %.3f ms, build %.3f ms, transform and cull %.3f ms\n", milliseconds(start, gatherEnd), milliseconds(gatherEnd, buildEnd), milliseconds(buildEnd, cullEnd));
+
+	for (int i = 2; i + 1 < argc; i += 2) {
+		std::string_view option = argv[i];
+		if (option == "--golden") {
+			std::ofstream{ argv[i + 1] } << summary.dump(1, '\t') << "\n";
+		} else if (option == "--check") {
+			std::ifstream file{ argv[i + 1] };
+			if (!file.is_open() || json::parse(file, nullptr, false) != summary) {
+				std::fprintf(stderr, "%s does not match\n", argv[i + 1]);
+				return 1;
+			}
+		}
+	}
+	return 0;
+}